@@ -2,6 +2,7 @@
 
 #include "d3d11_context.h"
 #include "d3d11_device.h"
+#include "d3d11_texture.h"
 
 #include "../dxbc/dxbc_util.h"
 
@@ -136,6 +137,11 @@ namespace dxvk {
   
   void STDMETHODCALLTYPE D3D11DeviceContext::Flush() {
     if (m_type == D3D11_DEVICE_CONTEXT_IMMEDIATE) {
+      // Resources used by this command list may still
+      // have their initial uploads pending, and those
+      // must be executed first.
+      static_cast<D3D11Device*>(m_parent)->FlushInitContext();
+      
       m_device->submitCommandList(
         m_context->endRecording(),
         nullptr, nullptr);
@@ -190,21 +196,83 @@ namespace dxvk {
       if (pMappedResource == nullptr)
         return S_OK;
       
-      if (buffer->isInUse()) {
-        if (MapFlags & D3D11_MAP_FLAG_DO_NOT_WAIT)
+      // Texel buffer views reference the physical buffer
+      // directly, so these buffers cannot be renamed.
+      const bool canRename = !(buffer->info().usage
+        & (VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT
+         | VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT));
+      
+      if (MapType == D3D11_MAP_WRITE_DISCARD && canRename) {
+        // Back the buffer with memory that is not in use by
+        // the GPU instead of waiting for pending commands
+        if (buffer->isInUse())
+          m_context->invalidateBuffer(buffer);
+      } else if (MapType != D3D11_MAP_WRITE_NO_OVERWRITE) {
+        // The application promises not to overwrite data that
+        // is in use with NO_OVERWRITE, so we do not need to
+        // synchronize in that case.
+        if (!WaitForResource(buffer->resource(), MapFlags))
           return DXGI_ERROR_WAS_STILL_DRAWING;
-        
-        this->Flush();
-        m_device->waitForIdle();
-        // TODO properly synchronize
       }
       
       pMappedResource->pData      = buffer->mapPtr(0);
       pMappedResource->RowPitch   = buffer->info().size;
       pMappedResource->DepthPitch = buffer->info().size;
       return S_OK;
+    } else if (resourceDim == D3D11_RESOURCE_DIMENSION_TEXTURE2D) {
+      D3D11Texture2D* resource = static_cast<D3D11Texture2D*>(pResource);
+      
+      D3D11_TEXTURE2D_DESC desc;
+      resource->GetDesc(&desc);
+      
+      if (desc.CPUAccessFlags == 0) {
+        Logger::err("D3D11: Cannot map a texture without CPU access");
+        return E_INVALIDARG;
+      }
+      
+      D3D11TextureMapping* mapping = resource->GetMapping(Subresource);
+      
+      if (mapping == nullptr)
+        return E_INVALIDARG;
+      
+      if (pMappedResource == nullptr)
+        return S_OK;
+      
+      const Rc<DxvkBuffer> buffer = mapping->buffer;
+      
+      if (MapType == D3D11_MAP_WRITE_DISCARD) {
+        if (buffer->isInUse())
+          m_context->invalidateBuffer(buffer);
+        
+        mapping->readback = false;
+      } else {
+        // Read the image back into the buffer. This is also
+        // required for write-only maps since Unmap uploads the
+        // entire buffer. The copy is only recorded once, so that
+        // applications can poll with DO_NOT_WAIT until the data
+        // is ready, unless the image gets written in between.
+        if (!mapping->readback) {
+          m_context->copyImageToBuffer(
+            buffer, 0, resource->GetDXVKImage(),
+            mapping->subresource, VkOffset3D { 0, 0, 0 },
+            mapping->extent);
+          mapping->readback = true;
+        }
+        
+        if (!WaitForResource(buffer->resource(), MapFlags))
+          return DXGI_ERROR_WAS_STILL_DRAWING;
+        
+        mapping->readback = false;
+      }
+      
+      mapping->mapType = MapType;
+      
+      pMappedResource->pData      = buffer->mapPtr(0);
+      pMappedResource->RowPitch   = mapping->rowPitch;
+      pMappedResource->DepthPitch = mapping->depthPitch;
+      return S_OK;
     } else {
-      Logger::err("D3D11: Mapping of image resources currently not supported");
+      Logger::err("D3D11: Mapping of this resource type currently not supported");
       return E_NOTIMPL;
     }
   }
@@ -213,9 +281,37 @@ namespace dxvk {
   void STDMETHODCALLTYPE D3D11DeviceContext::Unmap(
           ID3D11Resource*             pResource,
           UINT                        Subresource) {
-    // There's literally nothing we have to do here at the moment
-    this->Flush();
-    m_device->waitForIdle();
+    D3D11_RESOURCE_DIMENSION resourceDim = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+    pResource->GetType(&resourceDim);
+    
+    // Mapped buffers are host-coherent and any synchronization
+    // happens in Map, so only textures require any work here
+    if (resourceDim == D3D11_RESOURCE_DIMENSION_TEXTURE2D) {
+      D3D11Texture2D* resource = static_cast<D3D11Texture2D*>(pResource);
+      
+      D3D11_TEXTURE2D_DESC desc;
+      resource->GetDesc(&desc);
+      
+      if (desc.CPUAccessFlags == 0)
+        return;
+      
+      D3D11TextureMapping* mapping = resource->GetMapping(Subresource);
+      
+      if (mapping == nullptr || mapping->mapType == 0)
+        return;
+      
+      // Upload the written data to the image. Any readback
+      // recorded by a pending Map no longer matches the image.
+      if (mapping->mapType != D3D11_MAP_READ) {
+        m_context->copyBufferToImage(
+          resource->GetDXVKImage(),
+          mapping->subresource, VkOffset3D { 0, 0, 0 },
+          mapping->extent, mapping->buffer, 0);
+        mapping->readback = false;
+      }
+      
+      mapping->mapType = 0;
+    }
   }
   
   
@@ -1476,10 +1572,13 @@ namespace dxvk {
         // Figure out which part of the buffer to bind
         DxvkBufferBinding bindingInfo;
         
+        // Use the actual buffer size rather than the whole
+        // size, since the offset may change dynamically.
         if (buffer != nullptr) {
-          bindingInfo = DxvkBufferBinding(
-            buffer->GetDXVKBuffer(),
-            0, VK_WHOLE_SIZE);
+          const Rc<DxvkBuffer> dxvkBuffer = buffer->GetDXVKBuffer();
+          
+          bindingInfo = DxvkBufferBinding(dxvkBuffer,
+            0, dxvkBuffer->info().size);
         }
         
         // Bind buffer to the DXVK resource slot
@@ -1584,6 +1683,26 @@ namespace dxvk {
   }
   
   
+  bool D3D11DeviceContext::WaitForResource(
+    const Rc<DxvkResource>&                 Resource,
+          UINT                              MapFlags) {
+    if (!Resource->isInUse())
+      return true;
+    
+    // Only submit the current command list if it
+    // actually uses the resource, and only wait for
+    // the submissions that do.
+    if (Resource->isPending())
+      this->Flush();
+    
+    if (MapFlags & D3D11_MAP_FLAG_DO_NOT_WAIT)
+      return false;
+    
+    m_device->waitForResource(Resource);
+    return true;
+  }
+  
+  
   void D3D11DeviceContext::ApplyViewportState() {
     // We cannot set less than one viewport in Vulkan, and
     // rendering with no active viewport is illegal anyway.
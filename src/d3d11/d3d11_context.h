@@ -580,6 +580,10 @@ namespace dxvk {
     
     void ApplyViewportState();
     
+    bool WaitForResource(
+      const Rc<DxvkResource>&                 Resource,
+            UINT                              MapFlags);
+    
   };
   
 }
@@ -22,7 +22,10 @@ namespace dxvk {
     m_featureLevel  (featureLevel),
     m_featureFlags  (featureFlags),
     m_dxvkDevice    (m_dxgiDevice->GetDXVKDevice()),
-    m_dxvkAdapter   (m_dxvkDevice->adapter()) {
+    m_dxvkAdapter   (m_dxvkDevice->adapter()),
+    m_shaderCache   (new DxvkShaderCache(
+      DxvkPipelineCache::getCacheFilePath("dxvk.shadercache"),
+      DxbcGetCacheVersion())) {
     Com<IDXGIAdapter> adapter;
     
     if (FAILED(m_dxgiDevice->GetAdapter(&adapter))
@@ -35,10 +38,19 @@ namespace dxvk {
     
     m_context = new D3D11DeviceContext(this, m_dxvkDevice);
     m_resourceInitContext = m_dxvkDevice->createContext();
+    m_resourceInitContext->beginRecording(
+      m_dxvkDevice->createCommandList());
+    
+    if (m_dxvkDevice->hasTransferQueue())
+      m_resourceTransferContext = m_dxvkDevice->createTransferContext();
   }
   
   
   D3D11Device::~D3D11Device() {
+    // Resources created last may still have their
+    // initial uploads pending, which must not be lost
+    FlushInitContext();
+    
     m_presentDevice->SetDeviceLayer(nullptr);
     m_dxgiDevice->SetDeviceLayer(nullptr);
     delete m_context;
@@ -217,17 +229,6 @@ namespace dxvk {
                   |  VK_ACCESS_SHADER_WRITE_BIT;
     }
     
-    if (pDesc->CPUAccessFlags != 0) {
-      info.tiling  = VK_IMAGE_TILING_LINEAR;
-      info.stages |= VK_PIPELINE_STAGE_HOST_BIT;
-      
-      if (pDesc->CPUAccessFlags & D3D11_CPU_ACCESS_WRITE)
-        info.access |= VK_ACCESS_HOST_WRITE_BIT;
-      
-      if (pDesc->CPUAccessFlags & D3D11_CPU_ACCESS_READ)
-        info.access |= VK_ACCESS_HOST_READ_BIT;
-    }
-    
     if (pDesc->MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE)
       info.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
     
@@ -237,9 +238,11 @@ namespace dxvk {
     if (ppTexture2D != nullptr) {
       Com<IDXGIImageResourcePrivate> image;
       
+      // Images with CPU access are mapped through a buffer,
+      // so the image itself can always live in device memory
       HRESULT hr = DXGICreateImageResourcePrivate(
         m_dxgiDevice.ptr(), &info,
-        GetMemoryFlagsForUsage(pDesc->Usage), 0,
+        GetMemoryFlagsForUsage(D3D11_USAGE_DEFAULT), 0,
         &image);
       
       if (FAILED(hr))
@@ -1206,15 +1209,28 @@ namespace dxvk {
     const Rc<DxvkBuffer> buffer = pBuffer->GetDXVKBuffer();
     
     if (pInitialData != nullptr) {
-      std::lock_guard<std::mutex> lock(m_resourceInitMutex);;
-      m_resourceInitContext->beginRecording(
-        m_dxvkDevice->createCommandList());
-      m_resourceInitContext->updateBuffer(
-        buffer, 0, buffer->info().size,
-        pInitialData->pSysMem);
-      m_dxvkDevice->submitCommandList(
-        m_resourceInitContext->endRecording(),
-        nullptr, nullptr);
+      // Host-visible buffers are not used by the GPU yet,
+      // so we can write the initial data directly.
+      if (buffer->memFlags() & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+        std::memcpy(buffer->mapPtr(0),
+          pInitialData->pSysMem,
+          buffer->info().size);
+        return;
+      }
+      
+      std::lock_guard<std::mutex> lock(m_resourceInitMutex);
+      
+      if (m_resourceTransferContext != nullptr) {
+        m_resourceTransferContext->updateBuffer(
+          buffer, 0, buffer->info().size,
+          pInitialData->pSysMem);
+      } else {
+        m_resourceInitContext->updateBuffer(
+          buffer, 0, buffer->info().size,
+          pInitialData->pSysMem);
+      }
+      
+      TrackInitCommand(buffer->info().size);
     }
   }
   
@@ -1222,13 +1238,18 @@ namespace dxvk {
   void D3D11Device::InitTexture(
           IDXGIImageResourcePrivate*  pImage,
     const D3D11_SUBRESOURCE_DATA*     pInitialData) {
-    std::lock_guard<std::mutex> lock(m_resourceInitMutex);;
-    m_resourceInitContext->beginRecording(
-      m_dxvkDevice->createCommandList());
+    std::lock_guard<std::mutex> lock(m_resourceInitMutex);
     
     const Rc<DxvkImage> image = pImage->GetDXVKImage();
     const DxvkFormatInfo* formatInfo = imageFormatInfo(image->info().format);
     
+    VkDeviceSize uploadSize = 0;
+    
+    // Queues without graphics support may not copy
+    // to the depth or stencil aspect of an image
+    const bool useTransferQueue = m_resourceTransferContext != nullptr
+      && !(formatInfo->aspectMask & (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT));
+    
     if (pInitialData != nullptr) {
       // pInitialData is an array that stores an entry for
       // every single subresource. Since we will define all
@@ -1247,13 +1268,27 @@ namespace dxvk {
           const uint32_t id = D3D11CalcSubresource(
             level, layer, image->info().mipLevels);
           
-          m_resourceInitContext->updateImage(
-            image, subresourceLayers,
-            VkOffset3D { 0, 0, 0 },
-            image->mipLevelExtent(level),
-            pInitialData[id].pSysMem,
-            pInitialData[id].SysMemPitch,
-            pInitialData[id].SysMemSlicePitch);
+          const VkExtent3D extent = image->mipLevelExtent(level);
+          
+          if (useTransferQueue) {
+            m_resourceTransferContext->updateImage(
+              image, subresourceLayers,
+              pInitialData[id].pSysMem,
+              pInitialData[id].SysMemPitch,
+              pInitialData[id].SysMemSlicePitch);
+          } else {
+            m_resourceInitContext->updateImage(
+              image, subresourceLayers,
+              VkOffset3D { 0, 0, 0 }, extent,
+              pInitialData[id].pSysMem,
+              pInitialData[id].SysMemPitch,
+              pInitialData[id].SysMemSlicePitch);
+          }
+          
+          uploadSize += formatInfo->elementSize
+            * ((extent.width  + formatInfo->blockSize.width  - 1) / formatInfo->blockSize.width)
+            * ((extent.height + formatInfo->blockSize.height - 1) / formatInfo->blockSize.height)
+            * ((extent.depth  + formatInfo->blockSize.depth  - 1) / formatInfo->blockSize.depth);
         }
       }
     } else {
@@ -1267,9 +1302,60 @@ namespace dxvk {
       m_resourceInitContext->initImage(image, subresources);
     }
     
+    TrackInitCommand(uploadSize);
+  }
+  
+  
+  void D3D11Device::FlushInitContext() {
+    std::lock_guard<std::mutex> lock(m_resourceInitMutex);
+    
+    if (m_resourceInitCommands != 0)
+      SubmitInitContext();
+  }
+  
+  
+  void D3D11Device::TrackInitCommand(
+          VkDeviceSize                UploadSize) {
+    // Submit pending uploads once they have accumulated a
+    // significant amount of staging memory, or once they
+    // have been waiting for a while, so that resources
+    // created during loading screens become available
+    // without the application having to flush.
+    constexpr VkDeviceSize MaxPendingUploads = 16 * 1024 * 1024;
+    constexpr uint64_t     MaxPendingTimeUs  = 2000;
+    
+    auto now = std::chrono::high_resolution_clock::now();
+    
+    if (m_resourceInitCommands++ == 0)
+      m_resourceInitTime = now;
+    
+    m_resourceInitUploads += UploadSize;
+    
+    const uint64_t pendingTimeUs = std::chrono::duration_cast<
+      std::chrono::microseconds>(now - m_resourceInitTime).count();
+    
+    if (m_resourceInitUploads >= MaxPendingUploads
+     || pendingTimeUs         >= MaxPendingTimeUs)
+      SubmitInitContext();
+  }
+  
+  
+  void D3D11Device::SubmitInitContext() {
+    // Uploads on the transfer queue are acquired by a
+    // graphics command list, which must be submitted
+    // before any command list using those resources.
+    if (m_resourceTransferContext != nullptr)
+      m_resourceTransferContext->submit();
+    
     m_dxvkDevice->submitCommandList(
       m_resourceInitContext->endRecording(),
       nullptr, nullptr);
+    
+    m_resourceInitContext->beginRecording(
+      m_dxvkDevice->createCommandList());
+    
+    m_resourceInitCommands = 0;
+    m_resourceInitUploads  = 0;
   }
   
   
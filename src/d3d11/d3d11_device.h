@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+
 #include "../dxgi/dxgi_object.h"
 #include "../dxgi/dxgi_resource.h"
 
@@ -222,6 +224,22 @@ namespace dxvk {
       return m_dxvkDevice;
     }
     
+    Rc<DxvkShaderCache> GetShaderCache() {
+      return m_shaderCache;
+    }
+    
+    VkMemoryPropertyFlags GetMemoryFlagsForUsage(
+            D3D11_USAGE             usage) const;
+    
+    /**
+     * \brief Submits pending resource initialization
+     * 
+     * Resource creation only records initial uploads. This
+     * must be called before any command list that may use
+     * one of the newly created resources is submitted.
+     */
+    void FlushInitContext();
+    
     static bool CheckFeatureLevelSupport(
       const Rc<DxvkAdapter>&  adapter,
             D3D_FEATURE_LEVEL featureLevel);
@@ -241,11 +259,17 @@ namespace dxvk {
     
     const Rc<DxvkDevice>            m_dxvkDevice;
     const Rc<DxvkAdapter>           m_dxvkAdapter;
+    const Rc<DxvkShaderCache>       m_shaderCache;
     
     D3D11DeviceContext*             m_context = nullptr;
     
     std::mutex                      m_resourceInitMutex;
     Rc<DxvkContext>                 m_resourceInitContext;
+    Rc<DxvkTransferContext>         m_resourceTransferContext;
+    uint64_t                        m_resourceInitCommands = 0;
+    VkDeviceSize                    m_resourceInitUploads  = 0;
+    
+    std::chrono::high_resolution_clock::time_point m_resourceInitTime;
     
     D3D11StateObjectSet<D3D11BlendState>        m_bsStateObjects;
     D3D11StateObjectSet<D3D11DepthStencilState> m_dsStateObjects;
@@ -265,6 +289,11 @@ namespace dxvk {
             IDXGIImageResourcePrivate*  pImage,
       const D3D11_SUBRESOURCE_DATA*     pInitialData);
     
+    void TrackInitCommand(
+            VkDeviceSize                UploadSize);
+    
+    void SubmitInitContext();
+    
     HRESULT GetShaderResourceViewDescFromResource(
             ID3D11Resource*                   pResource,
             D3D11_SHADER_RESOURCE_VIEW_DESC*  pDesc);
@@ -287,9 +316,6 @@ namespace dxvk {
     
     VkPipelineStageFlags GetEnabledShaderStages() const;
     
-    VkMemoryPropertyFlags GetMemoryFlagsForUsage(
-            D3D11_USAGE             usage) const;
-    
     VkSamplerAddressMode DecodeAddressMode(
             D3D11_TEXTURE_ADDRESS_MODE  mode) const;
     
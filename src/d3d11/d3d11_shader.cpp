@@ -17,17 +17,44 @@ namespace dxvk {
       BytecodeLength);
     
     DxbcModule module(reader);
-    m_shader = module.compile();
     
-    // If requested by the user, dump both the raw DXBC
-    // shader and the compiled SPIR-V module to a file.
+    const Sha1Hash hash = ComputeShaderHash(
+      pShaderBytecode, BytecodeLength);
+    
     const std::string dumpPath
       = env::getEnvVar(L"DXVK_SHADER_DUMP_PATH");
+    const std::string readPath
+      = env::getEnvVar(L"DXVK_SHADER_READ_PATH");
+    
+    // Only compile the shader if it is not cached yet
+    const Rc<DxvkShaderCache> shaderCache = pDevice->GetShaderCache();
+    m_shader = shaderCache->lookup(hash);
+    
+    if (m_shader == nullptr) {
+      if (dumpPath.size() == 0 && readPath.size() == 0) {
+        // Compile the shader on a worker thread. It will
+        // only be waited on once a pipeline is created.
+        m_shader = new DxvkShader(module.version().shaderStage());
+        
+        pDevice->GetDXVKDevice()->queueShaderCompilation(
+          m_shader, BytecodeLength / sizeof(uint32_t),
+          [module, hash, shaderCache] () {
+            Rc<DxvkShader> shader = module.compile();
+            shaderCache->store(hash, shader);
+            return shader;
+          });
+      } else {
+        // The code is needed right away
+        m_shader = module.compile();
+        shaderCache->store(hash, m_shader);
+      }
+    }
     
+    // If requested by the user, dump both the raw DXBC
+    // shader and the compiled SPIR-V module to a file.
     if (dumpPath.size() != 0) {
       const std::string baseName = str::format(dumpPath, "/",
-        ConstructFileName(ComputeShaderHash(pShaderBytecode, BytecodeLength),
-        module.version().type()));
+        ConstructFileName(hash, module.version().type()));
       
       reader.store(std::ofstream(str::format(baseName, ".dxbc"),
         std::ios_base::binary | std::ios_base::trunc));
@@ -39,18 +66,20 @@ namespace dxvk {
     
     // If requested by the user, replace
     // the shader with another file.
-    const std::string readPath
-      = env::getEnvVar(L"DXVK_SHADER_READ_PATH");
-    
     if (readPath.size() != 0) {
       const std::string baseName = str::format(readPath, "/",
-        ConstructFileName(ComputeShaderHash(pShaderBytecode, BytecodeLength),
-        module.version().type()));
+        ConstructFileName(hash, module.version().type()));
       
       m_shader->read(std::ifstream(
         str::format(baseName, ".spv"),
         std::ios_base::binary));
     }
+    
+    // Identify the shader by its DXBC hash so that pipelines
+    // using it can be recorded in the state cache, and so
+    // that cached pipelines can be compiled ahead of time.
+    m_shader->setShaderKey(hash);
+    m_shader = pDevice->GetDXVKDevice()->registerShader(m_shader);
   }
   
   
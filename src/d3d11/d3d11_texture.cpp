@@ -65,4 +65,72 @@ namespace dxvk {
     return m_resource->GetDXVKImage();
   }
   
+  
+  D3D11TextureMapping* D3D11Texture2D::GetMapping(UINT Subresource) {
+    const Rc<DxvkImage> image = GetDXVKImage();
+    
+    const UINT subresourceCount = image->info().mipLevels
+                                * image->info().numLayers;
+    
+    if (Subresource >= subresourceCount)
+      return nullptr;
+    
+    if (m_mappings.size() == 0)
+      m_mappings.resize(subresourceCount);
+    
+    D3D11TextureMapping* mapping = &m_mappings.at(Subresource);
+    
+    if (mapping->buffer == nullptr)
+      CreateMapping(mapping, Subresource);
+    
+    return mapping;
+  }
+  
+  
+  void D3D11Texture2D::CreateMapping(
+          D3D11TextureMapping*        pMapping,
+          UINT                        Subresource) {
+    const Rc<DxvkImage> image = GetDXVKImage();
+    const DxvkFormatInfo* formatInfo = imageFormatInfo(image->info().format);
+    
+    const UINT level = Subresource % image->info().mipLevels;
+    const UINT layer = Subresource / image->info().mipLevels;
+    
+    pMapping->subresource.aspectMask     = formatInfo->aspectMask;
+    pMapping->subresource.mipLevel       = level;
+    pMapping->subresource.baseArrayLayer = layer;
+    pMapping->subresource.layerCount     = 1;
+    pMapping->extent = image->mipLevelExtent(level);
+    
+    // Compressed formats are stored as blocks, and partial
+    // blocks at the edges of the image take up a full block
+    const VkExtent3D blockCount = {
+      (pMapping->extent.width  + formatInfo->blockSize.width  - 1) / formatInfo->blockSize.width,
+      (pMapping->extent.height + formatInfo->blockSize.height - 1) / formatInfo->blockSize.height,
+      (pMapping->extent.depth  + formatInfo->blockSize.depth  - 1) / formatInfo->blockSize.depth };
+    
+    pMapping->rowPitch   = blockCount.width  * formatInfo->elementSize;
+    pMapping->depthPitch = blockCount.height * pMapping->rowPitch;
+    
+    DxvkBufferCreateInfo info;
+    info.size   = blockCount.depth * pMapping->depthPitch;
+    info.usage  = VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+                | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    info.stages = VK_PIPELINE_STAGE_TRANSFER_BIT
+                | VK_PIPELINE_STAGE_HOST_BIT;
+    info.access = VK_ACCESS_TRANSFER_READ_BIT
+                | VK_ACCESS_TRANSFER_WRITE_BIT
+                | VK_ACCESS_HOST_READ_BIT
+                | VK_ACCESS_HOST_WRITE_BIT;
+    
+    // Data that is read back by the CPU benefits from
+    // cached memory, which is what staging memory uses
+    const D3D11_USAGE memoryUsage = (m_desc.CPUAccessFlags & D3D11_CPU_ACCESS_READ)
+      ? D3D11_USAGE_STAGING
+      : D3D11_USAGE_DYNAMIC;
+    
+    pMapping->buffer = m_device->GetDXVKDevice()->createBuffer(
+      info, m_device->GetMemoryFlagsForUsage(memoryUsage));
+  }
+  
 }
@@ -10,6 +10,34 @@ namespace dxvk {
   class D3D11Device;
   
   
+  /**
+   * \brief Mapped texture subresource
+   * 
+   * Textures with CPU access are not mapped directly.
+   * Instead, each subresource is backed by a host-visible
+   * buffer which stores the texels in a tightly packed
+   * layout and which is copied to or from the image.
+   */
+  struct D3D11TextureMapping {
+    /// Host-visible buffer storing the data
+    Rc<DxvkBuffer>            buffer;
+    /// Image subresource backed by the buffer
+    VkImageSubresourceLayers  subresource;
+    /// Size of the subresource, in texels
+    VkExtent3D                extent;
+    /// Row pitch of the buffer data
+    UINT                      rowPitch    = 0;
+    /// Depth pitch of the buffer data
+    UINT                      depthPitch  = 0;
+    /// Current map type, or zero if not mapped
+    UINT                      mapType     = 0;
+    /// Whether a readback has been recorded but its data
+    /// has not been returned by Map yet. Must be reset
+    /// whenever the image subresource is written.
+    bool                      readback    = false;
+  };
+  
+  
   class D3D11Texture2D : public D3D11DeviceChild<ID3D11Texture2D> {
     
   public:
@@ -39,12 +67,28 @@ namespace dxvk {
     
     Rc<DxvkImage> GetDXVKImage();
     
+    /**
+     * \brief Retrieves mapping info for a subresource
+     * 
+     * Creates the host-visible buffer on first use.
+     * \param [in] Subresource Subresource index
+     * \returns Mapping info, or \c nullptr if the
+     *          subresource index is out of range
+     */
+    D3D11TextureMapping* GetMapping(UINT Subresource);
+    
   private:
     
     Com<D3D11Device>                m_device;
     Com<IDXGIImageResourcePrivate>  m_resource;
     D3D11_TEXTURE2D_DESC            m_desc;
     
+    std::vector<D3D11TextureMapping> m_mappings;
+    
+    void CreateMapping(
+            D3D11TextureMapping*        pMapping,
+            UINT                        Subresource);
+    
   };
   
 }
@@ -1,8 +1,24 @@
 #include "dxbc_compiler.h"
 #include "dxbc_module.h"
 
+#include "../util/util_env.h"
+
 namespace dxvk {
   
+  SpirvOptPasses DxbcGetOptimizerPasses() {
+    // Passes can be selected for debugging purposes
+    static const SpirvOptPasses s_passes = SpirvOptimizer::parsePassList(
+      env::getEnvVar(L"DXVK_SPIRV_PASSES"));
+    return s_passes;
+  }
+  
+  
+  uint32_t DxbcGetCacheVersion() {
+    return DxbcCompilerVersion
+      | (DxbcGetOptimizerPasses().raw() << 16);
+  }
+  
+  
   DxbcModule::DxbcModule(DxbcReader& reader)
   : m_header(reader) {
     for (uint32_t i = 0; i < m_header.numChunks(); i++) {
@@ -2,6 +2,8 @@
 
 #include "../dxvk/dxvk_shader.h"
 
+#include "../spirv/spirv_optimizer.h"
+
 #include "dxbc_chunk_isgn.h"
 #include "dxbc_chunk_shex.h"
 #include "dxbc_header.h"
@@ -13,6 +15,35 @@
 
 namespace dxvk {
   
+  /**
+   * \brief DXBC compiler version
+   * 
+   * Stored in the shader cache in order to discard shaders
+   * compiled by older versions. Must be incremented whenever
+   * the generated SPIR-V code or resource slots change.
+   */
+  constexpr uint32_t DxbcCompilerVersion = 4;
+  
+  /**
+   * \brief SPIR-V optimizer passes
+   * 
+   * Parsed once from \c DXVK_SPIRV_PASSES. All
+   * passes are enabled if the variable is not set.
+   * \returns Passes to run on compiled shaders
+   */
+  SpirvOptPasses DxbcGetOptimizerPasses();
+  
+  /**
+   * \brief Shader cache version
+   * 
+   * Combines the compiler version with the enabled
+   * optimizer passes, since those change the generated
+   * SPIR-V code as well. Changing \c DXVK_SPIRV_PASSES
+   * therefore discards previously cached shaders.
+   * \returns Version to store in the shader cache
+   */
+  uint32_t DxbcGetCacheVersion();
+  
   /**
    * \brief DXBC shader module
    * 
@@ -32,6 +63,8 @@ namespace dxvk {
      * \returns Shader type and version
      */
     DxbcProgramVersion version() const {
+      if (m_shexChunk == nullptr)
+        throw DxvkError("DxbcModule::version: No SHDR/SHEX chunk");
       return m_shexChunk->version();
     }
     
@@ -4,6 +4,8 @@
 
 #include "../dxbc_names.h"
 
+#include "../dxbc_module.h"
+
 namespace dxvk {
   
   DxbcCodeGen::DxbcCodeGen(DxbcProgramType shaderStage)
@@ -75,7 +77,7 @@ namespace dxvk {
     // Store descriptor info for the shader interface
     DxvkResourceSlot resource;
     resource.slot = bindingId;
-    resource.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    resource.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     m_resourceSlots.push_back(resource);
   }
   
@@ -704,4 +706,22 @@ namespace dxvk {
     return result;
   }
   
+  
+  SpirvCodeBuffer DxbcCodeGen::compileModule() {
+    SpirvOptimizer optimizer(DxbcGetOptimizerPasses());
+    SpirvCodeBuffer code = optimizer.optimize(m_module.compile());
+    
+    for (uint32_t i = 0; i < SpirvOptPassCount; i++) {
+      const SpirvOptPassStats& stats = optimizer.stats().at(i);
+      
+      if (stats.insBefore != stats.insAfter) {
+        Logger::trace(str::format("DxbcCodeGen: ",
+          SpirvOptimizer::passName(SpirvOptPass(i)), ": ",
+          stats.insBefore, " -> ", stats.insAfter, " instructions"));
+      }
+    }
+    
+    return code;
+  }
+  
 }
\ No newline at end of file
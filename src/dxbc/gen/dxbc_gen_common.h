@@ -7,6 +7,7 @@
 #include "../dxbc_util.h"
 
 #include "../../spirv/spirv_module.h"
+#include "../../spirv/spirv_optimizer.h"
 
 namespace dxvk {
   
@@ -223,6 +224,8 @@ namespace dxvk {
       const DxbcValueType&          type,
             spv::StorageClass       storageClass);
     
+    SpirvCodeBuffer compileModule();
+    
   };
   
 }
\ No newline at end of file
@@ -171,7 +171,7 @@ namespace dxvk {
       VK_SHADER_STAGE_FRAGMENT_BIT,
       m_resourceSlots.size(),
       m_resourceSlots.data(),
-      m_module.compile());
+      this->compileModule());
   }
   
   
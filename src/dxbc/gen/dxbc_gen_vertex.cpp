@@ -139,7 +139,7 @@ namespace dxvk {
       VK_SHADER_STAGE_VERTEX_BIT,
       m_resourceSlots.size(),
       m_resourceSlots.data(),
-      m_module.compile());
+      this->compileModule());
   }
   
   
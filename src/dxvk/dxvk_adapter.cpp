@@ -84,6 +84,29 @@ namespace dxvk {
   }
   
   
+  uint32_t DxvkAdapter::transferQueueFamily() const {
+    const VkQueueFlags exclude
+      = VK_QUEUE_GRAPHICS_BIT
+      | VK_QUEUE_COMPUTE_BIT;
+    
+    for (uint32_t i = 0; i < m_queueFamilies.size(); i++) {
+      const VkQueueFamilyProperties& family = m_queueFamilies[i];
+      
+      // Image copies on the transfer queue must be able to
+      // address individual texels, otherwise we cannot use
+      // it to upload arbitrary mip levels.
+      const VkExtent3D granularity = family.minImageTransferGranularity;
+      
+      if ((family.queueFlags & VK_QUEUE_TRANSFER_BIT)
+       && (family.queueFlags & exclude) == 0
+       && granularity.width == 1 && granularity.height == 1 && granularity.depth == 1)
+        return i;
+    }
+    
+    return this->graphicsQueueFamily();
+  }
+  
+  
   bool DxvkAdapter::checkFeatureSupport(
     const VkPhysicalDeviceFeatures& required) const {
     const VkPhysicalDeviceFeatures supported = this->features();
@@ -147,13 +170,15 @@ namespace dxvk {
   
   
   Rc<DxvkDevice> DxvkAdapter::createDevice(const VkPhysicalDeviceFeatures& enabledFeatures) {
-    auto enabledExtensions = this->enableExtensions();
+    DxvkDeviceExtensions extensions;
+    auto enabledExtensions = this->enableExtensions(extensions);
     
     float queuePriority = 1.0f;
     std::vector<VkDeviceQueueCreateInfo> queueInfos;
     
     const uint32_t gIndex = this->graphicsQueueFamily();
     const uint32_t pIndex = this->presentQueueFamily();
+    const uint32_t tIndex = this->transferQueueFamily();
     
     VkDeviceQueueCreateInfo graphicsQueue;
     graphicsQueue.sType             = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
@@ -170,6 +195,12 @@ namespace dxvk {
       queueInfos.push_back(presentQueue);
     }
     
+    if (tIndex != gIndex && tIndex != pIndex) {
+      VkDeviceQueueCreateInfo transferQueue = graphicsQueue;
+      transferQueue.queueFamilyIndex        = tIndex;
+      queueInfos.push_back(transferQueue);
+    }
+    
     VkDeviceCreateInfo info;
     info.sType                      = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     info.pNext                      = nullptr;
@@ -186,7 +217,7 @@ namespace dxvk {
     
     if (m_vki->vkCreateDevice(m_handle, &info, nullptr, &device) != VK_SUCCESS)
       throw DxvkError("DxvkDevice::createDevice: Failed to create device");
-    return new DxvkDevice(this, new vk::DeviceFn(m_vki->instance(), device), enabledFeatures);
+    return new DxvkDevice(this, new vk::DeviceFn(m_vki->instance(), device), extensions, enabledFeatures);
   }
   
   
@@ -195,8 +226,15 @@ namespace dxvk {
   }
   
   
-  vk::NameList DxvkAdapter::enableExtensions() {
-    std::vector<const char*> extOptional = { };
+  vk::NameList DxvkAdapter::enableExtensions(DxvkDeviceExtensions& extensions) {
+    std::vector<const char*> extOptional = {
+      VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME,
+    };
+    
+    // Push descriptors depend on an optional instance extension
+    if (m_instance->extensions().khrGetPhysicalDeviceProperties2)
+      extOptional.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    
     std::vector<const char*> extRequired = {
       VK_KHR_SWAPCHAIN_EXTENSION_NAME,
       VK_KHR_MAINTENANCE1_EXTENSION_NAME,
@@ -217,6 +255,11 @@ namespace dxvk {
       extensionsEnabled.add(e);
     }
     
+    extensions.khrDescriptorUpdateTemplate = extensionsAvailable
+      .supports(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+    extensions.khrPushDescriptor = extensionsAvailable
+      .supports(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)
+      && m_instance->extensions().khrGetPhysicalDeviceProperties2;
     return extensionsEnabled;
   }
   
@@ -2,6 +2,7 @@
 
 #include "./vulkan/dxvk_vulkan_extensions.h"
 
+#include "dxvk_extensions.h"
 #include "dxvk_include.h"
 
 namespace dxvk {
@@ -107,6 +108,17 @@ namespace dxvk {
      */
     uint32_t presentQueueFamily() const;
     
+    /**
+     * \brief Transfer queue family index
+     * 
+     * Returns a queue family that only supports transfer
+     * operations, which allows uploads to run alongside
+     * rendering. If the device does not expose a suitable
+     * family, this is the graphics queue family.
+     * \returns Transfer queue family index
+     */
+    uint32_t transferQueueFamily() const;
+    
     /**
      * \brief Tests whether all required features are supported
      * 
@@ -145,7 +157,8 @@ namespace dxvk {
     
     std::vector<VkQueueFamilyProperties> m_queueFamilies;
     
-    vk::NameList enableExtensions();
+    vk::NameList enableExtensions(
+            DxvkDeviceExtensions& extensions);
     
   };
   
@@ -67,6 +67,64 @@ namespace dxvk {
   }
   
   
+  void DxvkBarrierSet::transferBufferOwnership(
+    const Rc<DxvkBuffer>&           buffer,
+          VkDeviceSize              offset,
+          VkDeviceSize              size,
+          uint32_t                  srcQueueFamily,
+          VkPipelineStageFlags      srcStages,
+          VkAccessFlags             srcAccess,
+          uint32_t                  dstQueueFamily,
+          VkPipelineStageFlags      dstStages,
+          VkAccessFlags             dstAccess) {
+    m_srcStages |= srcStages;
+    m_dstStages |= dstStages;
+    
+    // Both the release and the acquire operation
+    // need a barrier, even if no memory is written.
+    VkBufferMemoryBarrier barrier;
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.pNext               = nullptr;
+    barrier.srcAccessMask       = srcAccess;
+    barrier.dstAccessMask       = dstAccess;
+    barrier.srcQueueFamilyIndex = srcQueueFamily;
+    barrier.dstQueueFamilyIndex = dstQueueFamily;
+    barrier.buffer              = buffer->handle();
+    barrier.offset              = offset;
+    barrier.size                = size;
+    m_bufBarriers.push_back(barrier);
+  }
+  
+  
+  void DxvkBarrierSet::transferImageOwnership(
+    const Rc<DxvkImage>&            image,
+    const VkImageSubresourceRange&  subresources,
+          uint32_t                  srcQueueFamily,
+          VkImageLayout             srcLayout,
+          VkPipelineStageFlags      srcStages,
+          VkAccessFlags             srcAccess,
+          uint32_t                  dstQueueFamily,
+          VkImageLayout             dstLayout,
+          VkPipelineStageFlags      dstStages,
+          VkAccessFlags             dstAccess) {
+    m_srcStages |= srcStages;
+    m_dstStages |= dstStages;
+    
+    VkImageMemoryBarrier barrier;
+    barrier.sType                 = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.pNext                 = nullptr;
+    barrier.srcAccessMask         = srcAccess;
+    barrier.dstAccessMask         = dstAccess;
+    barrier.oldLayout             = srcLayout;
+    barrier.newLayout             = dstLayout;
+    barrier.srcQueueFamilyIndex   = srcQueueFamily;
+    barrier.dstQueueFamilyIndex   = dstQueueFamily;
+    barrier.image                 = image->handle();
+    barrier.subresourceRange      = subresources;
+    m_imgBarriers.push_back(barrier);
+  }
+  
+  
   void DxvkBarrierSet::recordCommands(const Rc<DxvkCommandList>& commandList) {
     if ((m_srcStages | m_dstStages) != 0) {
       VkPipelineStageFlags srcFlags = m_srcStages;
@@ -39,6 +39,29 @@ namespace dxvk {
             VkPipelineStageFlags      dstStages,
             VkAccessFlags             dstAccess);
     
+    void transferBufferOwnership(
+      const Rc<DxvkBuffer>&           buffer,
+            VkDeviceSize              offset,
+            VkDeviceSize              size,
+            uint32_t                  srcQueueFamily,
+            VkPipelineStageFlags      srcStages,
+            VkAccessFlags             srcAccess,
+            uint32_t                  dstQueueFamily,
+            VkPipelineStageFlags      dstStages,
+            VkAccessFlags             dstAccess);
+    
+    void transferImageOwnership(
+      const Rc<DxvkImage>&            image,
+      const VkImageSubresourceRange&  subresources,
+            uint32_t                  srcQueueFamily,
+            VkImageLayout             srcLayout,
+            VkPipelineStageFlags      srcStages,
+            VkAccessFlags             srcAccess,
+            uint32_t                  dstQueueFamily,
+            VkImageLayout             dstLayout,
+            VkPipelineStageFlags      dstStages,
+            VkAccessFlags             dstAccess);
+    
     void recordCommands(
       const Rc<DxvkCommandList>&      commandList);
     
@@ -20,6 +20,15 @@ namespace dxvk {
   
   /**
    * \brief Shader resource slots
+   * 
+   * Stores bound resources and their descriptors, and
+   * tracks which slots were modified since the last
+   * time descriptors were written. Buffer slots where
+   * only the offset changed are tracked separately,
+   * since these may not require a descriptor update.
+   * Slots with a buffer bound are tracked as well, so that
+   * invalidated buffers can be found without scanning all
+   * slots.
    */
   class DxvkShaderResourceSlots {
     
@@ -29,6 +38,9 @@ namespace dxvk {
     DxvkShaderResourceSlots(size_t n) {
       m_resources  .resize(n);
       m_descriptors.resize(n);
+      m_dirty       = bit::BitVector(n);
+      m_dirtyOffset = bit::BitVector(n);
+      m_buffers     = bit::BitVector(n);
     }
     
     uint32_t descriptorCount() const {
@@ -49,12 +61,86 @@ namespace dxvk {
       const DxvkDescriptorInfo&     descriptor) {
       m_resources   .at(slot) = resource;
       m_descriptors .at(slot) = descriptor;
+      m_dirty.set(slot);
+      
+      if (resource.bufferSlice.bufferHandle() != VK_NULL_HANDLE)
+        m_buffers.set(slot);
+      else
+        m_buffers.clr(slot);
+    }
+    
+    /**
+     * \brief Changes the offset of a bound buffer
+     * 
+     * The new binding must only differ from the
+     * currently bound one in its buffer offset.
+     * \param [in] slot Resource slot
+     * \param [in] resource New buffer binding
+     * \param [in] descriptor New descriptor
+     */
+    void bindBufferOffset(
+            uint32_t                slot,
+      const DxvkShaderResourceSlot& resource,
+      const DxvkDescriptorInfo&     descriptor) {
+      m_resources   .at(slot) = resource;
+      m_descriptors .at(slot) = descriptor;
+      m_dirtyOffset.set(slot);
+    }
+    
+    /**
+     * \brief Checks whether any slot was modified
+     * \returns \c true if any slot is dirty
+     */
+    bool isDirty() const {
+      return m_dirty.any() || m_dirtyOffset.any();
+    }
+    
+    /**
+     * \brief Iterates over modified slots
+     * \param [in] fn Function taking the slot index
+     */
+    template<typename Fn>
+    void forEachDirtySlot(const Fn& fn) const {
+      m_dirty.forEach(fn);
+    }
+    
+    /**
+     * \brief Iterates over slots with modified offsets
+     * \param [in] fn Function taking the slot index
+     */
+    template<typename Fn>
+    void forEachDirtyOffset(const Fn& fn) const {
+      m_dirtyOffset.forEach(fn);
+    }
+    
+    /**
+     * \brief Iterates over slots with a bound buffer
+     * 
+     * Only includes buffers bound as uniform or storage
+     * buffers, not buffer views. Slots may be rebound
+     * from within the function.
+     * \param [in] fn Function taking the slot index
+     */
+    template<typename Fn>
+    void forEachBufferSlot(const Fn& fn) const {
+      m_buffers.forEach(fn);
+    }
+    
+    /**
+     * \brief Marks all slots as clean
+     */
+    void clearDirty() {
+      m_dirty.clrAll();
+      m_dirtyOffset.clrAll();
     }
     
   private:
     
     std::vector<DxvkShaderResourceSlot> m_resources;
     std::vector<DxvkDescriptorInfo>     m_descriptors;
+    bit::BitVector                      m_dirty;
+    bit::BitVector                      m_dirtyOffset;
+    bit::BitVector                      m_buffers;
     
   };
   
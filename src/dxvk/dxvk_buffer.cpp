@@ -2,12 +2,12 @@
 
 namespace dxvk {
   
-  DxvkBuffer::DxvkBuffer(
+  DxvkPhysicalBuffer::DxvkPhysicalBuffer(
     const Rc<vk::DeviceFn>&     vkd,
     const DxvkBufferCreateInfo& createInfo,
           DxvkMemoryAllocator&  memAlloc,
           VkMemoryPropertyFlags memFlags)
-  : m_vkd(vkd), m_info(createInfo) {
+  : m_vkd(vkd) {
     
     VkBufferCreateInfo info;
     info.sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -19,9 +19,15 @@ namespace dxvk {
     info.queueFamilyIndexCount = 0;
     info.pQueueFamilyIndices   = nullptr;
     
+    if (createInfo.queueFamilies.size() > 1) {
+      info.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+      info.queueFamilyIndexCount = createInfo.queueFamilies.size();
+      info.pQueueFamilyIndices   = createInfo.queueFamilies.data();
+    }
+    
     if (m_vkd->vkCreateBuffer(m_vkd->device(),
           &info, nullptr, &m_buffer) != VK_SUCCESS)
-      throw DxvkError("DxvkBuffer::DxvkBuffer: Failed to create buffer");
+      throw DxvkError("DxvkPhysicalBuffer::DxvkPhysicalBuffer: Failed to create buffer");
     
     VkMemoryRequirements memReq;
     m_vkd->vkGetBufferMemoryRequirements(
@@ -30,16 +36,72 @@ namespace dxvk {
     
     if (m_vkd->vkBindBufferMemory(m_vkd->device(),
           m_buffer, m_memory.memory(), m_memory.offset()) != VK_SUCCESS)
-      throw DxvkError("DxvkBuffer::DxvkBuffer: Failed to bind device memory");
+      throw DxvkError("DxvkPhysicalBuffer::DxvkPhysicalBuffer: Failed to bind device memory");
   }
   
   
-  DxvkBuffer::~DxvkBuffer() {
+  DxvkPhysicalBuffer::~DxvkPhysicalBuffer() {
     if (m_buffer != VK_NULL_HANDLE)
       m_vkd->vkDestroyBuffer(m_vkd->device(), m_buffer, nullptr);
   }
   
   
+  DxvkBuffer::DxvkBuffer(
+    const Rc<vk::DeviceFn>&     vkd,
+    const DxvkBufferCreateInfo& createInfo,
+          DxvkMemoryAllocator&  memAlloc,
+          VkMemoryPropertyFlags memFlags)
+  : m_vkd     (vkd),
+    m_info    (createInfo),
+    m_memAlloc(&memAlloc),
+    m_memFlags(memFlags) {
+    m_physBuffer = this->allocPhysicalBuffer();
+    m_physBuffers.push_back(m_physBuffer);
+  }
+  
+  
+  DxvkBuffer::~DxvkBuffer() {
+    
+  }
+  
+  
+  void DxvkBuffer::rename() {
+    // Physical buffers are released by the command lists
+    // using them once their fence has been signaled, so
+    // any buffer that is not in use can be reused. Idle
+    // buffers beyond a small number are freed, so that
+    // a peak of discards does not keep them alive forever.
+    Rc<DxvkPhysicalBuffer> nextBuffer;
+    uint32_t idleCount = 0;
+    
+    for (auto i = m_physBuffers.begin(); i != m_physBuffers.end(); ) {
+      if ((*i)->isInUse()) {
+        i++;
+      } else if (nextBuffer == nullptr && *i != m_physBuffer) {
+        nextBuffer = *(i++);
+      } else if (idleCount < MaxIdleBuffers) {
+        idleCount += 1;
+        i++;
+      } else {
+        i = m_physBuffers.erase(i);
+      }
+    }
+    
+    if (nextBuffer == nullptr) {
+      nextBuffer = this->allocPhysicalBuffer();
+      m_physBuffers.push_back(nextBuffer);
+    }
+    
+    m_physBuffer = nextBuffer;
+  }
+  
+  
+  Rc<DxvkPhysicalBuffer> DxvkBuffer::allocPhysicalBuffer() const {
+    return new DxvkPhysicalBuffer(m_vkd,
+      m_info, *m_memAlloc, m_memFlags);
+  }
+  
+  
   DxvkBufferView::DxvkBufferView(
     const Rc<vk::DeviceFn>&         vkd,
     const Rc<DxvkBuffer>&           buffer,
@@ -25,6 +25,11 @@ namespace dxvk {
     
     /// Allowed access patterns
     VkAccessFlags access;
+    
+    /// Queue families that may access the buffer
+    /// concurrently. If empty, the buffer is owned
+    /// by one queue family at a time.
+    std::vector<uint32_t> queueFamilies;
   };
   
   
@@ -46,15 +51,69 @@ namespace dxvk {
   };
   
   
+  /**
+   * \brief Physical buffer
+   * 
+   * Owns the Vulkan buffer object and the memory that
+   * backs it. A \ref DxvkBuffer can be backed by more
+   * than one physical buffer over its lifetime, which
+   * allows its contents to be discarded without having
+   * to wait for the GPU to finish using the old ones.
+   */
+  class DxvkPhysicalBuffer : public DxvkResource {
+    
+  public:
+    
+    DxvkPhysicalBuffer(
+      const Rc<vk::DeviceFn>&     vkd,
+      const DxvkBufferCreateInfo& createInfo,
+            DxvkMemoryAllocator&  memAlloc,
+            VkMemoryPropertyFlags memFlags);
+    ~DxvkPhysicalBuffer();
+    
+    /**
+     * \brief Buffer handle
+     * \returns Buffer handle
+     */
+    VkBuffer handle() const {
+      return m_buffer;
+    }
+    
+    /**
+     * \brief Map pointer
+     * 
+     * \param [in] offset Byte offset into mapped region
+     * \returns Pointer to mapped memory region
+     */
+    void* mapPtr(VkDeviceSize offset) const {
+      return m_memory.mapPtr(offset);
+    }
+    
+  private:
+    
+    Rc<vk::DeviceFn>      m_vkd;
+    DxvkMemory            m_memory;
+    VkBuffer              m_buffer = VK_NULL_HANDLE;
+    
+  };
+  
+  
   /**
    * \brief Buffer resource
    * 
    * A simple buffer resource that stores linear,
    * unformatted data. Can be accessed by the host
    * if allocated on an appropriate memory type.
+   * 
+   * The buffer is backed by one physical buffer at a
+   * time. Physical buffers that were replaced through
+   * \ref rename are kept alive by the command lists
+   * using them and will be reused once they are no
+   * longer in use by the GPU. Only a small number of
+   * idle physical buffers is kept for that purpose.
    */
-  class DxvkBuffer : public DxvkResource {
-    
+  class DxvkBuffer : public RcObject {
+    constexpr static uint32_t MaxIdleBuffers = 2;
   public:
     
     DxvkBuffer(
@@ -66,10 +125,10 @@ namespace dxvk {
     
     /**
      * \brief Buffer handle
-     * \returns Buffer handle
+     * \returns Handle of the current physical buffer
      */
     VkBuffer handle() const {
-      return m_buffer;
+      return m_physBuffer->handle();
     }
     
     /**
@@ -80,6 +139,17 @@ namespace dxvk {
       return m_info;
     }
     
+    /**
+     * \brief Memory type flags
+     * 
+     * Use this to determine whether a
+     * buffer is mapped to host memory.
+     * \returns Vulkan memory flags
+     */
+    VkMemoryPropertyFlags memFlags() const {
+      return m_memFlags;
+    }
+    
     /**
      * \brief Map pointer
      * 
@@ -90,15 +160,53 @@ namespace dxvk {
      * \returns Pointer to mapped memory region
      */
     void* mapPtr(VkDeviceSize offset) const {
-      return m_memory.mapPtr(offset);
+      return m_physBuffer->mapPtr(offset);
+    }
+    
+    /**
+     * \brief Current physical buffer
+     * 
+     * This is the resource that needs to be tracked
+     * by command lists that access the buffer.
+     * \returns The current physical buffer
+     */
+    Rc<DxvkPhysicalBuffer> resource() const {
+      return m_physBuffer;
     }
     
+    /**
+     * \brief Checks whether the buffer is in use
+     * 
+     * Only considers the current physical buffer. Any
+     * previous ones may still be used by the GPU.
+     * \returns \c true if the GPU may access the buffer
+     */
+    bool isInUse() const {
+      return m_physBuffer->isInUse();
+    }
+    
+    /**
+     * \brief Replaces the physical buffer
+     * 
+     * Backs the buffer with a physical buffer that is
+     * not currently in use by the GPU. The contents of
+     * the buffer become undefined. Commands that were
+     * already recorded still use the old physical buffer,
+     * and buffer views need to be recreated.
+     */
+    void rename();
+    
   private:
     
     Rc<vk::DeviceFn>      m_vkd;
     DxvkBufferCreateInfo  m_info;
-    DxvkMemory            m_memory;
-    VkBuffer              m_buffer = VK_NULL_HANDLE;
+    DxvkMemoryAllocator*  m_memAlloc;
+    VkMemoryPropertyFlags m_memFlags;
+    
+    Rc<DxvkPhysicalBuffer>              m_physBuffer;
+    std::vector<Rc<DxvkPhysicalBuffer>> m_physBuffers;
+    
+    Rc<DxvkPhysicalBuffer> allocPhysicalBuffer() const;
     
   };
   
@@ -177,7 +285,7 @@ namespace dxvk {
       m_length(rangeLength) { }
     
     Rc<DxvkResource> resource() const {
-      return m_buffer;
+      return m_buffer->resource();
     }
     
     VkBuffer bufferHandle() const {
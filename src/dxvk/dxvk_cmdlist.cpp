@@ -5,8 +5,10 @@ namespace dxvk {
   DxvkCommandList::DxvkCommandList(
     const Rc<vk::DeviceFn>& vkd,
           DxvkDevice*       device,
+          DxvkQueueType     queueType,
           uint32_t          queueFamily)
-  : m_vkd(vkd), m_descAlloc(vkd), m_stagingAlloc(device) {
+  : m_vkd(vkd), m_queueType(queueType),
+    m_descAlloc(vkd), m_stagingAlloc(device) {
     VkCommandPoolCreateInfo poolInfo;
     poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     poolInfo.pNext            = nullptr;
@@ -86,55 +88,104 @@ namespace dxvk {
   }
   
   
+  void DxvkCommandList::notifySubmit(uint64_t submissionId) {
+    m_resources.notifySubmit(submissionId);
+    m_submissionId = submissionId;
+  }
+  
+  
   void DxvkCommandList::reset() {
     m_stagingAlloc.reset();
+    m_descCache.reset();
     m_descAlloc.reset();
     m_resources.reset();
+    m_statCounters.clear();
   }
   
   
-  void DxvkCommandList::bindResourceDescriptors(
-          VkPipelineBindPoint     pipeline,
-          VkPipelineLayout        pipelineLayout,
-          VkDescriptorSetLayout   descriptorLayout,
-          uint32_t                descriptorCount,
-    const DxvkDescriptorSlot*     descriptorSlots,
+  VkDescriptorSet DxvkCommandList::updateDescriptorSet(
+    const DxvkBindingLayout&      layout,
+          uint32_t                setId,
     const DxvkDescriptorInfo*     descriptorInfos) {
+    const DxvkDescriptorSetInfo& setInfo = layout.descriptorSet(setId);
+    const DxvkDescriptorSlot* descriptorSlots = layout.bindings() + setInfo.bindingOffset;
+    const uint32_t descriptorCount = setInfo.bindingCount;
     
-    // Allocate a new descriptor set
-    VkDescriptorSet dset = m_descAlloc.alloc(descriptorLayout);
+    this->gatherDescriptors(descriptorCount, descriptorSlots, descriptorInfos);
     
-    // Write data to the descriptor set
-    // TODO recycle vector as a class member
-    std::vector<VkWriteDescriptorSet> descriptorWrites;
-    descriptorWrites.resize(descriptorCount);
+    const size_t hash = DxvkDescriptorSetCache::computeHash(
+      setInfo.layout, descriptorCount, m_descInfos.data());
     
-    for (uint32_t i = 0; i < descriptorCount; i++) {
-      auto& curr = descriptorWrites.at(i);
-      auto& binding = descriptorSlots[i];
+    VkDescriptorSet dset = m_descCache.find(
+      setInfo.layout, descriptorCount, m_descInfos.data(), hash);
+    
+    if (dset == VK_NULL_HANDLE) {
+      // Allocate and write a new descriptor set
+      dset = m_descAlloc.alloc(setInfo.layout);
       
-      curr.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      curr.pNext            = nullptr;
-      curr.dstSet           = dset;
-      curr.dstBinding       = i;
-      curr.dstArrayElement  = 0;
-      curr.descriptorCount  = 1;
-      curr.descriptorType   = binding.type;
-      curr.pImageInfo       = &descriptorInfos[binding.slot].image;
-      curr.pBufferInfo      = &descriptorInfos[binding.slot].buffer;
-      curr.pTexelBufferView = &descriptorInfos[binding.slot].texelBuffer;
+      if (setInfo.updateTemplate != VK_NULL_HANDLE) {
+        m_vkd->vkUpdateDescriptorSetWithTemplateKHR(
+          m_vkd->device(), dset, setInfo.updateTemplate,
+          m_descInfos.data());
+      } else {
+        this->buildDescriptorWrites(dset, descriptorCount, descriptorSlots);
+        
+        m_vkd->vkUpdateDescriptorSets(
+          m_vkd->device(),
+          m_descWrites.size(),
+          m_descWrites.data(),
+          0, nullptr);
+      }
+      
+      m_descCache.insert(setInfo.layout,
+        descriptorCount, m_descInfos.data(), hash, dset);
+      m_statCounters.increment(DxvkStat::CtxDescriptorUpdates, 1);
+    } else {
+      m_statCounters.increment(DxvkStat::CtxDescriptorReuses, 1);
     }
     
-    m_vkd->vkUpdateDescriptorSets(
-      m_vkd->device(),
-      descriptorWrites.size(),
-      descriptorWrites.data(),
-      0, nullptr);
+    return dset;
+  }
+  
+  
+  void DxvkCommandList::pushDescriptorSet(
+          VkPipelineBindPoint     pipeline,
+    const DxvkBindingLayout&      layout,
+          uint32_t                setId,
+    const DxvkDescriptorInfo*     descriptorInfos) {
+    const DxvkDescriptorSetInfo& setInfo = layout.descriptorSet(setId);
+    const DxvkDescriptorSlot* descriptorSlots = layout.bindings() + setInfo.bindingOffset;
+    const uint32_t descriptorCount = setInfo.bindingCount;
+    
+    this->gatherDescriptors(descriptorCount, descriptorSlots, descriptorInfos);
     
-    // Bind descriptor set to the pipeline
+    if (setInfo.updateTemplate != VK_NULL_HANDLE) {
+      m_vkd->vkCmdPushDescriptorSetWithTemplateKHR(m_buffer,
+        setInfo.updateTemplate, layout.pipelineLayout(),
+        setId, m_descInfos.data());
+    } else {
+      this->buildDescriptorWrites(VK_NULL_HANDLE, descriptorCount, descriptorSlots);
+      
+      m_vkd->vkCmdPushDescriptorSetKHR(m_buffer,
+        pipeline, layout.pipelineLayout(), setId,
+        m_descWrites.size(), m_descWrites.data());
+    }
+    
+    m_statCounters.increment(DxvkStat::CtxDescriptorPushes, 1);
+  }
+  
+  
+  void DxvkCommandList::cmdBindDescriptorSets(
+          VkPipelineBindPoint     pipeline,
+          VkPipelineLayout        pipelineLayout,
+          uint32_t                firstSet,
+          uint32_t                setCount,
+    const VkDescriptorSet*        descriptorSets,
+          uint32_t                dynamicOffsetCount,
+    const uint32_t*               dynamicOffsets) {
     m_vkd->vkCmdBindDescriptorSets(m_buffer,
-      pipeline, pipelineLayout, 0, 1,
-      &dset, 0, nullptr);
+      pipeline, pipelineLayout, firstSet, setCount,
+      descriptorSets, dynamicOffsetCount, dynamicOffsets);
   }
   
   
@@ -219,6 +270,30 @@ namespace dxvk {
   }
   
   
+  void DxvkCommandList::cmdCopyBufferToImage(
+          VkBuffer                srcBuffer,
+          VkImage                 dstImage,
+          VkImageLayout           dstImageLayout,
+          uint32_t                regionCount,
+    const VkBufferImageCopy*      pRegions) {
+    m_vkd->vkCmdCopyBufferToImage(m_buffer,
+      srcBuffer, dstImage, dstImageLayout,
+      regionCount, pRegions);
+  }
+  
+  
+  void DxvkCommandList::cmdCopyImageToBuffer(
+          VkImage                 srcImage,
+          VkImageLayout           srcImageLayout,
+          VkBuffer                dstBuffer,
+          uint32_t                regionCount,
+    const VkBufferImageCopy*      pRegions) {
+    m_vkd->vkCmdCopyImageToBuffer(m_buffer,
+      srcImage, srcImageLayout, dstBuffer,
+      regionCount, pRegions);
+  }
+  
+  
   void DxvkCommandList::cmdDispatch(
           uint32_t                x,
           uint32_t                y,
@@ -330,8 +405,10 @@ namespace dxvk {
   }
   
   
-  DxvkStagingBufferSlice DxvkCommandList::stagedAlloc(VkDeviceSize size) {
-    return m_stagingAlloc.alloc(size);
+  DxvkStagingBufferSlice DxvkCommandList::stagedAlloc(
+          VkDeviceSize            size,
+          VkDeviceSize            align) {
+    return m_stagingAlloc.alloc(size, align);
   }
   
   
@@ -360,4 +437,48 @@ namespace dxvk {
       1, &dstImageRegion);
   }
   
+  
+  void DxvkCommandList::gatherDescriptors(
+          uint32_t                descriptorCount,
+    const DxvkDescriptorSlot*     descriptorSlots,
+    const DxvkDescriptorInfo*     descriptorInfos) {
+    // Gather the descriptors in binding order. This is
+    // the layout that update templates expect, and is
+    // also used to look up cached descriptor sets.
+    m_descInfos.resize(descriptorCount);
+    
+    for (uint32_t i = 0; i < descriptorCount; i++) {
+      m_descInfos[i] = descriptorInfos[descriptorSlots[i].slot];
+      
+      // The offset of dynamic buffers is passed in when
+      // binding the set, so the set does not depend on it
+      if (descriptorSlots[i].type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+        m_descInfos[i].buffer.offset = 0;
+    }
+  }
+  
+  
+  void DxvkCommandList::buildDescriptorWrites(
+          VkDescriptorSet         descriptorSet,
+          uint32_t                descriptorCount,
+    const DxvkDescriptorSlot*     descriptorSlots) {
+    m_descWrites.resize(descriptorCount);
+    
+    for (uint32_t i = 0; i < descriptorCount; i++) {
+      auto& curr = m_descWrites.at(i);
+      auto& binding = descriptorSlots[i];
+      
+      curr.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      curr.pNext            = nullptr;
+      curr.dstSet           = descriptorSet;
+      curr.dstBinding       = binding.binding;
+      curr.dstArrayElement  = 0;
+      curr.descriptorCount  = 1;
+      curr.descriptorType   = binding.type;
+      curr.pImageInfo       = &m_descInfos[i].image;
+      curr.pBufferInfo      = &m_descInfos[i].buffer;
+      curr.pTexelBufferView = &m_descInfos[i].texelBuffer;
+    }
+  }
+  
 }
\ No newline at end of file
@@ -6,9 +6,22 @@
 #include "dxvk_lifetime.h"
 #include "dxvk_pipelayout.h"
 #include "dxvk_staging.h"
+#include "dxvk_stats.h"
 
 namespace dxvk {
   
+  /**
+   * \brief Device queue type
+   * 
+   * Determines which device queue a command
+   * list is allocated for and submitted to.
+   */
+  enum class DxvkQueueType : uint32_t {
+    Graphics, ///< Graphics and compute queue
+    Transfer, ///< Dedicated transfer queue
+  };
+  
+  
   /**
    * \brief DXVK command list
    * 
@@ -25,9 +38,21 @@ namespace dxvk {
     DxvkCommandList(
       const Rc<vk::DeviceFn>& vkd,
             DxvkDevice*       device,
+            DxvkQueueType     queueType,
             uint32_t          queueFamily);
     ~DxvkCommandList();
     
+    /**
+     * \brief Queue type
+     * 
+     * Command lists can only be submitted to the
+     * queue that they have been allocated for.
+     * \returns Queue type
+     */
+    DxvkQueueType queueType() const {
+      return m_queueType;
+    }
+    
     /**
      * \brief Submits command list
      * 
@@ -69,6 +94,24 @@ namespace dxvk {
     void trackResource(
       const Rc<DxvkResource>& rc);
     
+    /**
+     * \brief Assigns a submission ID
+     * 
+     * Called by the device when the command list gets
+     * submitted. All tracked resources will remember
+     * the ID until they are used by a later submission.
+     * \param [in] submissionId Submission ID
+     */
+    void notifySubmit(uint64_t submissionId);
+    
+    /**
+     * \brief Submission ID
+     * \returns ID of the last submission of this list
+     */
+    uint64_t submissionId() const {
+      return m_submissionId;
+    }
+    
     /**
      * \brief Resets the command list
      * 
@@ -79,18 +122,67 @@ namespace dxvk {
      */
     void reset();
     
-    void bindResourceDescriptors(
+    /**
+     * \brief Stat counters
+     * 
+     * Counters for commands recorded into this
+     * command list. The device adds these to its
+     * own counters when the list is submitted.
+     * \returns Stat counters
+     */
+    const DxvkStatCounters& statCounters() const {
+      return m_statCounters;
+    }
+    
+    /**
+     * \brief Updates a descriptor set
+     * 
+     * Reuses a previously written descriptor set if
+     * one with identical contents has been created with
+     * the same layout since the command list was reset.
+     * Otherwise, a new descriptor set is allocated and
+     * written, using the set's update template if the
+     * layout provides one. The set must be bound separately.
+     * \param [in] layout Binding layout
+     * \param [in] setId Descriptor set index
+     * \param [in] descriptorInfos Descriptors, indexed by slot
+     * \returns Descriptor set with the given contents
+     */
+    VkDescriptorSet updateDescriptorSet(
+      const DxvkBindingLayout&      layout,
+            uint32_t                setId,
+      const DxvkDescriptorInfo*     descriptorInfos);
+    
+    /**
+     * \brief Pushes a descriptor set
+     * 
+     * Writes all descriptors of the layout's push
+     * descriptor set directly into the command buffer.
+     * No descriptor set is allocated or bound.
+     * \param [in] pipeline Pipeline bind point
+     * \param [in] layout Binding layout
+     * \param [in] setId Push descriptor set index
+     * \param [in] descriptorInfos Descriptors, indexed by slot
+     */
+    void pushDescriptorSet(
             VkPipelineBindPoint     pipeline,
-            VkPipelineLayout        pipelineLayout,
-            VkDescriptorSetLayout   descriptorLayout,
-            uint32_t                descriptorCount,
-      const DxvkDescriptorSlot*     descriptorSlots,
+      const DxvkBindingLayout&      layout,
+            uint32_t                setId,
       const DxvkDescriptorInfo*     descriptorInfos);
     
     void cmdBeginRenderPass(
       const VkRenderPassBeginInfo*  pRenderPassBegin,
             VkSubpassContents       contents);
     
+    void cmdBindDescriptorSets(
+            VkPipelineBindPoint     pipeline,
+            VkPipelineLayout        pipelineLayout,
+            uint32_t                firstSet,
+            uint32_t                setCount,
+      const VkDescriptorSet*        descriptorSets,
+            uint32_t                dynamicOffsetCount,
+      const uint32_t*               dynamicOffsets);
+    
     void cmdBindIndexBuffer(
             VkBuffer                buffer,
             VkDeviceSize            offset,
@@ -132,6 +224,20 @@ namespace dxvk {
             uint32_t                regionCount,
       const VkBufferCopy*           pRegions);
     
+    void cmdCopyBufferToImage(
+            VkBuffer                srcBuffer,
+            VkImage                 dstImage,
+            VkImageLayout           dstImageLayout,
+            uint32_t                regionCount,
+      const VkBufferImageCopy*      pRegions);
+    
+    void cmdCopyImageToBuffer(
+            VkImage                 srcImage,
+            VkImageLayout           srcImageLayout,
+            VkBuffer                dstBuffer,
+            uint32_t                regionCount,
+      const VkBufferImageCopy*      pRegions);
+    
     void cmdDispatch(
             uint32_t                x,
             uint32_t                y,
@@ -195,7 +301,8 @@ namespace dxvk {
       const VkViewport*             viewports);
     
     DxvkStagingBufferSlice stagedAlloc(
-            VkDeviceSize            size);
+            VkDeviceSize            size,
+            VkDeviceSize            align);
     
     void stagedBufferCopy(
             VkBuffer                dstBuffer,
@@ -212,14 +319,32 @@ namespace dxvk {
   private:
     
     Rc<vk::DeviceFn>    m_vkd;
+    DxvkQueueType       m_queueType;
     
     VkCommandPool       m_pool;
     VkCommandBuffer     m_buffer;
+    uint64_t            m_submissionId = 0;
     
     DxvkLifetimeTracker m_resources;
     DxvkDescriptorAlloc m_descAlloc;
     DxvkStagingAlloc    m_stagingAlloc;
     
+    DxvkDescriptorSetCache            m_descCache;
+    std::vector<DxvkDescriptorInfo>   m_descInfos;
+    std::vector<VkWriteDescriptorSet> m_descWrites;
+    
+    void gatherDescriptors(
+            uint32_t                descriptorCount,
+      const DxvkDescriptorSlot*     descriptorSlots,
+      const DxvkDescriptorInfo*     descriptorInfos);
+    
+    void buildDescriptorWrites(
+            VkDescriptorSet         descriptorSet,
+            uint32_t                descriptorCount,
+      const DxvkDescriptorSlot*     descriptorSlots);
+    
+    DxvkStatCounters    m_statCounters;
+    
   };
   
 }
\ No newline at end of file
@@ -3,13 +3,16 @@
 namespace dxvk {
   
   DxvkComputePipeline::DxvkComputePipeline(
-    const Rc<vk::DeviceFn>& vkd,
-    const Rc<DxvkShader>&   cs)
-  : m_vkd(vkd) {
+    const Rc<vk::DeviceFn>&       vkd,
+    const DxvkDeviceExtensions&   extensions,
+    const Rc<DxvkPipelineCache>&  cache,
+    const Rc<DxvkShader>&         cs)
+  : m_vkd(vkd), m_cache(cache) {
     DxvkDescriptorSlotMapping slotMapping;
     cs->defineResourceSlots(slotMapping);
+    slotMapping.assignDescriptorSets();
     
-    m_layout = new DxvkBindingLayout(vkd,
+    m_layout = new DxvkBindingLayout(vkd, extensions,
       slotMapping.bindingCount(),
       slotMapping.bindingInfos());
     
@@ -38,7 +41,7 @@ namespace dxvk {
     info.basePipelineIndex    = 0;
     
     if (m_vkd->vkCreateComputePipelines(m_vkd->device(),
-          VK_NULL_HANDLE, 1, &info, nullptr, &m_pipeline) != VK_SUCCESS)
+          m_cache->handle(), 1, &info, nullptr, &m_pipeline) != VK_SUCCESS)
       throw DxvkError("DxvkComputePipeline::DxvkComputePipeline: Failed to compile pipeline");
   }
   
@@ -8,7 +8,9 @@ namespace dxvk {
   
   DxvkContext::DxvkContext(const Rc<DxvkDevice>& device)
   : m_device(device) {
-    
+    // Opt-in, since skipping draws may cause visual
+    // glitches while pipelines are being compiled
+    m_asyncPipelines = env::getEnvVar(L"DXVK_ASYNC_PIPELINES") == "1";
   }
   
   
@@ -21,6 +23,11 @@ namespace dxvk {
     m_cmd = cmdList;
     m_cmd->beginRecording();
     
+    // Descriptor sets are not bound to the new command
+    // buffer, so they need to be written and bound again
+    m_state.gp.dsets.layout = nullptr;
+    m_state.cp.dsets.layout = nullptr;
+    
     // The current state of the internal command buffer is
     // undefined, so we have to bind and set up everything
     // before any draw or dispatch command is recorded.
@@ -75,7 +82,9 @@ namespace dxvk {
     const DxvkBufferBinding&    buffer) {
     auto rc = this->getShaderResourceSlots(pipe);
     
-    if (rc->getShaderResource(slot).bufferSlice != buffer) {
+    const DxvkBufferBinding& oldBuffer = rc->getShaderResource(slot).bufferSlice;
+    
+    if (oldBuffer != buffer) {
       m_flags.set(this->getResourceDirtyFlag(pipe));
       
       DxvkShaderResourceSlot resource;
@@ -86,7 +95,16 @@ namespace dxvk {
       if (buffer.bufferHandle() != VK_NULL_HANDLE)
         descriptor.buffer = buffer.descriptorInfo();
       
-      rc->bindShaderResource(slot, resource, descriptor);
+      // If only the offset changed, uniform buffers with
+      // dynamic offsets do not need a new descriptor set
+      const bool offsetOnly = buffer.bufferHandle() != VK_NULL_HANDLE
+        && oldBuffer.bufferHandle() == buffer.bufferHandle()
+        && oldBuffer.bufferRange()  == buffer.bufferRange();
+      
+      if (offsetOnly)
+        rc->bindBufferOffset(slot, resource, descriptor);
+      else
+        rc->bindShaderResource(slot, resource, descriptor);
     }
   }
   
@@ -310,12 +328,141 @@ namespace dxvk {
       
       m_barriers.recordCommands(m_cmd);
       
-      m_cmd->trackResource(dstBuffer);
-      m_cmd->trackResource(srcBuffer);
+      m_cmd->trackResource(dstBuffer->resource());
+      m_cmd->trackResource(srcBuffer->resource());
     }
   }
   
   
+  void DxvkContext::copyBufferToImage(
+    const Rc<DxvkImage>&            dstImage,
+          VkImageSubresourceLayers  dstSubresource,
+          VkOffset3D                dstOffset,
+          VkExtent3D                dstExtent,
+    const Rc<DxvkBuffer>&           srcBuffer,
+          VkDeviceSize              srcOffset) {
+    this->renderPassEnd();
+    
+    VkImageSubresourceRange dstSubresourceRange;
+    dstSubresourceRange.aspectMask     = dstSubresource.aspectMask;
+    dstSubresourceRange.baseMipLevel   = dstSubresource.mipLevel;
+    dstSubresourceRange.levelCount     = 1;
+    dstSubresourceRange.baseArrayLayer = dstSubresource.baseArrayLayer;
+    dstSubresourceRange.layerCount     = dstSubresource.layerCount;
+    
+    // The previous contents can be discarded if
+    // the entire subresource gets overwritten
+    m_barriers.accessImage(
+      dstImage, dstSubresourceRange,
+      dstImage->mipLevelExtent(dstSubresource.mipLevel) == dstExtent
+        ? VK_IMAGE_LAYOUT_UNDEFINED
+        : dstImage->info().layout,
+      dstImage->info().stages,
+      dstImage->info().access,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_WRITE_BIT);
+    m_barriers.recordCommands(m_cmd);
+    
+    VkBufferImageCopy copyRegion;
+    copyRegion.bufferOffset       = srcOffset;
+    copyRegion.bufferRowLength    = 0;
+    copyRegion.bufferImageHeight  = 0;
+    copyRegion.imageSubresource   = dstSubresource;
+    copyRegion.imageOffset        = dstOffset;
+    copyRegion.imageExtent        = dstExtent;
+    
+    m_cmd->cmdCopyBufferToImage(
+      srcBuffer->handle(),
+      dstImage->handle(),
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      1, &copyRegion);
+    
+    m_barriers.accessImage(
+      dstImage, dstSubresourceRange,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_WRITE_BIT,
+      dstImage->info().layout,
+      dstImage->info().stages,
+      dstImage->info().access);
+    
+    m_barriers.accessBuffer(
+      srcBuffer, srcOffset, VK_WHOLE_SIZE,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_READ_BIT,
+      srcBuffer->info().stages,
+      srcBuffer->info().access);
+    m_barriers.recordCommands(m_cmd);
+    
+    m_cmd->trackResource(dstImage);
+    m_cmd->trackResource(srcBuffer->resource());
+  }
+  
+  
+  void DxvkContext::copyImageToBuffer(
+    const Rc<DxvkBuffer>&           dstBuffer,
+          VkDeviceSize              dstOffset,
+    const Rc<DxvkImage>&            srcImage,
+          VkImageSubresourceLayers  srcSubresource,
+          VkOffset3D                srcOffset,
+          VkExtent3D                srcExtent) {
+    this->renderPassEnd();
+    
+    VkImageSubresourceRange srcSubresourceRange;
+    srcSubresourceRange.aspectMask     = srcSubresource.aspectMask;
+    srcSubresourceRange.baseMipLevel   = srcSubresource.mipLevel;
+    srcSubresourceRange.levelCount     = 1;
+    srcSubresourceRange.baseArrayLayer = srcSubresource.baseArrayLayer;
+    srcSubresourceRange.layerCount     = srcSubresource.layerCount;
+    
+    m_barriers.accessImage(
+      srcImage, srcSubresourceRange,
+      srcImage->info().layout,
+      srcImage->info().stages,
+      srcImage->info().access,
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_READ_BIT);
+    m_barriers.recordCommands(m_cmd);
+    
+    VkBufferImageCopy copyRegion;
+    copyRegion.bufferOffset       = dstOffset;
+    copyRegion.bufferRowLength    = 0;
+    copyRegion.bufferImageHeight  = 0;
+    copyRegion.imageSubresource   = srcSubresource;
+    copyRegion.imageOffset        = srcOffset;
+    copyRegion.imageExtent        = srcExtent;
+    
+    m_cmd->cmdCopyImageToBuffer(
+      srcImage->handle(),
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      dstBuffer->handle(),
+      1, &copyRegion);
+    
+    m_barriers.accessImage(
+      srcImage, srcSubresourceRange,
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_READ_BIT,
+      srcImage->info().layout,
+      srcImage->info().stages,
+      srcImage->info().access);
+    
+    // Make the written data visible to the host
+    m_barriers.accessBuffer(
+      dstBuffer, dstOffset, VK_WHOLE_SIZE,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_WRITE_BIT,
+      dstBuffer->info().stages,
+      dstBuffer->info().access);
+    m_barriers.recordCommands(m_cmd);
+    
+    m_cmd->trackResource(srcImage);
+    m_cmd->trackResource(dstBuffer->resource());
+  }
+  
+  
   void DxvkContext::dispatch(
           uint32_t x,
           uint32_t y,
@@ -333,11 +480,11 @@ namespace dxvk {
           uint32_t instanceCount,
           uint32_t firstVertex,
           uint32_t firstInstance) {
-    this->commitGraphicsState();
-    
-    m_cmd->cmdDraw(
-      vertexCount, instanceCount,
-      firstVertex, firstInstance);
+    if (this->commitGraphicsState()) {
+      m_cmd->cmdDraw(
+        vertexCount, instanceCount,
+        firstVertex, firstInstance);
+    }
   }
   
   
@@ -347,12 +494,12 @@ namespace dxvk {
           uint32_t firstIndex,
           uint32_t vertexOffset,
           uint32_t firstInstance) {
-    this->commitGraphicsState();
-    
-    m_cmd->cmdDrawIndexed(
-      indexCount, instanceCount,
-      firstIndex, vertexOffset,
-      firstInstance);
+    if (this->commitGraphicsState()) {
+      m_cmd->cmdDrawIndexed(
+        indexCount, instanceCount,
+        firstIndex, vertexOffset,
+        firstInstance);
+    }
   }
   
   
@@ -368,6 +515,31 @@ namespace dxvk {
   }
   
   
+  void DxvkContext::invalidateBuffer(
+    const Rc<DxvkBuffer>&           buffer) {
+    buffer->rename();
+    
+    // Bindings compare equal since they reference the same
+    // buffer object, so their state has to be flagged dirty
+    // explicitly in order to use the new physical buffer.
+    const VkBufferUsageFlags usage = buffer->info().usage;
+    
+    if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
+      m_flags.set(DxvkContextFlag::GpDirtyIndexBuffer);
+    
+    if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+      m_flags.set(DxvkContextFlag::GpDirtyVertexBuffers);
+    
+    if (usage & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+               | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+      this->updateResourceBuffer(m_gResources,
+        DxvkContextFlag::GpDirtyResources, buffer);
+      this->updateResourceBuffer(m_cResources,
+        DxvkContextFlag::CpDirtyResources, buffer);
+    }
+  }
+  
+  
   void DxvkContext::resolveImage(
     const Rc<DxvkImage>&            dstImage,
     const VkImageSubresourceLayers& dstSubresources,
@@ -458,7 +630,7 @@ namespace dxvk {
           buffer->handle(),
           offset, size, data);
       } else {
-        auto slice = m_cmd->stagedAlloc(size);
+        auto slice = m_cmd->stagedAlloc(size, 1);
         std::memcpy(slice.mapPtr, data, size);
         
         m_cmd->stagedBufferCopy(
@@ -474,7 +646,7 @@ namespace dxvk {
         buffer->info().access);
       m_barriers.recordCommands(m_cmd);
       
-      m_cmd->trackResource(buffer);
+      m_cmd->trackResource(buffer->resource());
     }
   }
   
@@ -510,35 +682,16 @@ namespace dxvk {
     VkDeviceSize bytesTotal    = elementCount.depth  * bytesPerLayer;
     
     // Allocate staging buffer memory for the image data. The
-    // pixels or blocks will be tightly packed within the buffer.
-    DxvkStagingBufferSlice slice = m_cmd->stagedAlloc(bytesTotal);
-    
-    auto dstData = reinterpret_cast<char*>(slice.mapPtr);
-    auto srcData = reinterpret_cast<const char*>(data);
-    
-    // If the application provides tightly packed data as well,
-    // we can minimize the number of memcpy calls in order to
-    // improve performance.
-    bool useDirectCopy = true;
-    
-    useDirectCopy &= (pitchPerLayer == bytesPerLayer) || (elementCount.depth  == 1);
-    useDirectCopy &= (pitchPerRow   == bytesPerRow)   || (elementCount.height == 1);
-    
-    if (useDirectCopy) {
-      std::memcpy(dstData, srcData, bytesTotal);
-    } else {
-      for (uint32_t i = 0; i < elementCount.depth; i++) {
-        for (uint32_t j = 0; j < elementCount.height; j++) {
-          std::memcpy(dstData, srcData, bytesPerRow);
-          
-          dstData += bytesPerRow;
-          srcData += pitchPerRow;
-        }
-        
-        dstData += bytesPerLayer;
-        srcData += pitchPerLayer;
-      }
-    }
+    // pixels or blocks will be tightly packed within the buffer,
+    // and the offset must be a multiple of the element size.
+    DxvkStagingBufferSlice slice = m_cmd->stagedAlloc(
+      bytesTotal, formatInfo->elementSize);
+    
+    util::packImageData(
+      reinterpret_cast<char*>(slice.mapPtr),
+      reinterpret_cast<const char*>(data),
+      elementCount, formatInfo->elementSize,
+      pitchPerRow, pitchPerLayer);
     
     // Prepare the image layout. If the given extent covers
     // the entire image, we may discard its previous contents.
@@ -733,6 +886,7 @@ namespace dxvk {
   void DxvkContext::updateComputePipeline() {
     if (m_flags.test(DxvkContextFlag::CpDirtyPipeline)) {
       m_flags.clr(DxvkContextFlag::CpDirtyPipeline);
+      m_flags.set(DxvkContextFlag::CpDirtyResources);
       
       m_state.cp.pipeline = m_device->createComputePipeline(
         m_state.cp.cs.shader);
@@ -744,12 +898,13 @@ namespace dxvk {
   }
   
   
-  void DxvkContext::updateGraphicsPipeline() {
+  bool DxvkContext::updateGraphicsPipeline() {
     if (m_flags.any(DxvkContextFlag::GpDirtyPipeline, DxvkContextFlag::GpDirtyPipelineState)) {
       m_flags.clr(DxvkContextFlag::GpDirtyPipelineState);
       
       if (m_flags.test(DxvkContextFlag::GpDirtyPipeline)) {
         m_flags.clr(DxvkContextFlag::GpDirtyPipeline);
+        m_flags.set(DxvkContextFlag::GpDirtyResources);
         
         m_state.gp.pipeline = m_device->createGraphicsPipeline(
           m_state.gp.vs.shader, m_state.gp.tcs.shader, m_state.gp.tes.shader,
@@ -827,10 +982,25 @@ namespace dxvk {
         }
       }
       
-      m_cmd->cmdBindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS,
-        m_state.gp.pipeline->getPipelineHandle(gpState));
+      const DxvkRenderPassFormat& rpFormat
+        = m_state.om.framebuffer->renderPassFormat();
+      
+      VkPipeline pipeline = m_asyncPipelines
+        ? m_state.gp.pipeline->getPipelineHandleAsync(gpState, rpFormat)
+        : m_state.gp.pipeline->getPipelineHandle(gpState, rpFormat);
+      
+      // If the pipeline is not available yet, skip
+      // the draw and try again on the next draw call
+      if (pipeline == VK_NULL_HANDLE) {
+        m_flags.set(DxvkContextFlag::GpDirtyPipelineState);
+        return false;
+      }
+      
+      m_cmd->cmdBindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
       m_cmd->trackResource(m_state.gp.pipeline);
     }
+    
+    return true;
   }
   
   
@@ -838,15 +1008,10 @@ namespace dxvk {
     if (m_flags.test(DxvkContextFlag::CpDirtyResources)) {
       m_flags.clr(DxvkContextFlag::CpDirtyResources);
       
-      auto layout = m_state.cp.pipeline->layout();
-      
-      m_cmd->bindResourceDescriptors(
+      this->updateShaderResources(
         VK_PIPELINE_BIND_POINT_COMPUTE,
-        layout->pipelineLayout(),
-        layout->descriptorSetLayout(),
-        layout->bindingCount(),
-        layout->bindings(),
-        m_cResources.descriptors());
+        m_state.cp.pipeline->layout(),
+        m_cResources, m_state.cp.dsets);
     }
   }
   
@@ -855,19 +1020,158 @@ namespace dxvk {
     if (m_flags.test(DxvkContextFlag::GpDirtyResources)) {
       m_flags.clr(DxvkContextFlag::GpDirtyResources);
       
-      auto layout = m_state.gp.pipeline->layout();
-      
-      m_cmd->bindResourceDescriptors(
+      this->updateShaderResources(
         VK_PIPELINE_BIND_POINT_GRAPHICS,
-        layout->pipelineLayout(),
-        layout->descriptorSetLayout(),
-        layout->bindingCount(),
-        layout->bindings(),
-        m_gResources.descriptors());
+        m_state.gp.pipeline->layout(),
+        m_gResources, m_state.gp.dsets);
+    }
+  }
+  
+  
+  void DxvkContext::updateShaderResources(
+          VkPipelineBindPoint       bindPoint,
+    const Rc<DxvkBindingLayout>&    layout,
+          DxvkShaderResourceSlots&  resources,
+          DxvkDescriptorSetState&   dsets) {
+    const uint32_t setCount = layout->descriptorSetCount();
+    
+    // If the layout changed, none of the previously bound
+    // sets are compatible. Otherwise, only the sets that
+    // contain modified resource slots need to be updated.
+    uint32_t dirtySets  = (1u << setCount) - 1;
+    uint32_t rebindSets = 0;
+    
+    if (dsets.layout == layout) {
+      dirtySets = 0;
+      
+      resources.forEachDirtySlot([&] (uint32_t slot) {
+        const uint32_t set = layout->getSetForSlot(slot);
+        
+        if (set < setCount)
+          dirtySets |= 1u << set;
+      });
+      
+      // Sets whose dynamic buffers only changed their
+      // offsets only need to be bound again
+      resources.forEachDirtyOffset([&] (uint32_t slot) {
+        const DxvkDescriptorSlot* binding = layout->getBindingForSlot(slot);
+        
+        if (binding != nullptr) {
+          if (binding->type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+            rebindSets |= 1u << binding->set;
+          else
+            dirtySets  |= 1u << binding->set;
+        }
+      });
+    }
+    
+    resources.clearDirty();
+    dsets.layout = layout;
+    
+    // The push descriptor set is written directly
+    // into the command buffer and is never bound
+    const uint32_t pushSet = layout->pushDescriptorSet();
+    
+    if (pushSet < setCount && (dirtySets & (1u << pushSet))) {
+      m_cmd->pushDescriptorSet(bindPoint, *layout,
+        pushSet, resources.descriptors());
+      this->trackShaderResources(*layout, pushSet, resources);
+      dirtySets &= ~(1u << pushSet);
+    }
+    
+    const uint32_t bindSets = dirtySets | rebindSets;
+    
+    if (bindSets == 0)
+      return;
+    
+    const uint32_t firstSet = bit::tzcnt(bindSets);
+    uint32_t       lastSet  = setCount - 1;
+    
+    while (!(bindSets & (1u << lastSet)))
+      lastSet -= 1;
+    
+    for (uint32_t i = firstSet; i <= lastSet; i++) {
+      if (dirtySets & (1u << i)) {
+        dsets.sets[i] = m_cmd->updateDescriptorSet(
+          *layout, i, resources.descriptors());
+        this->trackShaderResources(*layout, i, resources);
+      }
+    }
+    
+    // Sets in between modified sets are rebound with their
+    // current handles so that as few calls as possible
+    // are needed. Only the push set splits the range.
+    std::array<uint32_t, DxvkLimits::MaxNumDynamicBuffers> offsets;
+    
+    uint32_t rangeStart  = firstSet;
+    uint32_t offsetCount = 0;
+    
+    for (uint32_t i = firstSet; i <= lastSet + 1; i++) {
+      if (i == pushSet || i > lastSet) {
+        if (i > rangeStart) {
+          m_cmd->cmdBindDescriptorSets(bindPoint,
+            layout->pipelineLayout(), rangeStart,
+            i - rangeStart, &dsets.sets[rangeStart],
+            offsetCount, offsets.data());
+        }
+        
+        rangeStart  = i + 1;
+        offsetCount = 0;
+      } else {
+        // Dynamic offsets are ordered by set and binding
+        const DxvkDescriptorSetInfo& setInfo = layout->descriptorSet(i);
+        
+        for (uint32_t j = 0; j < setInfo.bindingCount; j++) {
+          const DxvkDescriptorSlot& binding = layout->bindings()[setInfo.bindingOffset + j];
+          
+          if (binding.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+            offsets[offsetCount++] = resources.descriptors()[binding.slot].buffer.offset;
+        }
+      }
+    }
+  }
+  
+  
+  void DxvkContext::trackShaderResources(
+    const DxvkBindingLayout&        layout,
+          uint32_t                  setId,
+    const DxvkShaderResourceSlots&  resources) {
+    // Physical buffers must stay in use until the command
+    // list has completed so that they are not reused when
+    // the buffer gets renamed. Sets are written whenever
+    // one of their buffers changes, so this is sufficient.
+    const DxvkDescriptorSetInfo& setInfo = layout.descriptorSet(setId);
+    
+    for (uint32_t i = 0; i < setInfo.bindingCount; i++) {
+      const DxvkDescriptorSlot& binding = layout.bindings()[setInfo.bindingOffset + i];
+      const DxvkBufferBinding&  buffer  = resources.getShaderResource(binding.slot).bufferSlice;
+      
+      if (buffer.bufferHandle() != VK_NULL_HANDLE)
+        m_cmd->trackResource(buffer.resource());
     }
   }
   
   
+  void DxvkContext::updateResourceBuffer(
+          DxvkShaderResourceSlots&  resources,
+          DxvkContextFlag           dirtyFlag,
+    const Rc<DxvkBuffer>&           buffer) {
+    // Only slots that currently have a buffer bound need
+    // to be checked, which usually are very few of them
+    resources.forEachBufferSlot([&] (uint32_t slot) {
+      const DxvkShaderResourceSlot& resource = resources.getShaderResource(slot);
+      
+      if (resource.bufferSlice.bufferHandle() == buffer->handle()) {
+        DxvkDescriptorInfo descriptor;
+        descriptor.buffer = resource.bufferSlice.descriptorInfo();
+        
+        resources.bindShaderResource(slot, resource, descriptor);
+        m_flags.set(dirtyFlag);
+      }
+    });
+  }
+  
+  
   void DxvkContext::updateDynamicState() {
     if (m_flags.test(DxvkContextFlag::GpDirtyDynamicState)) {
       m_flags.clr(DxvkContextFlag::GpDirtyDynamicState);
@@ -939,13 +1243,17 @@ namespace dxvk {
   }
   
   
-  void DxvkContext::commitGraphicsState() {
+  bool DxvkContext::commitGraphicsState() {
     this->renderPassBegin();
-    this->updateGraphicsPipeline();
+    
+    if (!this->updateGraphicsPipeline())
+      return false;
+    
     this->updateDynamicState();
     this->updateIndexBufferBinding();
     this->updateVertexBufferBindings();
     this->updateGraphicsShaderResources();
+    return true;
   }
   
   
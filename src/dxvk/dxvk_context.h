@@ -193,6 +193,44 @@ namespace dxvk {
             VkDeviceSize          srcOffset,
             VkDeviceSize          numBytes);
     
+    /**
+     * \brief Copies data from a buffer to an image
+     * 
+     * Buffer data must be tightly packed.
+     * \param [in] dstImage Destination image
+     * \param [in] dstSubresource Destination subresource
+     * \param [in] dstOffset Destination area offset
+     * \param [in] dstExtent Destination area size
+     * \param [in] srcBuffer Source buffer
+     * \param [in] srcOffset Source data offset
+     */
+    void copyBufferToImage(
+      const Rc<DxvkImage>&            dstImage,
+            VkImageSubresourceLayers  dstSubresource,
+            VkOffset3D                dstOffset,
+            VkExtent3D                dstExtent,
+      const Rc<DxvkBuffer>&           srcBuffer,
+            VkDeviceSize              srcOffset);
+    
+    /**
+     * \brief Copies data from an image to a buffer
+     * 
+     * Buffer data will be tightly packed.
+     * \param [in] dstBuffer Destination buffer
+     * \param [in] dstOffset Destination data offset
+     * \param [in] srcImage Source image
+     * \param [in] srcSubresource Source subresource
+     * \param [in] srcOffset Source area offset
+     * \param [in] srcExtent Source area size
+     */
+    void copyImageToBuffer(
+      const Rc<DxvkBuffer>&           dstBuffer,
+            VkDeviceSize              dstOffset,
+      const Rc<DxvkImage>&            srcImage,
+            VkImageSubresourceLayers  srcSubresource,
+            VkOffset3D                srcOffset,
+            VkExtent3D                srcExtent);
+    
     /**
      * \brief Starts compute jobs
      * 
@@ -247,6 +285,21 @@ namespace dxvk {
       const Rc<DxvkImage>&           image,
       const VkImageSubresourceRange& subresources);
     
+    /**
+     * \brief Invalidates a buffer's contents
+     * 
+     * Replaces the physical buffer that backs the given
+     * buffer with one that is not in use by the GPU, and
+     * updates all bindings that reference the buffer.
+     * Commands recorded before this call still access
+     * the previous physical buffer. Buffer views are not
+     * updated, so this must not be used on buffers that
+     * are bound as texel buffers.
+     * \param [in] buffer The buffer to invalidate
+     */
+    void invalidateBuffer(
+      const Rc<DxvkBuffer>&           buffer);
+    
     /**
      * \brief Resolves a multisampled image resource
      * 
@@ -403,15 +456,33 @@ namespace dxvk {
     DxvkShaderResourceSlots m_cResources = {  256 };
     DxvkShaderResourceSlots m_gResources = { 1024 };
     
+    bool m_asyncPipelines = false;
+    
     void renderPassBegin();
     void renderPassEnd();
     
     void updateComputePipeline();
-    void updateGraphicsPipeline();
+    bool updateGraphicsPipeline();
     
     void updateComputeShaderResources();
     void updateGraphicsShaderResources();
     
+    void updateShaderResources(
+            VkPipelineBindPoint       bindPoint,
+      const Rc<DxvkBindingLayout>&    layout,
+            DxvkShaderResourceSlots&  resources,
+            DxvkDescriptorSetState&   dsets);
+    
+    void trackShaderResources(
+      const DxvkBindingLayout&        layout,
+            uint32_t                  setId,
+      const DxvkShaderResourceSlots&  resources);
+    
+    void updateResourceBuffer(
+            DxvkShaderResourceSlots&  resources,
+            DxvkContextFlag           dirtyFlag,
+      const Rc<DxvkBuffer>&           buffer);
+    
     void updateDynamicState();
     void updateViewports();
     void updateBlendConstants();
@@ -421,7 +492,7 @@ namespace dxvk {
     void updateVertexBufferBindings();
     
     void commitComputeState();
-    void commitGraphicsState();
+    bool commitGraphicsState();
     
     void commitComputeBarriers();
     
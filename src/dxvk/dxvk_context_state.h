@@ -69,6 +69,21 @@ namespace dxvk {
   };
   
   
+  /**
+   * \brief Bound descriptor sets
+   * 
+   * Stores the descriptor sets that are currently
+   * bound to a pipeline bind point, as well as the
+   * layout that they were written for.
+   */
+  struct DxvkDescriptorSetState {
+    Rc<DxvkBindingLayout> layout;
+    
+    std::array<VkDescriptorSet,
+      DxvkLimits::MaxNumDescriptorSets> sets;
+  };
+  
+  
   struct DxvkGraphicsPipelineState {
     DxvkShaderStage vs;
     DxvkShaderStage tcs;
@@ -77,12 +92,14 @@ namespace dxvk {
     DxvkShaderStage fs;
     
     Rc<DxvkGraphicsPipeline> pipeline;
+    DxvkDescriptorSetState   dsets;
   };
   
   
   struct DxvkComputePipelineState {
     DxvkShaderStage         cs;
     Rc<DxvkComputePipeline> pipeline;
+    DxvkDescriptorSetState  dsets;
   };
   
   
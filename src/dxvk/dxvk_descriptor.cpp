@@ -2,6 +2,35 @@
 
 namespace dxvk {
   
+  size_t DxvkDescriptorInfo::hash() const {
+    DxvkHashState result;
+    result.add(std::hash<VkSampler>    ()(image.sampler));
+    result.add(std::hash<VkImageView>  ()(image.imageView));
+    result.add(std::hash<uint32_t>     ()(image.imageLayout));
+    result.add(std::hash<VkBuffer>     ()(buffer.buffer));
+    result.add(std::hash<VkDeviceSize> ()(buffer.offset));
+    result.add(std::hash<VkDeviceSize> ()(buffer.range));
+    result.add(std::hash<VkBufferView> ()(texelBuffer));
+    return result;
+  }
+  
+  
+  bool DxvkDescriptorInfo::operator == (const DxvkDescriptorInfo& other) const {
+    return image.sampler     == other.image.sampler
+        && image.imageView   == other.image.imageView
+        && image.imageLayout == other.image.imageLayout
+        && buffer.buffer     == other.buffer.buffer
+        && buffer.offset     == other.buffer.offset
+        && buffer.range      == other.buffer.range
+        && texelBuffer       == other.texelBuffer;
+  }
+  
+  
+  bool DxvkDescriptorInfo::operator != (const DxvkDescriptorInfo& other) const {
+    return !this->operator == (other);
+  }
+  
+  
   DxvkDescriptorAlloc::DxvkDescriptorAlloc(
     const Rc<vk::DeviceFn>& vkd)
   : m_vkd(vkd) {
@@ -53,14 +82,15 @@ namespace dxvk {
     constexpr uint32_t MaxSets = 64;
     constexpr uint32_t MaxDesc = 256;
     
-    std::array<VkDescriptorPoolSize, 7> pools = {{
-      { VK_DESCRIPTOR_TYPE_SAMPLER,               MaxDesc },
-      { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,         MaxDesc },
-      { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,         MaxDesc },
-      { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,        MaxDesc },
-      { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,        MaxDesc },
-      { VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,  MaxDesc },
-      { VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,  MaxDesc } }};
+    std::array<VkDescriptorPoolSize, 8> pools = {{
+      { VK_DESCRIPTOR_TYPE_SAMPLER,                MaxDesc },
+      { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,          MaxDesc },
+      { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          MaxDesc },
+      { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         MaxDesc },
+      { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MaxDesc },
+      { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         MaxDesc },
+      { VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,   MaxDesc },
+      { VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,   MaxDesc } }};
     
     VkDescriptorPoolCreateInfo info;
     info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -94,4 +124,73 @@ namespace dxvk {
     return set;
   }
   
+  
+  DxvkDescriptorSetCache:: DxvkDescriptorSetCache() { }
+  DxvkDescriptorSetCache::~DxvkDescriptorSetCache() { }
+  
+  
+  VkDescriptorSet DxvkDescriptorSetCache::find(
+          VkDescriptorSetLayout layout,
+          uint32_t              descriptorCount,
+    const DxvkDescriptorInfo*   descriptorInfos,
+          size_t                hash) const {
+    auto range = m_entries.equal_range(hash);
+    
+    for (auto e = range.first; e != range.second; e++) {
+      const Entry& entry = e->second;
+      
+      if (entry.layout    != layout
+       || entry.dataCount != descriptorCount)
+        continue;
+      
+      bool equal = true;
+      
+      for (uint32_t i = 0; i < descriptorCount && equal; i++)
+        equal = m_data[entry.dataOffset + i] == descriptorInfos[i];
+      
+      if (equal)
+        return entry.set;
+    }
+    
+    return VK_NULL_HANDLE;
+  }
+  
+  
+  void DxvkDescriptorSetCache::insert(
+          VkDescriptorSetLayout layout,
+          uint32_t              descriptorCount,
+    const DxvkDescriptorInfo*   descriptorInfos,
+          size_t                hash,
+          VkDescriptorSet       set) {
+    Entry entry;
+    entry.layout     = layout;
+    entry.dataOffset = m_data.size();
+    entry.dataCount  = descriptorCount;
+    entry.set        = set;
+    
+    m_data.insert(m_data.end(), descriptorInfos,
+      descriptorInfos + descriptorCount);
+    m_entries.insert({ hash, entry });
+  }
+  
+  
+  void DxvkDescriptorSetCache::reset() {
+    m_entries.clear();
+    m_data.clear();
+  }
+  
+  
+  size_t DxvkDescriptorSetCache::computeHash(
+          VkDescriptorSetLayout layout,
+          uint32_t              descriptorCount,
+    const DxvkDescriptorInfo*   descriptorInfos) {
+    DxvkHashState result;
+    result.add(std::hash<VkDescriptorSetLayout>()(layout));
+    
+    for (uint32_t i = 0; i < descriptorCount; i++)
+      result.add(descriptorInfos[i].hash());
+    
+    return result;
+  }
+  
 }
\ No newline at end of file
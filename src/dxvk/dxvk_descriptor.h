@@ -1,5 +1,8 @@
 #pragma once
 
+#include <unordered_map>
+
+#include "dxvk_hash.h"
 #include "dxvk_include.h"
 
 namespace dxvk {
@@ -14,6 +17,11 @@ namespace dxvk {
     VkDescriptorImageInfo  image       = { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED };
     VkDescriptorBufferInfo buffer      = { VK_NULL_HANDLE, 0, 0 };
     VkBufferView           texelBuffer = VK_NULL_HANDLE;
+    
+    size_t hash() const;
+    
+    bool operator == (const DxvkDescriptorInfo& other) const;
+    bool operator != (const DxvkDescriptorInfo& other) const;
   };
   
   
@@ -66,4 +74,87 @@ namespace dxvk {
     
   };
   
+  
+  /**
+   * \brief Descriptor set cache
+   * 
+   * Maps descriptor set contents to descriptor sets that
+   * have already been written, so that draws which use the
+   * same resources as a previous draw can reuse the set.
+   * Only valid for as long as the descriptor sets are,
+   * i.e. until the descriptor allocator is reset.
+   */
+  class DxvkDescriptorSetCache {
+    
+  public:
+    
+    DxvkDescriptorSetCache();
+    ~DxvkDescriptorSetCache();
+    
+    DxvkDescriptorSetCache             (const DxvkDescriptorSetCache&) = delete;
+    DxvkDescriptorSetCache& operator = (const DxvkDescriptorSetCache&) = delete;
+    
+    /**
+     * \brief Looks up a descriptor set
+     * 
+     * \param [in] layout Descriptor set layout
+     * \param [in] descriptorCount Number of descriptors
+     * \param [in] descriptorInfos Descriptors, in binding order
+     * \param [in] hash Hash as returned by \ref computeHash
+     * \returns The descriptor set, or \c VK_NULL_HANDLE
+     */
+    VkDescriptorSet find(
+            VkDescriptorSetLayout layout,
+            uint32_t              descriptorCount,
+      const DxvkDescriptorInfo*   descriptorInfos,
+            size_t                hash) const;
+    
+    /**
+     * \brief Adds a descriptor set
+     * 
+     * \param [in] layout Descriptor set layout
+     * \param [in] descriptorCount Number of descriptors
+     * \param [in] descriptorInfos Descriptors, in binding order
+     * \param [in] hash Hash as returned by \ref computeHash
+     * \param [in] set Descriptor set with the given contents
+     */
+    void insert(
+            VkDescriptorSetLayout layout,
+            uint32_t              descriptorCount,
+      const DxvkDescriptorInfo*   descriptorInfos,
+            size_t                hash,
+            VkDescriptorSet       set);
+    
+    /**
+     * \brief Removes all descriptor sets
+     */
+    void reset();
+    
+    /**
+     * \brief Computes the hash of descriptor set contents
+     * 
+     * \param [in] layout Descriptor set layout
+     * \param [in] descriptorCount Number of descriptors
+     * \param [in] descriptorInfos Descriptors, in binding order
+     * \returns Hash value
+     */
+    static size_t computeHash(
+            VkDescriptorSetLayout layout,
+            uint32_t              descriptorCount,
+      const DxvkDescriptorInfo*   descriptorInfos);
+    
+  private:
+    
+    struct Entry {
+      VkDescriptorSetLayout layout;
+      uint32_t              dataOffset;
+      uint32_t              dataCount;
+      VkDescriptorSet       set;
+    };
+    
+    std::unordered_multimap<size_t, Entry> m_entries;
+    std::vector<DxvkDescriptorInfo>        m_data;
+    
+  };
+  
 }
\ No newline at end of file
@@ -6,79 +6,61 @@ namespace dxvk {
   DxvkDevice::DxvkDevice(
     const Rc<DxvkAdapter>&          adapter,
     const Rc<vk::DeviceFn>&         vkd,
+    const DxvkDeviceExtensions&     extensions,
     const VkPhysicalDeviceFeatures& features)
   : m_adapter         (adapter),
     m_vkd             (vkd),
+    m_extensions      (extensions),
     m_features        (features),
     m_memory          (new DxvkMemoryAllocator(adapter, vkd)),
     m_renderPassPool  (new DxvkRenderPassPool (vkd)),
-    m_pipelineManager (new DxvkPipelineManager(vkd)) {
-    m_vkd->vkGetDeviceQueue(m_vkd->device(),
-      m_adapter->graphicsQueueFamily(), 0,
-      &m_graphicsQueue);
-    m_vkd->vkGetDeviceQueue(m_vkd->device(),
-      m_adapter->presentQueueFamily(), 0,
-      &m_presentQueue);
+    m_pipelineManager (new DxvkPipelineManager(vkd, extensions,
+      adapter->deviceProperties(), m_renderPassPool)),
+    m_stagingRing     (new DxvkStagingRing    (this)),
+    m_shaderCompiler  (new DxvkShaderCompiler (getShaderCompilerThreadCount())),
+    m_submissionQueue (this),
+    m_submitThread    (vkd, &m_submissionQueue,
+      getQueue(adapter->graphicsQueueFamily()),
+      getQueue(adapter->transferQueueFamily()),
+      getQueue(adapter->presentQueueFamily())) {
+    
   }
   
   
   DxvkDevice::~DxvkDevice() {
     // Wait for all pending Vulkan commands to be
     // executed before we destroy any resources.
+    m_submitThread.synchronize();
     m_vkd->vkDeviceWaitIdle(m_vkd->device());
   }
   
   
-  Rc<DxvkStagingBuffer> DxvkDevice::allocStagingBuffer(VkDeviceSize size) {
-    // In case we need a standard-size staging buffer, try
-    // to recycle an old one that has been returned earlier
-    if (size <= DefaultStagingBufferSize) {
-      const Rc<DxvkStagingBuffer> buffer
-        = m_recycledStagingBuffers.retrieveObject();
-      
-      if (buffer != nullptr)
-        return buffer;
-    }
-    
-    // Staging buffers only need to be able to handle transfer
-    // operations, and they need to be in host-visible memory.
-    DxvkBufferCreateInfo info;
-    info.size   = size;
-    info.usage  = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    info.stages = VK_PIPELINE_STAGE_TRANSFER_BIT
-                | VK_PIPELINE_STAGE_HOST_BIT;
-    info.access = VK_ACCESS_TRANSFER_READ_BIT
-                | VK_ACCESS_HOST_WRITE_BIT;
-    
-    VkMemoryPropertyFlags memFlags
-      = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-      | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    
-    // Don't create buffers that are too small. A staging
-    // buffer should be able to serve multiple uploads.
-    if (info.size < DefaultStagingBufferSize)
-      info.size = DefaultStagingBufferSize;
-    
-    return new DxvkStagingBuffer(this->createBuffer(info, memFlags));
+  bool DxvkDevice::hasTransferQueue() const {
+    return m_adapter->transferQueueFamily()
+        != m_adapter->graphicsQueueFamily();
   }
   
   
-  void DxvkDevice::recycleStagingBuffer(const Rc<DxvkStagingBuffer>& buffer) {
-    // Drop staging buffers that are bigger than the
-    // standard ones to save memory, recycle the rest
-    if (buffer->size() == DefaultStagingBufferSize) {
-      m_recycledStagingBuffers.returnObject(buffer);
-      buffer->reset();
+  Rc<DxvkCommandList> DxvkDevice::createCommandList() {
+    Rc<DxvkCommandList> cmdList = m_recycledCommandLists.retrieveObject();
+    
+    if (cmdList == nullptr) {
+      cmdList = new DxvkCommandList(m_vkd, this,
+        DxvkQueueType::Graphics,
+        m_adapter->graphicsQueueFamily());
     }
+    
+    return cmdList;
   }
   
   
-  Rc<DxvkCommandList> DxvkDevice::createCommandList() {
-    Rc<DxvkCommandList> cmdList = m_recycledCommandLists.retrieveObject();
+  Rc<DxvkCommandList> DxvkDevice::createTransferCommandList() {
+    Rc<DxvkCommandList> cmdList = m_recycledTransferLists.retrieveObject();
     
     if (cmdList == nullptr) {
-      cmdList = new DxvkCommandList(m_vkd,
-        this, m_adapter->graphicsQueueFamily());
+      cmdList = new DxvkCommandList(m_vkd, this,
+        DxvkQueueType::Transfer,
+        m_adapter->transferQueueFamily());
     }
     
     return cmdList;
@@ -90,6 +72,14 @@ namespace dxvk {
   }
   
   
+  Rc<DxvkTransferContext> DxvkDevice::createTransferContext() {
+    if (!this->hasTransferQueue())
+      throw DxvkError("DxvkDevice::createTransferContext: No transfer queue");
+    
+    return new DxvkTransferContext(this);
+  }
+  
+  
   Rc<DxvkFramebuffer> DxvkDevice::createFramebuffer(
     const DxvkRenderTargets& renderTargets) {
     auto format = renderTargets.renderPassFormat();
@@ -169,6 +159,21 @@ namespace dxvk {
   }
   
   
+  Rc<DxvkShader> DxvkDevice::registerShader(
+    const Rc<DxvkShader>&           shader) {
+    return m_pipelineManager->registerShader(shader);
+  }
+  
+  
+  void DxvkDevice::queueShaderCompilation(
+    const Rc<DxvkShader>&           shader,
+          uint32_t                  dwordCount,
+          DxvkShaderCompiler::CompileFn&& compileFn) {
+    m_shaderCompiler->queueCompilation(
+      shader, dwordCount, std::move(compileFn));
+  }
+  
+  
   Rc<DxvkSwapchain> DxvkDevice::createSwapchain(
     const Rc<DxvkSurface>&          surface,
     const DxvkSwapchainProperties&  properties) {
@@ -177,11 +182,23 @@ namespace dxvk {
   
   
   VkResult DxvkDevice::presentSwapImage(
-    const VkPresentInfoKHR&         presentInfo) {
+          VkSwapchainKHR            swapchain,
+          uint32_t                  imageIndex,
+    const Rc<DxvkSemaphore>&        waitSync) {
     m_statCounters.increment(DxvkStat::DevQueuePresents, 1);
     
-    std::lock_guard<std::mutex> lock(m_submissionLock);
-    return m_vkd->vkQueuePresentKHR(m_presentQueue, &presentInfo);
+    // Waiting for the result of this present operation would
+    // stall the calling thread, so errors are intentionally
+    // reported with a delay of one frame. Swap chain errors
+    // are also caught when acquiring the next image.
+    VkResult status = m_submitThread.presentStatus();
+    m_submitThread.present(swapchain, imageIndex, waitSync);
+    return status;
+  }
+  
+  
+  void DxvkDevice::synchronizePresents() {
+    m_submitThread.synchronizePresents();
   }
   
   
@@ -191,41 +208,100 @@ namespace dxvk {
     const Rc<DxvkSemaphore>&        wakeSync) {
     Rc<DxvkFence> fence = new DxvkFence(m_vkd);
     
-    VkSemaphore waitSemaphore = VK_NULL_HANDLE;
-    VkSemaphore wakeSemaphore = VK_NULL_HANDLE;
-    
-    if (waitSync != nullptr) {
-      waitSemaphore = waitSync->handle();
+    if (waitSync != nullptr)
       commandList->trackResource(waitSync);
-    }
     
-    if (wakeSync != nullptr) {
-      wakeSemaphore = wakeSync->handle();
+    if (wakeSync != nullptr)
       commandList->trackResource(wakeSync);
-    }
     
-    { // Queue submissions are not thread safe
-      std::lock_guard<std::mutex> lock(m_submissionLock);
-      commandList->submit(m_graphicsQueue,
-        waitSemaphore, wakeSemaphore, fence->handle());
-    }
+    // The submission thread owns the device queues. Once
+    // the command list is submitted, it will be reset and
+    // recycled by the submission queue upon completion.
+    m_statCounters.addCounters(commandList->statCounters());
+    m_statCounters.increment(DxvkStat::DevQueueSubmissions, 1);
     
-    // TODO Delay synchronization by putting these into a ring buffer
-    fence->wait(std::numeric_limits<uint64_t>::max());
-    commandList->reset();
+    // Submission IDs must be retired in ascending order,
+    // so they are assigned in the order of submission.
+    { std::lock_guard<std::mutex> lock(m_submissionLock);
+      commandList->notifySubmit(++m_submissionId);
+      m_submitThread.submit(commandList, fence, waitSync, wakeSync);
+    }
     
-    // FIXME this must go away once the ring buffer is implemented
-    m_recycledCommandLists.returnObject(commandList);
-    m_statCounters.increment(DxvkStat::DevQueueSubmissions, 1);
     return fence;
   }
   
   
   void DxvkDevice::waitForIdle() {
     m_statCounters.increment(DxvkStat::DevSynchronizations, 1);
+    m_submitThread.synchronize();
     
     if (m_vkd->vkDeviceWaitIdle(m_vkd->device()) != VK_SUCCESS)
       throw DxvkError("DxvkDevice::waitForIdle: Operation failed");
+    
+    m_submissionQueue.synchronize();
+  }
+  
+  
+  void DxvkDevice::waitForResource(
+    const Rc<DxvkResource>&         resource) {
+    const uint64_t submissionId = resource->lastSubmission();
+    
+    if (m_submissionQueue.retiredSubmission() < submissionId) {
+      m_statCounters.increment(DxvkStat::DevResourceWaits, 1);
+      m_submissionQueue.waitForSubmission(submissionId);
+    }
+  }
+  
+  
+  DxvkStatCounters DxvkDevice::queryCounters() const {
+    DxvkStatCounters counters = m_statCounters;
+    counters.set(DxvkStat::DevQueuePendingOps, m_submitThread.pending());
+    
+    DxvkStagingRingStats stagingStats = m_stagingRing->stats();
+    counters.set(DxvkStat::DevStagingRingSize,  stagingStats.ringSize  >> 10);
+    counters.set(DxvkStat::DevStagingHighWater, stagingStats.highWater >> 10);
+    
+    DxvkPipelineCompilerStats compilerStats = m_pipelineManager->compilerStats();
+    counters.set(DxvkStat::DevPipelineCompiles,  compilerStats.numCompiled);
+    counters.set(DxvkStat::DevPipelineTimeTotal, compilerStats.totalTimeUs / 1000);
+    counters.set(DxvkStat::DevPipelineTimeMax,   compilerStats.maxTimeUs   / 1000);
+    counters.set(DxvkStat::DevPipelineQueued,    compilerStats.queueDepth);
+    
+    DxvkPipelineCacheStats cacheStats = m_pipelineManager->cacheStats();
+    counters.set(DxvkStat::DevPipeCacheLoaded, cacheStats.loadedSize >> 10);
+    counters.set(DxvkStat::DevPipeCacheSaved,  cacheStats.savedSize  >> 10);
+    
+    DxvkShaderCompilerStats shaderStats = m_shaderCompiler->stats();
+    counters.set(DxvkStat::DevShaderCompiles,  shaderStats.numCompiled);
+    counters.set(DxvkStat::DevShaderDwords,    shaderStats.numDwords);
+    counters.set(DxvkStat::DevShaderTimeTotal, shaderStats.busyTimeUs / 1000);
+    counters.set(DxvkStat::DevShaderQueued,    shaderStats.queueDepth);
+    return counters;
+  }
+  
+  
+  VkQueue DxvkDevice::getQueue(uint32_t family) const {
+    VkQueue queue = VK_NULL_HANDLE;
+    m_vkd->vkGetDeviceQueue(m_vkd->device(), family, 0, &queue);
+    return queue;
+  }
+  
+  
+  uint32_t DxvkDevice::getShaderCompilerThreadCount() {
+    const std::string threadCount = env::getEnvVar(L"DXVK_SHADER_COMPILER_THREADS");
+    
+    if (threadCount.size() != 0)
+      return std::strtoul(threadCount.c_str(), nullptr, 10);
+    
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+  
+  
+  void DxvkDevice::recycleCommandList(const Rc<DxvkCommandList>& cmdList) {
+    if (cmdList->queueType() == DxvkQueueType::Transfer)
+      m_recycledTransferLists.returnObject(cmdList);
+    else
+      m_recycledCommandLists.returnObject(cmdList);
   }
   
 }
\ No newline at end of file
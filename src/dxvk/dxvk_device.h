@@ -9,13 +9,18 @@
 #include "dxvk_image.h"
 #include "dxvk_memory.h"
 #include "dxvk_pipemanager.h"
+#include "dxvk_queue.h"
 #include "dxvk_recycler.h"
 #include "dxvk_renderpass.h"
 #include "dxvk_sampler.h"
 #include "dxvk_shader.h"
+#include "dxvk_shadercache.h"
+#include "dxvk_shadercompiler.h"
 #include "dxvk_stats.h"
+#include "dxvk_submit.h"
 #include "dxvk_swapchain.h"
 #include "dxvk_sync.h"
+#include "dxvk_transfer.h"
 
 namespace dxvk {
   
@@ -30,12 +35,13 @@ namespace dxvk {
    * contexts. Multiple contexts can be created for a device.
    */
   class DxvkDevice : public RcObject {
-    constexpr static VkDeviceSize DefaultStagingBufferSize = 64 * 1024 * 1024;
+    friend class DxvkSubmissionQueue;
   public:
     
     DxvkDevice(
       const Rc<DxvkAdapter>&          adapter,
       const Rc<vk::DeviceFn>&         vkd,
+      const DxvkDeviceExtensions&     extensions,
       const VkPhysicalDeviceFeatures& features);
       
     ~DxvkDevice();
@@ -67,6 +73,14 @@ namespace dxvk {
       return m_adapter;
     }
     
+    /**
+     * \brief Enabled optional extensions
+     * \returns Enabled extensions
+     */
+    const DxvkDeviceExtensions& extensions() const {
+      return m_extensions;
+    }
+    
     /**
      * \brief Enabled device features
      * \returns Enabled features
@@ -76,27 +90,24 @@ namespace dxvk {
     }
     
     /**
-     * \brief Allocates a staging buffer
+     * \brief Staging ring
      * 
-     * Returns a staging buffer that is at least as large
-     * as the requested size. It is usually bigger so that
-     * a single staging buffer may serve multiple allocations.
-     * \param [in] size Minimum buffer size
-     * \returns The staging buffer
+     * Device-wide staging memory from which command
+     * lists allocate slices for data uploads.
+     * \returns The staging ring
      */
-    Rc<DxvkStagingBuffer> allocStagingBuffer(
-            VkDeviceSize size);
+    Rc<DxvkStagingRing> stagingRing() const {
+      return m_stagingRing;
+    }
     
     /**
-     * \brief Recycles a staging buffer
+     * \brief Checks for a dedicated transfer queue
      * 
-     * When a staging buffer is no longer needed, it should
-     * be returned to the device so that it can be reused
-     * for subsequent allocations.
-     * \param [in] buffer The buffer
+     * If this returns \c true, transfer contexts can
+     * be used to upload resources asynchronously.
+     * \returns \c true if the device has a transfer queue
      */
-    void recycleStagingBuffer(
-      const Rc<DxvkStagingBuffer>& buffer);
+    bool hasTransferQueue() const;
     
     /**
      * \brief Creates a command list
@@ -104,6 +115,16 @@ namespace dxvk {
      */
     Rc<DxvkCommandList> createCommandList();
     
+    /**
+     * \brief Creates a transfer command list
+     * 
+     * The command list can only be used for transfer
+     * operations and will be submitted to the device's
+     * transfer queue. Requires a dedicated transfer queue.
+     * \returns The command list
+     */
+    Rc<DxvkCommandList> createTransferCommandList();
+    
     /**
      * \brief Creates a context
      * 
@@ -113,6 +134,15 @@ namespace dxvk {
      */
     Rc<DxvkContext> createContext();
     
+    /**
+     * \brief Creates a transfer context
+     * 
+     * Creates a context that records uploads for the
+     * transfer queue. Requires a dedicated transfer queue.
+     * \returns The transfer context
+     */
+    Rc<DxvkTransferContext> createTransferContext();
+    
     /**
      * \brief Creates framebuffer for a set of render targets
      * 
@@ -223,6 +253,34 @@ namespace dxvk {
       const Rc<DxvkShader>&           gs,
       const Rc<DxvkShader>&           fs);
     
+    /**
+     * \brief Registers a shader
+     * 
+     * Should be called for all shaders created by the
+     * application, so that pipelines recorded in the
+     * state cache can be compiled ahead of time.
+     * \param [in] shader The shader
+     * \returns Shader object to use in its place
+     */
+    Rc<DxvkShader> registerShader(
+      const Rc<DxvkShader>&           shader);
+    
+    /**
+     * \brief Compiles a shader asynchronously
+     * 
+     * Runs the given compile function on a worker
+     * thread and completes the pending shader with
+     * the result. The number of worker threads can
+     * be set with \c DXVK_SHADER_COMPILER_THREADS.
+     * \param [in] shader The pending shader
+     * \param [in] dwordCount Source code size
+     * \param [in] compileFn Compiles the shader
+     */
+    void queueShaderCompilation(
+      const Rc<DxvkShader>&           shader,
+            uint32_t                  dwordCount,
+            DxvkShaderCompiler::CompileFn&& compileFn);
+    
     /**
      * \brief Creates a swap chain
      * 
@@ -239,16 +297,34 @@ namespace dxvk {
      * 
      * This is implicitly called by the swap chain class
      * when presenting an image. Do not use this directly.
-     * \param [in] presentInfo Swap image present info
-     * \returns Present status
+     * The present operation is executed asynchronously.
+     * \param [in] swapchain Swap chain handle
+     * \param [in] imageIndex Index of the image to present
+     * \param [in] waitSync Semaphore to wait on
+     * \returns Status of the previous present operation
      */
     VkResult presentSwapImage(
-      const VkPresentInfoKHR&         presentInfo);
+            VkSwapchainKHR            swapchain,
+            uint32_t                  imageIndex,
+      const Rc<DxvkSemaphore>&        waitSync);
+    
+    /**
+     * \brief Waits for queued present operations
+     * 
+     * Must be called before acquiring an image from a swap
+     * chain, since present operations are executed on the
+     * submission thread and swap chain access must be
+     * externally synchronized.
+     */
+    void synchronizePresents();
     
     /**
      * \brief Submits a command list
      * 
-     * Synchronization arguments are optional. 
+     * Synchronization arguments are optional. This does
+     * not wait for the command list to complete execution.
+     * Instead, the command list will be reset and recycled
+     * by the submission queue once its fence is signaled.
      * \param [in] commandList The command list to submit
      * \param [in] waitSync (Optional) Semaphore to wait on
      * \param [in] wakeSync (Optional) Semaphore to notify
@@ -265,38 +341,64 @@ namespace dxvk {
      * Waits for the GPU to complete the execution of all
      * previously submitted command buffers. This may be
      * used to ensure that resources that were previously
-     * used by the GPU can be safely destroyed.
+     * used by the GPU can be safely destroyed. Also waits
+     * for all in-flight command lists to be retired, so
+     * that tracked resources are no longer in use.
      */
     void waitForIdle();
     
+    /**
+     * \brief Waits for a resource to become available
+     * 
+     * Waits only for the submissions that use the given
+     * resource rather than for the entire device. Command
+     * lists using the resource that have not been submitted
+     * yet are not considered, so these must be submitted
+     * before calling this.
+     * \param [in] resource The resource to wait for
+     */
+    void waitForResource(
+      const Rc<DxvkResource>&         resource);
+    
     /**
      * \brief Retrieves stat counters
      * \returns Stat counters
      */
-    DxvkStatCounters queryCounters() const {
-      return m_statCounters;
-    }
+    DxvkStatCounters queryCounters() const;
     
   private:
     
     Rc<DxvkAdapter>           m_adapter;
     Rc<vk::DeviceFn>          m_vkd;
+    DxvkDeviceExtensions      m_extensions;
     VkPhysicalDeviceFeatures  m_features;
     
     Rc<DxvkMemoryAllocator> m_memory;
     Rc<DxvkRenderPassPool>  m_renderPassPool;
     Rc<DxvkPipelineManager> m_pipelineManager;
-    
-    std::mutex m_submissionLock;
-    VkQueue m_graphicsQueue = VK_NULL_HANDLE;
-    VkQueue m_presentQueue  = VK_NULL_HANDLE;
+    Rc<DxvkStagingRing>     m_stagingRing;
+    Rc<DxvkShaderCompiler>  m_shaderCompiler;
     
     // TODO fine-tune buffer sizes
-    DxvkRecycler<DxvkCommandList,  16> m_recycledCommandLists;
-    DxvkRecycler<DxvkStagingBuffer, 4> m_recycledStagingBuffers;
+    DxvkRecycler<DxvkCommandList, 16> m_recycledCommandLists;
+    DxvkRecycler<DxvkCommandList, 4>  m_recycledTransferLists;
     
     DxvkStatCounters m_statCounters;
     
+    std::mutex  m_submissionLock;
+    uint64_t    m_submissionId = 0;
+    
+    DxvkSubmissionQueue m_submissionQueue;
+    DxvkSubmitThread    m_submitThread;
+    
+    VkQueue getQueue(
+            uint32_t                  family) const;
+    
+    static uint32_t getShaderCompilerThreadCount();
+    
+    void recycleCommandList(
+      const Rc<DxvkCommandList>& cmdList);
+    
   };
   
 }
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "dxvk_include.h"
+
+namespace dxvk {
+  
+  /**
+   * \brief Optional instance extensions
+   * 
+   * Stores which of the optional instance extensions
+   * have been enabled when creating the instance, so
+   * that device extensions depending on them can be
+   * enabled as well.
+   */
+  struct DxvkInstanceExtensions {
+    bool khrGetPhysicalDeviceProperties2 = false;
+  };
+  
+  
+  /**
+   * \brief Optional device extensions
+   * 
+   * Stores which of the optional device extensions
+   * have been enabled when creating the device, so
+   * that other objects can use them if available.
+   */
+  struct DxvkDeviceExtensions {
+    bool khrDescriptorUpdateTemplate = false;
+    bool khrPushDescriptor           = false;
+  };
+  
+}
\ No newline at end of file
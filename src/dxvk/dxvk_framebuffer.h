@@ -139,6 +139,14 @@ namespace dxvk {
       return m_renderPass->handle();
     }
     
+    /**
+     * \brief Render pass format
+     * \returns Render target formats
+     */
+    const DxvkRenderPassFormat& renderPassFormat() const {
+      return m_renderPass->format();
+    }
+    
     /**
      * \brief Framebuffer size
      * \returns Framebuffer size
@@ -1,6 +1,13 @@
+#include <chrono>
 #include <cstring>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 #include "dxvk_graphics.h"
+#include "dxvk_pipecompiler.h"
+#include "dxvk_statecache.h"
 
 namespace dxvk {
   
@@ -22,36 +29,195 @@ namespace dxvk {
   }
   
   
-  size_t DxvkGraphicsPipelineStateHash::operator () (
-    const DxvkGraphicsPipelineStateInfo& state) const {
-    // TODO implement hash
-    return 0;
+  static uint32_t floatBits(float f) {
+    uint32_t result;
+    std::memcpy(&result, &f, sizeof(result));
+    return result;
+  }
+  
+  
+  static uint32_t packStencilOps(const VkStencilOpState& state) {
+    return uint32_t(state.failOp)
+         | uint32_t(state.passOp)      << 3
+         | uint32_t(state.depthFailOp) << 6
+         | uint32_t(state.compareOp)   << 9;
+  }
+  
+  
+  DxvkGraphicsPipelineStateKey::DxvkGraphicsPipelineStateKey() {
+    std::memset(m_words, 0, sizeof(m_words));
+  }
+  
+  
+  DxvkGraphicsPipelineStateKey::DxvkGraphicsPipelineStateKey(
+    const DxvkGraphicsPipelineStateInfo& state) {
+    std::memset(m_words, 0, sizeof(m_words));
+    
+    m_words[WordStateFlags]
+      = uint32_t(state.iaPrimitiveTopology)
+      | uint32_t(state.iaPrimitiveRestart)      <<  4
+      | uint32_t(state.rsEnableDepthClamp)      <<  5
+      | uint32_t(state.rsEnableDiscard)         <<  6
+      | uint32_t(state.rsPolygonMode)           <<  7
+      | uint32_t(state.rsCullMode)              <<  9
+      | uint32_t(state.rsFrontFace)             << 11
+      | uint32_t(state.rsDepthBiasEnable)       << 12
+      | uint32_t(state.rsViewportCount)         << 13
+      | uint32_t(state.msSampleCount)           << 18
+      | uint32_t(state.msEnableAlphaToCoverage) << 25
+      | uint32_t(state.msEnableAlphaToOne)      << 26
+      | uint32_t(state.msEnableSampleShading)   << 27
+      | uint32_t(state.dsEnableDepthTest)       << 28
+      | uint32_t(state.dsEnableDepthWrite)      << 29
+      | uint32_t(state.dsEnableDepthBounds)     << 30
+      | uint32_t(state.dsEnableStencilTest)     << 31;
+    
+    m_words[WordStateEnums]
+      = uint32_t(state.dsEnableDepthTest ? state.dsDepthCompareOp : 0)
+      | uint32_t(state.omEnableLogicOp)         <<  3
+      | uint32_t(state.omEnableLogicOp ? state.omLogicOp : 0) << 4
+      | uint32_t(state.ilAttributeCount)        <<  8
+      | uint32_t(state.ilBindingCount)          << 14;
+    
+    m_words[WordSampleMask] = state.msSampleMask;
+    
+    // Floating point state is only relevant
+    // if the corresponding feature is enabled
+    if (state.rsDepthBiasEnable) {
+      m_words[WordFloatState + 0] = floatBits(state.rsDepthBiasConstant);
+      m_words[WordFloatState + 1] = floatBits(state.rsDepthBiasClamp);
+      m_words[WordFloatState + 2] = floatBits(state.rsDepthBiasSlope);
+    }
+    
+    if (state.msEnableSampleShading)
+      m_words[WordFloatState + 3] = floatBits(state.msMinSampleShading);
+    
+    if (state.dsEnableDepthBounds) {
+      m_words[WordFloatState + 4] = floatBits(state.dsDepthBoundsMin);
+      m_words[WordFloatState + 5] = floatBits(state.dsDepthBoundsMax);
+    }
+    
+    // The stencil reference is a dynamic state
+    // and therefore not part of the pipeline key
+    if (state.dsEnableStencilTest) {
+      m_words[WordStencilOps + 0] = packStencilOps(state.dsStencilOpFront);
+      m_words[WordStencilOps + 1] = state.dsStencilOpFront.compareMask;
+      m_words[WordStencilOps + 2] = state.dsStencilOpFront.writeMask;
+      m_words[WordStencilOps + 3] = packStencilOps(state.dsStencilOpBack);
+      m_words[WordStencilOps + 4] = state.dsStencilOpBack.compareMask;
+      m_words[WordStencilOps + 5] = state.dsStencilOpBack.writeMask;
+    }
+    
+    const uint64_t renderPass = uint64_t(state.omRenderPass);
+    m_words[WordRenderPass + 0] = uint32_t(renderPass);
+    m_words[WordRenderPass + 1] = uint32_t(renderPass >> 32);
+    
+    // Formats and offsets of D3D11 input layouts fit
+    // into ten and twelve bits, respectively
+    for (uint32_t i = 0; i < state.ilAttributeCount; i++) {
+      m_words[WordAttributes + i]
+        = uint32_t(state.ilAttributes[i].location)
+        | uint32_t(state.ilAttributes[i].binding) <<  5
+        | uint32_t(state.ilAttributes[i].format)  << 10
+        | uint32_t(state.ilAttributes[i].offset)  << 20;
+    }
+    
+    for (uint32_t i = 0; i < state.ilBindingCount; i++) {
+      m_words[WordBindings + i]
+        = uint32_t(state.ilBindings[i].binding)
+        | uint32_t(state.ilBindings[i].inputRate) << 5
+        | uint32_t(state.ilBindings[i].stride)    << 6;
+    }
+    
+    for (uint32_t i = 0; i < DxvkLimits::MaxNumRenderTargets; i++) {
+      const VkPipelineColorBlendAttachmentState& blend = state.omBlendAttachments[i];
+      
+      uint32_t word = uint32_t(blend.colorWriteMask);
+      
+      if (blend.blendEnable) {
+        word |= 1u << 4
+             | uint32_t(blend.srcColorBlendFactor) <<  5
+             | uint32_t(blend.dstColorBlendFactor) << 10
+             | uint32_t(blend.colorBlendOp)        << 15
+             | uint32_t(blend.srcAlphaBlendFactor) << 18
+             | uint32_t(blend.dstAlphaBlendFactor) << 23
+             | uint32_t(blend.alphaBlendOp)        << 28;
+      }
+      
+      m_words[WordBlendModes + i] = word;
+    }
   }
   
   
-  size_t DxvkGraphicsPipelineStateEq::operator () (
-    const DxvkGraphicsPipelineStateInfo& a,
-    const DxvkGraphicsPipelineStateInfo& b) const {
-    return std::memcmp(&a, &b, sizeof(DxvkGraphicsPipelineStateInfo)) == 0;
+  size_t DxvkGraphicsPipelineStateKey::hash() const {
+    // Multiply pairs of words, offset by position-dependent
+    // constants, and accumulate the 64-bit products. There
+    // is no serial dependency between the multiplications,
+    // and each step maps to a single SIMD multiply-add.
+    uint64_t lanes[2] = { 0, 0 };
+    
+    for (uint32_t i = 0; i < WordCount; i += 4) {
+      for (uint32_t j = 0; j < 2; j++) {
+        const uint32_t k = i + 2 * j;
+        
+        lanes[j] += uint64_t(m_words[k + 0] + (k + 0) * 0x9e3779b9u + 0x7f4a7c15u)
+                  * uint64_t(m_words[k + 1] + (k + 1) * 0x9e3779b9u + 0x7f4a7c15u);
+      }
+    }
+    
+    DxvkHashState result;
+    result.add(size_t(lanes[0]));
+    result.add(size_t(lanes[0] >> 32));
+    result.add(size_t(lanes[1]));
+    result.add(size_t(lanes[1] >> 32));
+    return result;
+  }
+  
+  
+  bool DxvkGraphicsPipelineStateKey::operator == (const DxvkGraphicsPipelineStateKey& other) const {
+#if defined(__SSE2__) || defined(_M_X64)
+    for (uint32_t i = 0; i < WordCount; i += 4) {
+      const __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(m_words + i));
+      const __m128i b = _mm_load_si128(reinterpret_cast<const __m128i*>(other.m_words + i));
+      
+      if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, b)) != 0xFFFF)
+        return false;
+    }
+    
+    return true;
+#else
+    return std::memcmp(m_words, other.m_words, sizeof(m_words)) == 0;
+#endif
+  }
+  
+  
+  bool DxvkGraphicsPipelineStateKey::operator != (const DxvkGraphicsPipelineStateKey& other) const {
+    return !this->operator == (other);
   }
   
   
   DxvkGraphicsPipeline::DxvkGraphicsPipeline(
-      const Rc<vk::DeviceFn>& vkd,
-      const Rc<DxvkShader>&   vs,
-      const Rc<DxvkShader>&   tcs,
-      const Rc<DxvkShader>&   tes,
-      const Rc<DxvkShader>&   gs,
-      const Rc<DxvkShader>&   fs)
-  : m_vkd(vkd) {
+      const Rc<vk::DeviceFn>&       vkd,
+      const DxvkDeviceExtensions&   extensions,
+            uint32_t                maxDescriptorSets,
+      const Rc<DxvkPipelineCache>&  cache,
+            DxvkPipelineCompiler*   compiler,
+            DxvkStateCache*         stateCache,
+      const Rc<DxvkShader>&         vs,
+      const Rc<DxvkShader>&         tcs,
+      const Rc<DxvkShader>&         tes,
+      const Rc<DxvkShader>&         gs,
+      const Rc<DxvkShader>&         fs)
+  : m_vkd(vkd), m_cache(cache), m_compiler(compiler), m_stateCache(stateCache) {
     DxvkDescriptorSlotMapping slotMapping;
     if (vs  != nullptr) vs ->defineResourceSlots(slotMapping);
     if (tcs != nullptr) tcs->defineResourceSlots(slotMapping);
     if (tes != nullptr) tes->defineResourceSlots(slotMapping);
     if (gs  != nullptr) gs ->defineResourceSlots(slotMapping);
     if (fs  != nullptr) fs ->defineResourceSlots(slotMapping);
+    slotMapping.assignDescriptorSets(maxDescriptorSets);
     
-    m_layout = new DxvkBindingLayout(vkd,
+    m_layout = new DxvkBindingLayout(vkd, extensions,
       slotMapping.bindingCount(),
       slotMapping.bindingInfos());
     
@@ -60,6 +226,19 @@ namespace dxvk {
     if (tes != nullptr) m_tes = tes->createShaderModule(vkd, slotMapping);
     if (gs  != nullptr) m_gs  = gs ->createShaderModule(vkd, slotMapping);
     if (fs  != nullptr) m_fs  = fs ->createShaderModule(vkd, slotMapping);
+    
+    // Pipelines can only be recorded in the state cache
+    // if all shaders can be identified in future runs
+    const Rc<DxvkShader> shaders[] = { vs, tcs, tes, gs, fs };
+    
+    for (uint32_t i = 0; i < m_shaderKeys.size(); i++) {
+      if (shaders[i] != nullptr) {
+        m_shaderKeys[i] = shaders[i]->shaderKey();
+        
+        if (m_shaderKeys[i] == Sha1Hash())
+          m_stateCache = nullptr;
+      }
+    }
   }
   
   
@@ -69,15 +248,95 @@ namespace dxvk {
   
   
   VkPipeline DxvkGraphicsPipeline::getPipelineHandle(
-    const DxvkGraphicsPipelineStateInfo& state) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    const DxvkGraphicsPipelineStateInfo& state,
+    const DxvkRenderPassFormat&          format) {
+    const DxvkGraphicsPipelineStateKey key(state);
+    
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    
+    if (m_pipelines.find(key, pipeline))
+      return pipeline;
     
-    auto pair = m_pipelines.find(state);
-    if (pair != m_pipelines.end())
-      return pair->second;
+    // Only take the lock if the pipeline needs to be
+    // compiled. If a worker is already compiling the
+    // pipeline, wait for it rather than compiling the
+    // same pipeline a second time.
+    { std::unique_lock<std::mutex> lock(m_mutex);
+      
+      m_condOnCompile.wait(lock, [this, &key] {
+        return m_pending.find(key) == m_pending.end();
+      });
+      
+      if (m_pipelines.find(key, pipeline))
+        return pipeline;
+      
+      m_pending.insert(key);
+    }
+    
+    return this->compileInstance(state, format);
+  }
+  
+  
+  VkPipeline DxvkGraphicsPipeline::getPipelineHandleAsync(
+    const DxvkGraphicsPipelineStateInfo& state,
+    const DxvkRenderPassFormat&          format) {
+    const DxvkGraphicsPipelineStateKey key(state);
+    
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    
+    if (m_pipelines.find(key, pipeline))
+      return pipeline;
+    
+    { std::unique_lock<std::mutex> lock(m_mutex);
+      
+      if (m_pipelines.find(key, pipeline))
+        return pipeline;
+      
+      if (!m_pending.insert(key).second)
+        return VK_NULL_HANDLE;
+    }
+    
+    m_compiler->queueCompilation(this, state, format);
+    return VK_NULL_HANDLE;
+  }
+  
+  
+  VkPipeline DxvkGraphicsPipeline::compileInstance(
+    const DxvkGraphicsPipelineStateInfo& state,
+    const DxvkRenderPassFormat&          format) {
+    const DxvkGraphicsPipelineStateKey key(state);
+    
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    
+    // Failed pipelines are stored as null handles
+    // so that we do not try to compile them again
+    try {
+      auto t0 = std::chrono::high_resolution_clock::now();
+      pipeline = this->compilePipeline(state);
+      auto t1 = std::chrono::high_resolution_clock::now();
+      
+      m_compiler->addCompileTime(std::chrono::duration_cast<
+        std::chrono::microseconds>(t1 - t0).count());
+    } catch (const DxvkError& e) {
+      Logger::err(e.message());
+    }
+    
+    { std::unique_lock<std::mutex> lock(m_mutex);
+      m_pipelines.insert(key, pipeline);
+      m_pending.erase(key);
+    }
+    
+    m_condOnCompile.notify_all();
+    
+    if (pipeline != VK_NULL_HANDLE && m_stateCache != nullptr) {
+      DxvkStateCacheEntry entry;
+      entry.shaders = m_shaderKeys;
+      entry.format  = format;
+      entry.state   = state;
+      entry.state.omRenderPass = VK_NULL_HANDLE;
+      m_stateCache->addPipeline(entry);
+    }
     
-    VkPipeline pipeline = this->compilePipeline(state);
-    m_pipelines.insert(std::make_pair(state, pipeline));
     return pipeline;
   }
   
@@ -206,17 +465,19 @@ namespace dxvk {
     
     VkPipeline pipeline = VK_NULL_HANDLE;
     if (m_vkd->vkCreateGraphicsPipelines(m_vkd->device(),
-          VK_NULL_HANDLE, 1, &info, nullptr, &pipeline) != VK_SUCCESS)
+          m_cache->handle(), 1, &info, nullptr, &pipeline) != VK_SUCCESS)
       throw DxvkError("DxvkGraphicsPipeline::DxvkGraphicsPipeline: Failed to compile pipeline");
     return pipeline;
   }
   
   
   void DxvkGraphicsPipeline::destroyPipelines() {
-    for (const auto& pair : m_pipelines) {
+    m_pipelines.forEach([this] (
+        const DxvkGraphicsPipelineStateKey& key,
+              VkPipeline                    pipeline) {
       m_vkd->vkDestroyPipeline(
-        m_vkd->device(), pair.second, nullptr);
-    }
+        m_vkd->device(), pipeline, nullptr);
+    });
   }
   
 }
\ No newline at end of file
@@ -1,16 +1,24 @@
 #pragma once
 
+#include <condition_variable>
 #include <mutex>
-#include <unordered_map>
+#include <unordered_set>
+
+#include "../util/sync/sync_map.h"
 
 #include "dxvk_constant_state.h"
 #include "dxvk_hash.h"
+#include "dxvk_pipecache.h"
 #include "dxvk_pipelayout.h"
+#include "dxvk_renderpass.h"
 #include "dxvk_resource.h"
 #include "dxvk_shader.h"
 
 namespace dxvk {
   
+  class DxvkPipelineCompiler;
+  class DxvkStateCache;
+  
   /**
    * \brief Graphics pipeline state info
    * 
@@ -70,15 +78,48 @@ namespace dxvk {
   };
   
   
-  struct DxvkGraphicsPipelineStateHash {
-    size_t operator () (const DxvkGraphicsPipelineStateInfo& state) const;
-  };
-  
-  
-  struct DxvkGraphicsPipelineStateEq {
-    size_t operator () (
-      const DxvkGraphicsPipelineStateInfo& a,
-      const DxvkGraphicsPipelineStateInfo& b) const;
+  /**
+   * \brief Graphics pipeline state key
+   * 
+   * Compact, normalized representation of the pipeline
+   * state, used to look up pipelines. State that has no
+   * effect on the pipeline, such as unused vertex input
+   * slots or blend factors of attachments that do not
+   * have blending enabled, is set to zero, so that
+   * equivalent state vectors produce identical keys.
+   * 
+   * The key is stored as an array of 32-bit words whose
+   * size is a multiple of 16 bytes, so that hashing and
+   * comparisons can operate on full SIMD registers.
+   */
+  class DxvkGraphicsPipelineStateKey {
+    
+  public:
+    
+    DxvkGraphicsPipelineStateKey();
+    DxvkGraphicsPipelineStateKey(
+      const DxvkGraphicsPipelineStateInfo& state);
+    
+    size_t hash() const;
+    
+    bool operator == (const DxvkGraphicsPipelineStateKey& other) const;
+    bool operator != (const DxvkGraphicsPipelineStateKey& other) const;
+    
+  private:
+    
+    constexpr static uint32_t WordStateFlags  = 0;
+    constexpr static uint32_t WordStateEnums  = 1;
+    constexpr static uint32_t WordSampleMask  = 2;
+    constexpr static uint32_t WordFloatState  = 3;
+    constexpr static uint32_t WordStencilOps  = 9;
+    constexpr static uint32_t WordRenderPass  = 15;
+    constexpr static uint32_t WordAttributes  = 17;
+    constexpr static uint32_t WordBindings    = WordAttributes + DxvkLimits::MaxNumVertexAttributes;
+    constexpr static uint32_t WordBlendModes  = WordBindings   + DxvkLimits::MaxNumVertexBindings;
+    constexpr static uint32_t WordCount       = (WordBlendModes + DxvkLimits::MaxNumRenderTargets + 3) & ~3u;
+    
+    alignas(16) uint32_t m_words[WordCount];
+    
   };
   
   
@@ -90,16 +131,21 @@ namespace dxvk {
    * pipeline state vector.
    */
   class DxvkGraphicsPipeline : public DxvkResource {
-    
+    friend class DxvkPipelineCompiler;
   public:
     
     DxvkGraphicsPipeline(
-      const Rc<vk::DeviceFn>& vkd,
-      const Rc<DxvkShader>&   vs,
-      const Rc<DxvkShader>&   tcs,
-      const Rc<DxvkShader>&   tes,
-      const Rc<DxvkShader>&   gs,
-      const Rc<DxvkShader>&   fs);
+      const Rc<vk::DeviceFn>&       vkd,
+      const DxvkDeviceExtensions&   extensions,
+            uint32_t                maxDescriptorSets,
+      const Rc<DxvkPipelineCache>&  cache,
+            DxvkPipelineCompiler*   compiler,
+            DxvkStateCache*         stateCache,
+      const Rc<DxvkShader>&         vs,
+      const Rc<DxvkShader>&         tcs,
+      const Rc<DxvkShader>&         tes,
+      const Rc<DxvkShader>&         gs,
+      const Rc<DxvkShader>&         fs);
     ~DxvkGraphicsPipeline();
     
     /**
@@ -116,14 +162,40 @@ namespace dxvk {
     
     /**
      * \brief Pipeline handle
-     * \returns Pipeline handle
+     * 
+     * Compiles the pipeline if necessary. If the pipeline
+     * is already being compiled by a background worker,
+     * this will wait for the worker to finish.
+     * \param [in] state Pipeline state vector
+     * \param [in] format Format of the state's render pass
+     * \returns Pipeline handle, or \c VK_NULL_HANDLE
+     *          if the pipeline could not be compiled
      */
     VkPipeline getPipelineHandle(
-      const DxvkGraphicsPipelineStateInfo& state);
+      const DxvkGraphicsPipelineStateInfo& state,
+      const DxvkRenderPassFormat&          format);
+    
+    /**
+     * \brief Pipeline handle, without waiting
+     * 
+     * If the pipeline for the given state has not been
+     * compiled yet, this queues it for compilation on a
+     * background worker and returns immediately.
+     * \param [in] state Pipeline state vector
+     * \param [in] format Format of the state's render pass
+     * \returns Pipeline handle, or \c VK_NULL_HANDLE
+     *          if the pipeline is not yet available
+     */
+    VkPipeline getPipelineHandleAsync(
+      const DxvkGraphicsPipelineStateInfo& state,
+      const DxvkRenderPassFormat&          format);
     
   private:
     
     Rc<vk::DeviceFn>      m_vkd;
+    Rc<DxvkPipelineCache> m_cache;
+    DxvkPipelineCompiler* m_compiler;
+    DxvkStateCache*       m_stateCache;
     Rc<DxvkBindingLayout> m_layout;
     
     Rc<DxvkShaderModule>  m_vs;
@@ -132,13 +204,22 @@ namespace dxvk {
     Rc<DxvkShaderModule>  m_gs;
     Rc<DxvkShaderModule>  m_fs;
     
-    std::mutex m_mutex;
+    std::array<Sha1Hash, 5> m_shaderKeys;
+    
+    std::mutex              m_mutex;
+    std::condition_variable m_condOnCompile;
+    
+    ReadMostlyMap<
+      DxvkGraphicsPipelineStateKey,
+      VkPipeline, DxvkHash> m_pipelines;
+    
+    std::unordered_set<
+      DxvkGraphicsPipelineStateKey,
+      DxvkHash> m_pending;
     
-    std::unordered_map<
-      DxvkGraphicsPipelineStateInfo,
-      VkPipeline,
-      DxvkGraphicsPipelineStateHash,
-      DxvkGraphicsPipelineStateEq> m_pipelines;
+    VkPipeline compileInstance(
+      const DxvkGraphicsPipelineStateInfo& state,
+      const DxvkRenderPassFormat&          format);
     
     VkPipeline compilePipeline(
       const DxvkGraphicsPipelineStateInfo& state) const;
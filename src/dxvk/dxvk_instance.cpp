@@ -32,7 +32,7 @@ namespace dxvk {
   
   VkInstance DxvkInstance::createInstance() {
     auto enabledLayers     = this->getLayers();
-    auto enabledExtensions = this->getExtensions(enabledLayers);
+    auto enabledExtensions = this->getExtensions(enabledLayers, m_extensions);
     
     Logger::info("Enabled instance layers:");
     this->logNameList(enabledLayers);
@@ -85,8 +85,12 @@ namespace dxvk {
   }
   
   
-  vk::NameList DxvkInstance::getExtensions(const vk::NameList& layers) {
-    std::vector<const char*> extOptional = { };
+  vk::NameList DxvkInstance::getExtensions(
+    const vk::NameList&           layers,
+          DxvkInstanceExtensions& extensions) {
+    std::vector<const char*> extOptional = {
+      VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME,
+    };
     std::vector<const char*> extRequired = {
       VK_KHR_SURFACE_EXTENSION_NAME,
       VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
@@ -107,6 +111,8 @@ namespace dxvk {
       extensionsEnabled.add(e);
     }
     
+    extensions.khrGetPhysicalDeviceProperties2 = extensionsAvailable
+      .supports(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
     return extensionsEnabled;
   }
   
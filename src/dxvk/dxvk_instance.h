@@ -35,6 +35,14 @@ namespace dxvk {
       return m_vki->instance();
     }
     
+    /**
+     * \brief Enabled optional instance extensions
+     * \returns Enabled instance extensions
+     */
+    const DxvkInstanceExtensions& extensions() const {
+      return m_extensions;
+    }
+    
     /**
      * \brief Retrieves a list of adapters
      * \returns List of adapter objects
@@ -43,13 +51,19 @@ namespace dxvk {
     
   private:
     
+    // Declared first since it is filled in
+    // while the instance is being created
+    DxvkInstanceExtensions m_extensions;
+    
     Rc<vk::LibraryFn>   m_vkl;
     Rc<vk::InstanceFn>  m_vki;
     
     VkInstance createInstance();
     
     vk::NameList getLayers();
-    vk::NameList getExtensions(const vk::NameList& layers);
+    vk::NameList getExtensions(
+      const vk::NameList&           layers,
+            DxvkInstanceExtensions& extensions);
     
     void logNameList(const vk::NameList& names);
     
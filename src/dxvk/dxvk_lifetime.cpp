@@ -12,10 +12,22 @@ namespace dxvk {
   }
   
   
-  void DxvkLifetimeTracker::reset() {
+  void DxvkLifetimeTracker::notifySubmit(uint64_t submissionId) {
     for (auto i = m_resources.cbegin(); i != m_resources.cend(); i++)
+      (*i)->submit(submissionId);
+    m_submitted = true;
+  }
+  
+  
+  void DxvkLifetimeTracker::reset() {
+    for (auto i = m_resources.cbegin(); i != m_resources.cend(); i++) {
+      if (!m_submitted)
+        (*i)->submit(0);
       (*i)->release();
+    }
+    
     m_resources.clear();
+    m_submitted = false;
   }
   
 }
\ No newline at end of file
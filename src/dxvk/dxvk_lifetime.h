@@ -28,6 +28,15 @@ namespace dxvk {
     void trackResource(
       const Rc<DxvkResource>& rc);
     
+    /**
+     * \brief Notifies resources of a submission
+     * 
+     * Records the submission ID in all tracked resources.
+     * Called by the device when submitting the command list.
+     * \param [in] submissionId Submission ID
+     */
+    void notifySubmit(uint64_t submissionId);
+    
     /**
      * \brief Resets the command list
      * 
@@ -40,6 +49,8 @@ namespace dxvk {
     
     std::unordered_set<Rc<DxvkResource>, RcHash<DxvkResource>> m_resources;
     
+    bool m_submitted = false;
+    
   };
   
 }
\ No newline at end of file
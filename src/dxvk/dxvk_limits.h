@@ -11,6 +11,8 @@ namespace dxvk {
     MaxNumOutputStreams         =    4,
     MaxNumViewports             =   16,
     MaxNumResourceSlots         = 4096,
+    MaxNumDescriptorSets        =    6,
+    MaxNumDynamicBuffers        =    8,
   };
   
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "dxvk_memory.h"
 
+#include "../util/util_bit.h"
+#include "../util/util_math.h"
+
 namespace dxvk {
   
   DxvkMemory::DxvkMemory() {
@@ -9,45 +12,166 @@ namespace dxvk {
   
   DxvkMemory::DxvkMemory(
     DxvkMemoryAllocator*  alloc,
+    DxvkMemoryChunk*      chunk,
     VkDeviceMemory        memory,
+    VkDeviceSize          offset,
+    VkDeviceSize          length,
     void*                 mapPtr)
   : m_alloc (alloc),
+    m_chunk (chunk),
     m_memory(memory),
+    m_offset(offset),
+    m_length(length),
     m_mapPtr(mapPtr) { }
   
   
   DxvkMemory::DxvkMemory(DxvkMemory&& other)
   : m_alloc (other.m_alloc),
+    m_chunk (other.m_chunk),
     m_memory(other.m_memory),
+    m_offset(other.m_offset),
+    m_length(other.m_length),
     m_mapPtr(other.m_mapPtr) {
     other.m_alloc  = nullptr;
+    other.m_chunk  = nullptr;
     other.m_memory = VK_NULL_HANDLE;
+    other.m_offset = 0;
+    other.m_length = 0;
     other.m_mapPtr = nullptr;
   }
   
   
   DxvkMemory& DxvkMemory::operator = (DxvkMemory&& other) {
+    this->free();
     this->m_alloc  = other.m_alloc;
+    this->m_chunk  = other.m_chunk;
     this->m_memory = other.m_memory;
+    this->m_offset = other.m_offset;
+    this->m_length = other.m_length;
     this->m_mapPtr = other.m_mapPtr;
     other.m_alloc  = nullptr;
+    other.m_chunk  = nullptr;
     other.m_memory = VK_NULL_HANDLE;
+    other.m_offset = 0;
+    other.m_length = 0;
     other.m_mapPtr = nullptr;
     return *this;
   }
   
   
   DxvkMemory::~DxvkMemory() {
+    this->free();
+  }
+  
+  
+  void DxvkMemory::free() {
     if (m_memory != VK_NULL_HANDLE)
-      m_alloc->freeMemory(m_memory);
+      m_alloc->freeSlice(m_chunk, m_offset, m_length);
+  }
+  
+  
+  DxvkMemoryChunk::DxvkMemoryChunk(
+          DxvkMemoryAllocator*  alloc,
+          uint32_t              memoryType,
+          VkDeviceMemory        memory,
+          VkDeviceSize          size,
+          void*                 mapPtr)
+  : m_alloc     (alloc),
+    m_memoryType(memoryType),
+    m_memory    (memory),
+    m_size      (size),
+    m_mapPtr    (mapPtr) {
+    // Initially, the entire chunk is free
+    m_freeList.push_back({ 0, size });
+  }
+  
+  
+  DxvkMemoryChunk::~DxvkMemoryChunk() {
+    // Freeing the memory implicitly unmaps it
+    m_alloc->freeMemory(m_memory);
+  }
+  
+  
+  DxvkMemory DxvkMemoryChunk::alloc(
+          VkDeviceSize          size,
+          VkDeviceSize          align,
+          bool                  mapMemory) {
+    for (auto slice = m_freeList.begin(); slice != m_freeList.end(); slice++) {
+      const VkDeviceSize sliceEnd = slice->offset + slice->length;
+      const VkDeviceSize allocBeg = dxvk::align(slice->offset, align);
+      const VkDeviceSize allocEnd = allocBeg + size;
+      
+      if (allocEnd > sliceEnd)
+        continue;
+      
+      // Keep the free ranges in front of and behind
+      // the allocation, or remove the slice entirely
+      const FreeSlice before = { slice->offset, allocBeg - slice->offset };
+      const FreeSlice after  = { allocEnd,      sliceEnd - allocEnd      };
+      
+      if (before.length != 0 && after.length != 0) {
+        *slice = before;
+        m_freeList.insert(slice + 1, after);
+      } else if (before.length != 0) {
+        *slice = before;
+      } else if (after.length != 0) {
+        *slice = after;
+      } else {
+        m_freeList.erase(slice);
+      }
+      
+      void* mapPtr = (mapMemory && m_mapPtr != nullptr)
+        ? reinterpret_cast<char*>(m_mapPtr) + allocBeg
+        : nullptr;
+      
+      return DxvkMemory(m_alloc, this, m_memory, allocBeg, size, mapPtr);
+    }
+    
+    return DxvkMemory();
+  }
+  
+  
+  void DxvkMemoryChunk::free(
+          VkDeviceSize          offset,
+          VkDeviceSize          length) {
+    auto next = m_freeList.begin();
+    
+    while (next != m_freeList.end() && next->offset < offset)
+      next++;
+    
+    // Merge the freed range with adjacent free ranges
+    // so that the free list does not get fragmented
+    next = m_freeList.insert(next, { offset, length });
+    
+    if (next + 1 != m_freeList.end()
+     && next->offset + next->length == (next + 1)->offset) {
+      next->length += (next + 1)->length;
+      m_freeList.erase(next + 1);
+    }
+    
+    if (next != m_freeList.begin()
+     && (next - 1)->offset + (next - 1)->length == next->offset) {
+      (next - 1)->length += next->length;
+      m_freeList.erase(next);
+    }
   }
   
   
   DxvkMemoryAllocator::DxvkMemoryAllocator(
     const Rc<DxvkAdapter>&  adapter,
     const Rc<vk::DeviceFn>& vkd)
-  : m_vkd(vkd), m_memProps(adapter->memoryProperties()) {
-    
+  : m_vkd     (vkd),
+    m_devProps(adapter->deviceProperties()),
+    m_memProps(adapter->memoryProperties()) {
+    // Use a fraction of the heap size as the default chunk
+    // size so that small heaps do not get exhausted
+    for (uint32_t i = 0; i < m_memProps.memoryTypeCount; i++) {
+      const VkDeviceSize heapSize = m_memProps.memoryHeaps[
+        m_memProps.memoryTypes[i].heapIndex].size;
+      
+      m_chunkSizes[i] = std::min(heapSize / 4,
+        clamp(heapSize / 16, MinChunkSize, MaxChunkSize));
+    }
   }
   
   
@@ -59,32 +183,127 @@ namespace dxvk {
   DxvkMemory DxvkMemoryAllocator::alloc(
     const VkMemoryRequirements& req,
     const VkMemoryPropertyFlags flags) {
+    // Buffers and optimally tiled images may share a chunk,
+    // so we need to make sure that they never share a page
+    // as defined by the buffer-image granularity.
+    const VkDeviceSize granularity = m_devProps.limits.bufferImageGranularity;
     
-    VkDeviceMemory memory = VK_NULL_HANDLE;
-    void*          mapPtr = nullptr;
+    const VkDeviceSize size      = align(req.size, granularity);
+    const VkDeviceSize alignment = std::max(req.alignment, granularity);
+    
+    const bool mapMemory = (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+    
+    // Host-cached memory is only a preference, since not all
+    // devices provide a cached and coherent memory type.
+    const VkMemoryPropertyFlags required = flags & ~VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    
+    std::array<uint32_t, VK_MAX_MEMORY_TYPES> memoryTypes;
+    uint32_t memoryTypeCount = 0;
     
     for (uint32_t i = 0; i < m_memProps.memoryTypeCount; i++) {
       const bool supported = (req.memoryTypeBits & (1u << i)) != 0;
-      const bool adequate  = (m_memProps.memoryTypes[i].propertyFlags & flags) == flags;
+      const bool adequate  = (m_memProps.memoryTypes[i].propertyFlags & required) == required;
       
-      if (supported && adequate) {
-        memory = this->allocMemory(req.size, i);
-        
-        if (memory != VK_NULL_HANDLE)
-          break;
-      }
+      if (supported && adequate)
+        memoryTypes[memoryTypeCount++] = i;
+    }
+    
+    // Try the best-ranked memory types first, and fall
+    // back to the others if their heaps are exhausted
+    std::stable_sort(memoryTypes.begin(), memoryTypes.begin() + memoryTypeCount,
+      [this, flags] (uint32_t a, uint32_t b) {
+        return this->rankMemoryType(a, flags)
+             > this->rankMemoryType(b, flags);
+      });
+    
+    for (uint32_t i = 0; i < memoryTypeCount; i++) {
+      DxvkMemory memory = this->tryAlloc(memoryTypes[i], size, alignment, mapMemory);
+      
+      if (memory.memory() != VK_NULL_HANDLE)
+        return memory;
+    }
+    
+    throw DxvkError("DxvkMemoryAllocator::alloc: Failed to allocate memory");
+  }
+  
+  
+  uint32_t DxvkMemoryAllocator::rankMemoryType(
+          uint32_t              memoryType,
+          VkMemoryPropertyFlags flags) const {
+    const VkMemoryPropertyFlags typeFlags
+      = m_memProps.memoryTypes[memoryType].propertyFlags;
+    
+    uint32_t rank = 0;
+    
+    // Resources that are read by the host need cached memory,
+    // while uploads should use uncached, write-combined memory
+    // so that writes do not pollute the CPU caches.
+    if (typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+      const bool wantCached = (flags     & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) != 0;
+      const bool isCached   = (typeFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) != 0;
+      
+      if (wantCached == isCached)
+        rank += 2;
+    }
+    
+    // Device-local resources should not take up the small
+    // host-visible part of video memory on discrete GPUs
+    if (!(flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+     && !(typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+      rank += 1;
+    
+    // Among otherwise equal types, prefer the one
+    // with the fewest properties that we don't need
+    rank = 8 * rank + (8 - std::min(8u,
+      bit::popcnt(uint32_t(typeFlags & ~flags))));
+    return rank;
+  }
+  
+  
+  DxvkMemory DxvkMemoryAllocator::tryAlloc(
+          uint32_t        memoryType,
+          VkDeviceSize    size,
+          VkDeviceSize    align,
+          bool            mapMemory) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    auto& chunks = m_chunks.at(memoryType);
+    
+    for (const auto& chunk : chunks) {
+      DxvkMemory memory = chunk->alloc(size, align, mapMemory);
+      
+      if (memory.memory() != VK_NULL_HANDLE)
+        return memory;
+    }
+    
+    // Allocations that are larger than the default chunk
+    // size get a chunk that can hold exactly one slice
+    VkDeviceSize   chunkSize = std::max(m_chunkSizes.at(memoryType), size);
+    VkDeviceMemory memory    = this->allocMemory(chunkSize, memoryType);
+    
+    if (memory == VK_NULL_HANDLE && chunkSize != size) {
+      chunkSize = size;
+      memory    = this->allocMemory(chunkSize, memoryType);
     }
     
     if (memory == VK_NULL_HANDLE)
-      throw DxvkError("DxvkMemoryAllocator::alloc: Failed to allocate memory");
+      return DxvkMemory();
     
-    if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    // Host-visible chunks are mapped once and stay
+    // mapped until the chunk itself gets destroyed
+    void* mapPtr = nullptr;
+    
+    if (m_memProps.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
       if (m_vkd->vkMapMemory(m_vkd->device(), memory,
-          0, VK_WHOLE_SIZE, 0, &mapPtr) != VK_SUCCESS)
+          0, VK_WHOLE_SIZE, 0, &mapPtr) != VK_SUCCESS) {
+        this->freeMemory(memory);
         throw DxvkError("DxvkMemoryAllocator::alloc: Failed to map memory");
+      }
     }
     
-    return DxvkMemory(this, memory, mapPtr);
+    chunks.push_back(std::make_unique<DxvkMemoryChunk>(
+      this, memoryType, memory, chunkSize, mapPtr));
+    return chunks.back()->alloc(size, align, mapMemory);
   }
   
   
@@ -108,4 +327,30 @@ namespace dxvk {
     m_vkd->vkFreeMemory(m_vkd->device(), memory, nullptr);
   }
   
+  
+  void DxvkMemoryAllocator::freeSlice(
+          DxvkMemoryChunk* chunk,
+          VkDeviceSize    offset,
+          VkDeviceSize    length) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    chunk->free(offset, length);
+    
+    // Keep one empty default-sized chunk around per memory
+    // type in order to avoid allocation churn, but release
+    // any other chunks as soon as they become unused.
+    if (!chunk->isEmpty())
+      return;
+    
+    auto& chunks = m_chunks.at(chunk->memoryType());
+    
+    if (chunks.size() > 1 || chunk->size() != m_chunkSizes.at(chunk->memoryType())) {
+      for (auto i = chunks.begin(); i != chunks.end(); i++) {
+        if (i->get() == chunk) {
+          chunks.erase(i);
+          break;
+        }
+      }
+    }
+  }
+  
 }
\ No newline at end of file
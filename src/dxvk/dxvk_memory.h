@@ -1,14 +1,22 @@
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "dxvk_adapter.h"
 
 namespace dxvk {
   
   class DxvkMemoryAllocator;
+  class DxvkMemoryChunk;
   
   
   /**
    * \brief Memory slice
+   * 
+   * Represents a slice of memory that has
+   * been sub-allocated from a bigger chunk.
    */
   class DxvkMemory {
     
@@ -17,7 +25,10 @@ namespace dxvk {
     DxvkMemory();
     DxvkMemory(
       DxvkMemoryAllocator*  alloc,
+      DxvkMemoryChunk*      chunk,
       VkDeviceMemory        memory,
+      VkDeviceSize          offset,
+      VkDeviceSize          length,
       void*                 mapPtr);
     DxvkMemory             (DxvkMemory&& other);
     DxvkMemory& operator = (DxvkMemory&& other);
@@ -42,7 +53,15 @@ namespace dxvk {
      * \returns Offset from memory object
      */
     VkDeviceSize offset() const {
-      return 0;
+      return m_offset;
+    }
+    
+    /**
+     * \brief Size of the memory slice
+     * \returns Number of bytes allocated
+     */
+    VkDeviceSize length() const {
+      return m_length;
     }
     
     /**
@@ -58,9 +77,105 @@ namespace dxvk {
   private:
     
     DxvkMemoryAllocator*  m_alloc  = nullptr;
+    DxvkMemoryChunk*      m_chunk  = nullptr;
     VkDeviceMemory        m_memory = VK_NULL_HANDLE;
+    VkDeviceSize          m_offset = 0;
+    VkDeviceSize          m_length = 0;
     void*                 m_mapPtr = nullptr;
     
+    void free();
+    
+  };
+  
+  
+  /**
+   * \brief Memory chunk
+   * 
+   * A single device memory allocation from which
+   * smaller slices are sub-allocated. Free ranges
+   * are stored in a list sorted by offset, and
+   * adjacent ranges are merged when freed. Chunks
+   * on host-visible memory types are persistently
+   * mapped for their entire lifetime.
+   */
+  class DxvkMemoryChunk {
+    
+  public:
+    
+    DxvkMemoryChunk(
+            DxvkMemoryAllocator*  alloc,
+            uint32_t              memoryType,
+            VkDeviceMemory        memory,
+            VkDeviceSize          size,
+            void*                 mapPtr);
+    ~DxvkMemoryChunk();
+    
+    /**
+     * \brief Memory type index
+     * \returns Memory type of the chunk
+     */
+    uint32_t memoryType() const {
+      return m_memoryType;
+    }
+    
+    /**
+     * \brief Chunk size
+     * \returns Chunk size, in bytes
+     */
+    VkDeviceSize size() const {
+      return m_size;
+    }
+    
+    /**
+     * \brief Checks whether the chunk is unused
+     * \returns \c true if no slices are allocated
+     */
+    bool isEmpty() const {
+      return m_freeList.size() == 1
+          && m_freeList[0].length == m_size;
+    }
+    
+    /**
+     * \brief Sub-allocates a slice of memory
+     * 
+     * Finds the first free range that can hold a slice
+     * of the given size with the given alignment. The
+     * returned slice is mapped if \c mapMemory is set.
+     * \param [in] size Number of bytes to allocate
+     * \param [in] align Required alignment
+     * \param [in] mapMemory Whether to expose the mapping
+     * \returns The slice, or an empty slice on failure
+     */
+    DxvkMemory alloc(
+            VkDeviceSize          size,
+            VkDeviceSize          align,
+            bool                  mapMemory);
+    
+    /**
+     * \brief Returns a slice to the chunk
+     * 
+     * \param [in] offset Slice offset
+     * \param [in] length Slice length
+     */
+    void free(
+            VkDeviceSize          offset,
+            VkDeviceSize          length);
+    
+  private:
+    
+    struct FreeSlice {
+      VkDeviceSize offset;
+      VkDeviceSize length;
+    };
+    
+    DxvkMemoryAllocator*  m_alloc;
+    uint32_t              m_memoryType;
+    VkDeviceMemory        m_memory;
+    VkDeviceSize          m_size;
+    void*                 m_mapPtr;
+    
+    std::vector<FreeSlice> m_freeList;
+    
   };
   
   
@@ -68,10 +183,17 @@ namespace dxvk {
    * \brief Memory allocator
    * 
    * Allocates device memory for Vulkan resources.
+   * Memory is allocated in large chunks per memory
+   * type, which are then sub-allocated in order to
+   * keep the number of device allocations low.
    * Memory objects will be destroyed automatically.
    */
   class DxvkMemoryAllocator : public RcObject {
     friend class DxvkMemory;
+    friend class DxvkMemoryChunk;
+    
+    constexpr static VkDeviceSize MinChunkSize =  64 * 1024 * 1024;
+    constexpr static VkDeviceSize MaxChunkSize = 256 * 1024 * 1024;
   public:
     
     DxvkMemoryAllocator(
@@ -82,8 +204,14 @@ namespace dxvk {
     /**
      * \brief Allocates device memory
      * 
+     * Memory types that support all requested flags are
+     * ranked based on how the memory is going to be used.
+     * \c VK_MEMORY_PROPERTY_HOST_CACHED_BIT is treated as
+     * a preference for memory that is read by the host.
+     * Without it, host-visible allocations prefer uncached,
+     * write-combined memory for uploads.
      * \param [in] req Memory requirements
-     * \param [in] flats Memory type flags
+     * \param [in] flags Memory type flags
      * \returns Allocated memory slice
      */
     DxvkMemory alloc(
@@ -93,14 +221,34 @@ namespace dxvk {
   private:
     
     const Rc<vk::DeviceFn>                 m_vkd;
+    const VkPhysicalDeviceProperties       m_devProps;
     const VkPhysicalDeviceMemoryProperties m_memProps;
     
+    std::mutex m_mutex;
+    std::array<VkDeviceSize, VK_MAX_MEMORY_TYPES> m_chunkSizes;
+    std::array<std::vector<std::unique_ptr<DxvkMemoryChunk>>, VK_MAX_MEMORY_TYPES> m_chunks;
+    
+    uint32_t rankMemoryType(
+            uint32_t              memoryType,
+            VkMemoryPropertyFlags flags) const;
+    
+    DxvkMemory tryAlloc(
+            uint32_t        memoryType,
+            VkDeviceSize    size,
+            VkDeviceSize    align,
+            bool            mapMemory);
+    
     VkDeviceMemory allocMemory(
-      VkDeviceSize    blockSize,
-      uint32_t        memoryType);
+            VkDeviceSize    blockSize,
+            uint32_t        memoryType);
     
     void freeMemory(
-      VkDeviceMemory  memory);
+            VkDeviceMemory  memory);
+    
+    void freeSlice(
+            DxvkMemoryChunk* chunk,
+            VkDeviceSize    offset,
+            VkDeviceSize    length);
     
   };
   
@@ -0,0 +1,199 @@
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#include "dxvk_pipecache.h"
+
+namespace dxvk {
+  
+  DxvkPipelineCache::DxvkPipelineCache(
+    const Rc<vk::DeviceFn>&           vkd,
+    const VkPhysicalDeviceProperties& properties)
+  : m_vkd     (vkd),
+    m_header  (getFileHeader(properties)),
+    m_fileName(getFileName(m_header)) {
+    const std::vector<char> initialData = this->loadCacheData();
+    
+    VkPipelineCacheCreateInfo info;
+    info.sType            = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    info.pNext            = nullptr;
+    info.flags            = 0;
+    info.initialDataSize  = initialData.size();
+    info.pInitialData     = initialData.data();
+    
+    if (m_vkd->vkCreatePipelineCache(m_vkd->device(),
+          &info, nullptr, &m_handle) != VK_SUCCESS)
+      throw DxvkError("DxvkPipelineCache::DxvkPipelineCache: Failed to create cache");
+    
+    m_loadedSize.store(initialData.size());
+    m_savedSize .store(initialData.size());
+    
+    m_thread = std::thread([this] () { runCheckpoints(); });
+  }
+  
+  
+  DxvkPipelineCache::~DxvkPipelineCache() {
+    { std::unique_lock<std::mutex> lock(m_mutex);
+      m_stopped.store(true);
+    }
+    
+    m_cond.notify_one();
+    m_thread.join();
+    
+    this->saveCacheData();
+    
+    m_vkd->vkDestroyPipelineCache(
+      m_vkd->device(), m_handle, nullptr);
+  }
+  
+  
+  std::vector<char> DxvkPipelineCache::loadCacheData() const {
+    std::ifstream file(m_fileName, std::ios_base::binary);
+    
+    if (!file)
+      return std::vector<char>();
+    
+    DxvkPipelineCacheHeader header;
+    
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+     || header.dataSize > MaxFileDataSize) {
+      Logger::warn(str::format("DxvkPipelineCache: Invalid cache file ", m_fileName));
+      return std::vector<char>();
+    }
+    
+    // The data size is the only field that is
+    // allowed to differ from our own header
+    const uint64_t dataSize = header.dataSize;
+    header.dataSize = m_header.dataSize;
+    
+    if (std::memcmp(&header, &m_header, sizeof(header)) != 0) {
+      Logger::warn(str::format("DxvkPipelineCache: Incompatible cache file ", m_fileName));
+      return std::vector<char>();
+    }
+    
+    std::vector<char> data(dataSize);
+    
+    if (!file.read(data.data(), data.size())) {
+      Logger::warn(str::format("DxvkPipelineCache: Truncated cache file ", m_fileName));
+      return std::vector<char>();
+    }
+    
+    Logger::info(str::format("DxvkPipelineCache: Loaded ", data.size(), " bytes from ", m_fileName));
+    return data;
+  }
+  
+  
+  void DxvkPipelineCache::saveCacheData() {
+    size_t dataSize = 0;
+    
+    if (m_vkd->vkGetPipelineCacheData(m_vkd->device(),
+          m_handle, &dataSize, nullptr) != VK_SUCCESS)
+      return;
+    
+    // Vulkan pipeline caches only ever grow, so if
+    // the size did not change, nothing has been added
+    if (dataSize == m_savedSize.load())
+      return;
+    
+    std::vector<char> data(dataSize);
+    
+    if (m_vkd->vkGetPipelineCacheData(m_vkd->device(),
+          m_handle, &dataSize, data.data()) != VK_SUCCESS)
+      return;
+    
+    DxvkPipelineCacheHeader header = m_header;
+    header.dataSize = dataSize;
+    
+    // Write to a temporary file first and replace the
+    // actual cache file afterwards, so that a crash
+    // cannot leave a partially written file behind.
+    // Other devices or processes may save the same
+    // cache at the same time, so the name is unique.
+    static std::atomic<uint32_t> s_tmpFileId = { 0u };
+    
+    const std::string tmpFileName = str::format(m_fileName, ".",
+      ::GetCurrentProcessId(), ".", s_tmpFileId++, ".tmp");
+    
+    { std::ofstream file(tmpFileName, std::ios_base::binary | std::ios_base::trunc);
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      file.write(data.data(), dataSize);
+      file.flush();
+      
+      if (!file) {
+        Logger::warn(str::format("DxvkPipelineCache: Failed to write ", tmpFileName));
+        file.close();
+        ::DeleteFileA(tmpFileName.c_str());
+        return;
+      }
+    }
+    
+    if (!::MoveFileExA(tmpFileName.c_str(), m_fileName.c_str(),
+          MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+      Logger::warn(str::format("DxvkPipelineCache: Failed to replace ", m_fileName));
+      ::DeleteFileA(tmpFileName.c_str());
+      return;
+    }
+    
+    m_savedSize.store(dataSize);
+  }
+  
+  
+  void DxvkPipelineCache::runCheckpoints() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    while (!m_stopped.load()) {
+      m_cond.wait_for(lock,
+        std::chrono::seconds(CheckpointIntervalSecs),
+        [this] { return m_stopped.load(); });
+      
+      if (!m_stopped.load()) {
+        lock.unlock();
+        this->saveCacheData();
+        lock.lock();
+      }
+    }
+  }
+  
+  
+  DxvkPipelineCacheHeader DxvkPipelineCache::getFileHeader(
+    const VkPhysicalDeviceProperties& properties) {
+    DxvkPipelineCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "DXVK", 4);
+    header.version        = FileVersion;
+    header.vendorId       = properties.vendorID;
+    header.deviceId       = properties.deviceID;
+    header.driverVersion  = properties.driverVersion;
+    std::memcpy(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    return header;
+  }
+  
+  
+  std::string DxvkPipelineCache::getFileName(
+    const DxvkPipelineCacheHeader&    header) {
+    static const char hexDigits[] = "0123456789abcdef";
+    
+    std::string uuid;
+    
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+      uuid.push_back(hexDigits[header.uuid[i] >> 4]);
+      uuid.push_back(hexDigits[header.uuid[i] & 0xF]);
+    }
+    
+    return getCacheFilePath(str::format("dxvk_",
+      header.vendorId, "_", header.deviceId, "_",
+      header.driverVersion, "_", uuid, ".pipecache"));
+  }
+  
+  
+  std::string DxvkPipelineCache::getCacheFilePath(
+    const std::string&                fileName) {
+    std::string path = env::getEnvVar(L"DXVK_PIPELINE_CACHE_PATH");
+    
+    if (!path.empty() && path.back() != '/' && path.back() != '\\')
+      path.push_back('/');
+    
+    return str::format(path, fileName);
+  }
+  
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dxvk_include.h"
+
+namespace dxvk {
+  
+  /**
+   * \brief Pipeline cache file header
+   * 
+   * Identifies the device and driver that the cache
+   * data was created for. Cache files that do not
+   * match the current device will be ignored.
+   */
+  struct DxvkPipelineCacheHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t vendorId;
+    uint32_t deviceId;
+    uint32_t driverVersion;
+    uint8_t  uuid[VK_UUID_SIZE];
+    uint64_t dataSize;
+  };
+  
+  
+  /**
+   * \brief Pipeline cache statistics
+   */
+  struct DxvkPipelineCacheStats {
+    size_t loadedSize;  ///< Bytes loaded from disk
+    size_t savedSize;   ///< Bytes written to disk
+  };
+  
+  
+  /**
+   * \brief Pipeline cache
+   * 
+   * Wraps a Vulkan pipeline cache object which is
+   * shared by all pipelines created on a device, so
+   * that drivers can reuse compiled shader code.
+   * Vulkan pipeline caches are internally synchronized,
+   * so the cache may be used from multiple threads.
+   * 
+   * The cache is loaded from disk on creation, and is
+   * written back periodically as well as on destruction.
+   * The file name depends on the device and the driver,
+   * so that different GPUs use different cache files.
+   */
+  class DxvkPipelineCache : public RcObject {
+    constexpr static uint32_t FileVersion            = 1;
+    constexpr static uint32_t CheckpointIntervalSecs = 30;
+    constexpr static uint64_t MaxFileDataSize        = 1ull << 30;
+  public:
+    
+    DxvkPipelineCache(
+      const Rc<vk::DeviceFn>&           vkd,
+      const VkPhysicalDeviceProperties& properties);
+    ~DxvkPipelineCache();
+    
+    /**
+     * \brief Pipeline cache handle
+     * \returns Pipeline cache handle
+     */
+    VkPipelineCache handle() const {
+      return m_handle;
+    }
+    
+    /**
+     * \brief Retrieves cache statistics
+     * \returns Cache statistics
+     */
+    DxvkPipelineCacheStats stats() const {
+      DxvkPipelineCacheStats result;
+      result.loadedSize = m_loadedSize.load();
+      result.savedSize  = m_savedSize.load();
+      return result;
+    }
+    
+    /**
+     * \brief Path of a cache file
+     * 
+     * Cache files are stored in the directory specified
+     * by \c DXVK_PIPELINE_CACHE_PATH, or in the current
+     * working directory if the variable is not set.
+     * \param [in] fileName Name of the cache file
+     * \returns Full path of the cache file
+     */
+    static std::string getCacheFilePath(
+      const std::string&                fileName);
+    
+  private:
+    
+    Rc<vk::DeviceFn>        m_vkd;
+    VkPipelineCache         m_handle = VK_NULL_HANDLE;
+    
+    DxvkPipelineCacheHeader m_header;
+    std::string             m_fileName;
+    
+    std::atomic<size_t>     m_loadedSize = { 0 };
+    std::atomic<size_t>     m_savedSize  = { 0 };
+    
+    std::atomic<bool>       m_stopped = { false };
+    std::mutex              m_mutex;
+    std::condition_variable m_cond;
+    std::thread             m_thread;
+    
+    std::vector<char> loadCacheData() const;
+    
+    void saveCacheData();
+    
+    void runCheckpoints();
+    
+    static DxvkPipelineCacheHeader getFileHeader(
+      const VkPhysicalDeviceProperties& properties);
+    
+    static std::string getFileName(
+      const DxvkPipelineCacheHeader&    header);
+    
+  };
+  
+}
\ No newline at end of file
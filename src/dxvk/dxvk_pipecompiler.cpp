@@ -0,0 +1,106 @@
+#include <algorithm>
+
+#include "dxvk_pipecompiler.h"
+
+namespace dxvk {
+  
+  DxvkPipelineCompiler::DxvkPipelineCompiler() {
+    // Leave some cores to the application and the
+    // thread that records and submits command lists
+    const uint32_t workerCount = std::max(1u,
+      std::thread::hardware_concurrency() / 2);
+    
+    for (uint32_t i = 0; i < workerCount; i++)
+      m_workers.emplace_back([this] () { runWorker(); });
+  }
+  
+  
+  DxvkPipelineCompiler::~DxvkPipelineCompiler() {
+    { std::unique_lock<std::mutex> lock(m_queueLock);
+      m_stopped.store(true);
+    }
+    
+    m_queueCond.notify_all();
+    
+    for (auto& worker : m_workers)
+      worker.join();
+  }
+  
+  
+  void DxvkPipelineCompiler::queueCompilation(
+    const Rc<DxvkGraphicsPipeline>&       pipeline,
+    const DxvkGraphicsPipelineStateInfo&  state,
+    const DxvkRenderPassFormat&           format) {
+    { std::unique_lock<std::mutex> lock(m_queueLock);
+      m_queue.push({ pipeline, state, format });
+      m_queueDepth += 1;
+    }
+    
+    m_queueCond.notify_one();
+  }
+  
+  
+  void DxvkPipelineCompiler::queueTask(
+          std::function<void ()>&&        task) {
+    PipelineEntry entry;
+    entry.task = std::move(task);
+    
+    { std::unique_lock<std::mutex> lock(m_queueLock);
+      m_queue.push(std::move(entry));
+      m_queueDepth += 1;
+    }
+    
+    m_queueCond.notify_one();
+  }
+  
+  
+  void DxvkPipelineCompiler::addCompileTime(uint64_t timeUs) {
+    m_numCompiled += 1;
+    m_totalTimeUs += timeUs;
+    
+    uint64_t maxTimeUs = m_maxTimeUs.load();
+    
+    while (maxTimeUs < timeUs
+       && !m_maxTimeUs.compare_exchange_weak(maxTimeUs, timeUs))
+      continue;
+  }
+  
+  
+  DxvkPipelineCompilerStats DxvkPipelineCompiler::stats() const {
+    DxvkPipelineCompilerStats result;
+    result.queueDepth  = m_queueDepth.load();
+    result.numCompiled = m_numCompiled.load();
+    result.totalTimeUs = m_totalTimeUs.load();
+    result.maxTimeUs   = m_maxTimeUs.load();
+    return result;
+  }
+  
+  
+  void DxvkPipelineCompiler::runWorker() {
+    while (!m_stopped.load()) {
+      PipelineEntry entry;
+      
+      { std::unique_lock<std::mutex> lock(m_queueLock);
+        
+        m_queueCond.wait(lock, [this] {
+          return m_stopped.load() || !m_queue.empty();
+        });
+        
+        // Pending pipelines are discarded on shutdown
+        // since nobody is going to use them anymore
+        if (m_stopped.load())
+          return;
+        
+        entry = std::move(m_queue.front());
+        m_queue.pop();
+        m_queueDepth -= 1;
+      }
+      
+      if (entry.task)
+        entry.task();
+      else
+        entry.pipeline->compileInstance(entry.state, entry.format);
+    }
+  }
+  
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "dxvk_graphics.h"
+
+namespace dxvk {
+  
+  /**
+   * \brief Pipeline compiler statistics
+   */
+  struct DxvkPipelineCompilerStats {
+    uint32_t queueDepth;      ///< Number of queued pipelines
+    uint32_t numCompiled;     ///< Number of compiled pipelines
+    uint64_t totalTimeUs;     ///< Total compile time
+    uint64_t maxTimeUs;       ///< Longest compile time
+  };
+  
+  
+  /**
+   * \brief Pipeline compiler
+   * 
+   * Compiles graphics pipelines on a pool of worker
+   * threads so that pipeline compilation does not have
+   * to stall the thread that records draw calls. Also
+   * keeps track of compile times of all pipelines.
+   */
+  class DxvkPipelineCompiler : public RcObject {
+    
+  public:
+    
+    DxvkPipelineCompiler();
+    ~DxvkPipelineCompiler();
+    
+    /**
+     * \brief Queues a pipeline for compilation
+     * 
+     * The pipeline will be compiled against the
+     * given state vector by one of the workers.
+     * \param [in] pipeline The graphics pipeline
+     * \param [in] state Pipeline state vector
+     * \param [in] format Render pass format
+     */
+    void queueCompilation(
+      const Rc<DxvkGraphicsPipeline>&       pipeline,
+      const DxvkGraphicsPipelineStateInfo&  state,
+      const DxvkRenderPassFormat&           format);
+    
+    /**
+     * \brief Queues a task for the workers
+     * 
+     * Used for work that leads up to pipeline compilation
+     * and may block, such as creating pipelines from the
+     * state cache, which must not stall the calling thread.
+     * \param [in] task The task to execute
+     */
+    void queueTask(
+            std::function<void ()>&&        task);
+    
+    /**
+     * \brief Records the compile time of a pipeline
+     * \param [in] timeUs Compile time in microseconds
+     */
+    void addCompileTime(uint64_t timeUs);
+    
+    /**
+     * \brief Retrieves compiler statistics
+     * \returns Compiler statistics
+     */
+    DxvkPipelineCompilerStats stats() const;
+    
+  private:
+    
+    struct PipelineEntry {
+      Rc<DxvkGraphicsPipeline>      pipeline;
+      DxvkGraphicsPipelineStateInfo state;
+      DxvkRenderPassFormat          format;
+      std::function<void ()>        task;
+    };
+    
+    std::atomic<bool>     m_stopped     = { false };
+    std::atomic<uint32_t> m_queueDepth  = { 0u };
+    std::atomic<uint32_t> m_numCompiled = { 0u };
+    std::atomic<uint64_t> m_totalTimeUs = { 0ull };
+    std::atomic<uint64_t> m_maxTimeUs   = { 0ull };
+    
+    std::mutex                m_queueLock;
+    std::condition_variable   m_queueCond;
+    std::queue<PipelineEntry> m_queue;
+    std::vector<std::thread>  m_workers;
+    
+    void runWorker();
+    
+  };
+  
+}
\ No newline at end of file
@@ -1,5 +1,8 @@
+#include <algorithm>
+#include <cstddef>
 #include <cstring>
 
+#include "dxvk_descriptor.h"
 #include "dxvk_pipelayout.h"
 
 namespace dxvk {
@@ -18,87 +21,317 @@ namespace dxvk {
       m_descriptorSlots.at(bindingId).stages |= stage;
     } else {
       DxvkDescriptorSlot slotInfo;
-      slotInfo.slot   = slot;
-      slotInfo.type   = type;
-      slotInfo.stages = stage;
+      slotInfo.slot    = slot;
+      slotInfo.type    = type;
+      slotInfo.stages  = stage;
+      slotInfo.set     = 0;
+      slotInfo.binding = 0;
+      
+      // Slot indices are small enough that a direct
+      // lookup table is cheaper than a search
+      if (slot >= m_bindingIds.size())
+        m_bindingIds.resize(slot + 1, InvalidBinding);
+      
+      m_bindingIds.at(slot) = m_descriptorSlots.size();
       m_descriptorSlots.push_back(slotInfo);
     }
   }
   
   
-  uint32_t DxvkDescriptorSlotMapping::getBindingId(uint32_t slot) const {
-    // This won't win a performance competition, but the number
-    // of bindings used by a shader is usually much smaller than
-    // the number of resource slots available to the system.
+  void DxvkDescriptorSlotMapping::assignDescriptorSets(
+          uint32_t              maxSetCount) {
+    // Order bindings from the least to the most frequently
+    // changing group so that the sets that need to be
+    // rebound most often come last in the pipeline layout
+    std::stable_sort(m_descriptorSlots.begin(), m_descriptorSlots.end(),
+      [] (const DxvkDescriptorSlot& a, const DxvkDescriptorSlot& b) {
+        return getSetClass(a.stages) < getSetClass(b.stages);
+      });
+    
+    // Devices may support as few as four bound sets. If more
+    // set classes are used than that, the least frequently
+    // changing classes are merged into the first set.
+    uint32_t classCount = 0;
+    
     for (uint32_t i = 0; i < m_descriptorSlots.size(); i++) {
-      if (m_descriptorSlots.at(i).slot == slot)
-        return i;
+      if (i == 0 || getSetClass(m_descriptorSlots[i].stages)
+                 != getSetClass(m_descriptorSlots[i - 1].stages))
+        classCount += 1;
     }
     
-    return InvalidBinding;
+    uint32_t mergeCount = classCount > maxSetCount
+      ? classCount - maxSetCount : 0;
+    
+    uint32_t setId     = 0;
+    uint32_t bindingId = 0;
+    
+    for (uint32_t i = 0; i < m_descriptorSlots.size(); i++) {
+      DxvkDescriptorSlot& slotInfo = m_descriptorSlots[i];
+      
+      // Only non-empty sets are assigned an index
+      if (i != 0 && getSetClass(slotInfo.stages)
+                 != getSetClass(m_descriptorSlots[i - 1].stages)) {
+        if (mergeCount != 0) {
+          mergeCount -= 1;
+        } else {
+          setId    += 1;
+          bindingId = 0;
+        }
+      }
+      
+      slotInfo.set     = setId;
+      slotInfo.binding = bindingId++;
+      
+      m_bindingIds.at(slotInfo.slot) = i;
+    }
+  }
+  
+  
+  uint32_t DxvkDescriptorSlotMapping::getSetClass(
+          VkShaderStageFlags    stages) {
+    switch (stages) {
+      case VK_SHADER_STAGE_VERTEX_BIT:                  return 1;
+      case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT:    return 2;
+      case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT: return 3;
+      case VK_SHADER_STAGE_GEOMETRY_BIT:                return 4;
+      case VK_SHADER_STAGE_FRAGMENT_BIT:                return 5;
+      // Compute pipelines and resources
+      // shared between multiple stages
+      default:                                          return 0;
+    }
   }
   
   
   DxvkBindingLayout::DxvkBindingLayout(
-    const Rc<vk::DeviceFn>&   vkd,
-          uint32_t            bindingCount,
-    const DxvkDescriptorSlot* bindingInfos)
+    const Rc<vk::DeviceFn>&     vkd,
+    const DxvkDeviceExtensions& extensions,
+          uint32_t              bindingCount,
+    const DxvkDescriptorSlot*   bindingInfos)
   : m_vkd(vkd) {
     
     m_bindingSlots.resize(bindingCount);
     std::memcpy(m_bindingSlots.data(), bindingInfos,
       bindingCount * sizeof(DxvkDescriptorSlot));
     
-    std::vector<VkDescriptorSetLayoutBinding> bindings;
-    
     for (uint32_t i = 0; i < bindingCount; i++) {
-      VkDescriptorSetLayoutBinding binding;
-      binding.binding            = i;
-      binding.descriptorType     = bindingInfos[i].type;
-      binding.descriptorCount    = 1;
-      binding.stageFlags         = bindingInfos[i].stages;
-      binding.pImmutableSamplers = nullptr;
-      bindings.push_back(binding);
+      const uint32_t slot = bindingInfos[i].slot;
+      
+      if (slot >= m_slotBindings.size())
+        m_slotBindings.resize(slot + 1, InvalidBinding);
+      
+      m_slotBindings[slot] = i;
+      
+      if (bindingInfos[i].set >= m_setCount) {
+        if (bindingInfos[i].set >= DxvkLimits::MaxNumDescriptorSets)
+          throw DxvkError("DxvkBindingLayout: Too many descriptor sets");
+        
+        m_setCount = bindingInfos[i].set + 1;
+        m_sets[bindingInfos[i].set].layout         = VK_NULL_HANDLE;
+        m_sets[bindingInfos[i].set].updateTemplate = VK_NULL_HANDLE;
+        m_sets[bindingInfos[i].set].bindingOffset  = i;
+        m_sets[bindingInfos[i].set].bindingCount   = 0;
+      }
+      
+      m_sets[bindingInfos[i].set].bindingCount += 1;
     }
     
-    VkDescriptorSetLayoutCreateInfo dsetInfo;
-    dsetInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    dsetInfo.pNext        = nullptr;
-    dsetInfo.flags        = 0;
-    dsetInfo.bindingCount = bindings.size();
-    dsetInfo.pBindings    = bindings.data();
+    m_pushSet = this->choosePushDescriptorSet(extensions);
     
-    if (m_vkd->vkCreateDescriptorSetLayout(m_vkd->device(),
-          &dsetInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS)
-      throw DxvkError("DxvkBindingLayout: Failed to create descriptor set layout");
+    // Use dynamic offsets for uniform buffers so that binding
+    // a different range of the same buffer does not require
+    // a new descriptor set. Push descriptor sets cannot use
+    // dynamic buffers, and their total number is limited.
+    uint32_t dynamicBufferCount = 0;
+    
+    for (auto& slotInfo : m_bindingSlots) {
+      if (slotInfo.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+       || slotInfo.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) {
+        const bool dynamic = slotInfo.set != m_pushSet
+          && dynamicBufferCount < DxvkLimits::MaxNumDynamicBuffers;
+        
+        slotInfo.type = dynamic
+          ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+          : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        
+        if (dynamic)
+          dynamicBufferCount += 1;
+      }
+    }
+    
+    std::array<VkDescriptorSetLayout, DxvkLimits::MaxNumDescriptorSets> setLayouts;
+    
+    for (uint32_t i = 0; i < m_setCount; i++) {
+      std::vector<VkDescriptorSetLayoutBinding> bindings;
+      
+      for (uint32_t j = 0; j < m_sets[i].bindingCount; j++) {
+        const DxvkDescriptorSlot& slotInfo = m_bindingSlots[m_sets[i].bindingOffset + j];
+        
+        VkDescriptorSetLayoutBinding binding;
+        binding.binding            = slotInfo.binding;
+        binding.descriptorType     = slotInfo.type;
+        binding.descriptorCount    = 1;
+        binding.stageFlags         = slotInfo.stages;
+        binding.pImmutableSamplers = nullptr;
+        bindings.push_back(binding);
+      }
+      
+      VkDescriptorSetLayoutCreateInfo dsetInfo;
+      dsetInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+      dsetInfo.pNext        = nullptr;
+      dsetInfo.flags        = i == m_pushSet
+        ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR
+        : 0;
+      dsetInfo.bindingCount = bindings.size();
+      dsetInfo.pBindings    = bindings.data();
+      
+      if (m_vkd->vkCreateDescriptorSetLayout(m_vkd->device(),
+            &dsetInfo, nullptr, &m_sets[i].layout) != VK_SUCCESS) {
+        this->destroySetLayouts();
+        throw DxvkError("DxvkBindingLayout: Failed to create descriptor set layout");
+      }
+      
+      setLayouts[i] = m_sets[i].layout;
+    }
     
     VkPipelineLayoutCreateInfo pipeInfo;
     pipeInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipeInfo.pNext                  = nullptr;
     pipeInfo.flags                  = 0;
-    pipeInfo.setLayoutCount         = 1;
-    pipeInfo.pSetLayouts            = &m_descriptorSetLayout;
+    pipeInfo.setLayoutCount         = m_setCount;
+    pipeInfo.pSetLayouts            = setLayouts.data();
     pipeInfo.pushConstantRangeCount = 0;
     pipeInfo.pPushConstantRanges    = nullptr;
     
     if (m_vkd->vkCreatePipelineLayout(m_vkd->device(),
           &pipeInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
-      m_vkd->vkDestroyDescriptorSetLayout(
-        m_vkd->device(), m_descriptorSetLayout, nullptr);
+      this->destroySetLayouts();
       throw DxvkError("DxvkBindingLayout: Failed to create pipeline layout");
     }
+    
+    // Update templates are optional. If one cannot be
+    // created, descriptors are written the regular way.
+    if (extensions.khrDescriptorUpdateTemplate) {
+      for (uint32_t i = 0; i < m_setCount; i++)
+        m_sets[i].updateTemplate = this->createUpdateTemplate(i);
+    }
   }
   
   
   DxvkBindingLayout::~DxvkBindingLayout() {
+    for (uint32_t i = 0; i < m_setCount; i++) {
+      if (m_sets[i].updateTemplate != VK_NULL_HANDLE) {
+        m_vkd->vkDestroyDescriptorUpdateTemplateKHR(
+          m_vkd->device(), m_sets[i].updateTemplate, nullptr);
+      }
+    }
+    
     if (m_pipelineLayout != VK_NULL_HANDLE) {
       m_vkd->vkDestroyPipelineLayout(
         m_vkd->device(), m_pipelineLayout, nullptr);
     }
     
-    if (m_descriptorSetLayout != VK_NULL_HANDLE) {
-      m_vkd->vkDestroyDescriptorSetLayout(
-        m_vkd->device(), m_descriptorSetLayout, nullptr);
+    this->destroySetLayouts();
+  }
+  
+  
+  VkDescriptorUpdateTemplateKHR DxvkBindingLayout::createUpdateTemplate(
+          uint32_t               setId) const {
+    const DxvkDescriptorSetInfo& set = m_sets[setId];
+    
+    std::vector<VkDescriptorUpdateTemplateEntryKHR> entries;
+    
+    for (uint32_t i = 0; i < set.bindingCount; i++) {
+      const DxvkDescriptorSlot& slotInfo = m_bindingSlots[set.bindingOffset + i];
+      
+      VkDescriptorUpdateTemplateEntryKHR entry;
+      entry.dstBinding      = slotInfo.binding;
+      entry.dstArrayElement = 0;
+      entry.descriptorCount = 1;
+      entry.descriptorType  = slotInfo.type;
+      entry.offset          = sizeof(DxvkDescriptorInfo) * i;
+      entry.stride          = sizeof(DxvkDescriptorInfo);
+      
+      switch (slotInfo.type) {
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+          entry.offset += offsetof(DxvkDescriptorInfo, image);
+          break;
+        
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+          entry.offset += offsetof(DxvkDescriptorInfo, texelBuffer);
+          break;
+        
+        default:
+          entry.offset += offsetof(DxvkDescriptorInfo, buffer);
+      }
+      
+      entries.push_back(entry);
+    }
+    
+    VkDescriptorUpdateTemplateCreateInfoKHR info;
+    info.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+    info.pNext                      = nullptr;
+    info.flags                      = 0;
+    info.descriptorUpdateEntryCount = entries.size();
+    info.pDescriptorUpdateEntries   = entries.data();
+    info.templateType               = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+    info.descriptorSetLayout        = set.layout;
+    info.pipelineBindPoint          = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    info.pipelineLayout             = m_pipelineLayout;
+    info.set                        = setId;
+    
+    // Push descriptor templates are tied to the pipeline
+    // layout and bind point rather than the set layout
+    if (setId == m_pushSet) {
+      info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR;
+      
+      if (m_bindingSlots[set.bindingOffset].stages & VK_SHADER_STAGE_COMPUTE_BIT)
+        info.pipelineBindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+    }
+    
+    VkDescriptorUpdateTemplateKHR result = VK_NULL_HANDLE;
+    
+    if (m_vkd->vkCreateDescriptorUpdateTemplateKHR(
+          m_vkd->device(), &info, nullptr, &result) != VK_SUCCESS) {
+      Logger::warn("DxvkBindingLayout: Failed to create descriptor update template");
+      return VK_NULL_HANDLE;
+    }
+    
+    return result;
+  }
+  
+  
+  uint32_t DxvkBindingLayout::choosePushDescriptorSet(
+    const DxvkDeviceExtensions&  extensions) const {
+    // Push descriptors only pay off for small sets, since
+    // the entire set has to be written again whenever any
+    // of its bindings change. The limit is well below the
+    // minimum guaranteed number of push descriptors.
+    constexpr uint32_t MaxPushBindings = 8;
+    
+    if (!extensions.khrPushDescriptor || m_setCount == 0)
+      return DxvkLimits::MaxNumDescriptorSets;
+    
+    // Sets are ordered by how often their resources are
+    // expected to change, so the last set is the one that
+    // would otherwise be allocated and bound most often.
+    const uint32_t setId = m_setCount - 1;
+    
+    return m_sets[setId].bindingCount <= MaxPushBindings
+      ? setId : uint32_t(DxvkLimits::MaxNumDescriptorSets);
+  }
+  
+  
+  void DxvkBindingLayout::destroySetLayouts() {
+    for (uint32_t i = 0; i < m_setCount; i++) {
+      if (m_sets[i].layout != VK_NULL_HANDLE) {
+        m_vkd->vkDestroyDescriptorSetLayout(
+          m_vkd->device(), m_sets[i].layout, nullptr);
+      }
     }
   }
   
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <array>
 #include <vector>
 
+#include "dxvk_extensions.h"
 #include "dxvk_include.h"
+#include "dxvk_limits.h"
 
 namespace dxvk {
   
@@ -17,6 +20,26 @@ namespace dxvk {
     uint32_t           slot;    ///< Resource slot index for the context
     VkDescriptorType   type;    ///< Descriptor type (aka resource type)
     VkShaderStageFlags stages;  ///< Stages that can use the resource
+    uint32_t           set;     ///< Descriptor set index
+    uint32_t           binding; ///< Binding index within the set
+  };
+  
+  
+  /**
+   * \brief Descriptor set info
+   * 
+   * Range of bindings that belong to one
+   * descriptor set of a binding layout. If
+   * supported, the update template writes
+   * the set from a tightly packed array of
+   * \ref DxvkDescriptorInfo structures in
+   * binding order.
+   */
+  struct DxvkDescriptorSetInfo {
+    VkDescriptorSetLayout         layout;
+    VkDescriptorUpdateTemplateKHR updateTemplate;
+    uint32_t                      bindingOffset;
+    uint32_t                      bindingCount;
   };
   
   
@@ -27,6 +50,11 @@ namespace dxvk {
    * index to binding index mappings. This is required
    * when generating Vulkan pipeline and descriptor set
    * layouts.
+   * 
+   * Bindings are distributed across multiple descriptor
+   * sets by the shader stages that use them, so that
+   * changing a resource for one stage does not require
+   * rewriting the descriptors of all other stages.
    */
   class DxvkDescriptorSlotMapping {
     constexpr static uint32_t InvalidBinding = 0xFFFFFFFFu;
@@ -67,18 +95,41 @@ namespace dxvk {
             VkDescriptorType      type,
             VkShaderStageFlagBits stage);
     
+    /**
+     * \brief Assigns bindings to descriptor sets
+     * 
+     * Must be called after all slots have been defined.
+     * Reorders the bindings so that bindings of the same
+     * set are adjacent, and sets the descriptor set and
+     * binding index within the set for each binding.
+     * \param [in] maxSetCount Number of descriptor sets
+     *        that can be bound at the same time
+     */
+    void assignDescriptorSets(
+            uint32_t              maxSetCount = DxvkLimits::MaxNumDescriptorSets);
+    
     /**
      * \brief Gets binding ID for a slot
      * 
+     * The returned index refers to the array
+     * returned by \ref bindingInfos.
      * \param [in] slot Resource slot
      * \returns Binding index, or \c InvalidBinding
      */
     uint32_t getBindingId(
-            uint32_t              slot) const;
+            uint32_t              slot) const {
+      return slot < m_bindingIds.size()
+        ? m_bindingIds[slot]
+        : InvalidBinding;
+    }
     
   private:
     
     std::vector<DxvkDescriptorSlot> m_descriptorSlots;
+    std::vector<uint32_t>           m_bindingIds;
+    
+    static uint32_t getSetClass(
+            VkShaderStageFlags    stages);
     
   };
   
@@ -90,13 +141,14 @@ namespace dxvk {
    * for a graphics or compute pipeline.
    */
   class DxvkBindingLayout : public RcObject {
-    
+    constexpr static uint32_t InvalidBinding = 0xFFFFFFFFu;
   public:
     
     DxvkBindingLayout(
-      const Rc<vk::DeviceFn>&   vkd,
-            uint32_t            bindingCount,
-      const DxvkDescriptorSlot* bindingInfos);
+      const Rc<vk::DeviceFn>&     vkd,
+      const DxvkDeviceExtensions& extensions,
+            uint32_t              bindingCount,
+      const DxvkDescriptorSlot*   bindingInfos);
     
     ~DxvkBindingLayout();
     
@@ -117,11 +169,67 @@ namespace dxvk {
     }
     
     /**
-     * \brief Descriptor set layout handle
-     * \returns Descriptor set layout handle
+     * \brief Number of descriptor sets
+     * \returns Descriptor set count
+     */
+    uint32_t descriptorSetCount() const {
+      return m_setCount;
+    }
+    
+    /**
+     * \brief Descriptor set info
+     * 
+     * \param [in] set Descriptor set index
+     * \returns Layout and bindings of the set
      */
-    VkDescriptorSetLayout descriptorSetLayout() const {
-      return m_descriptorSetLayout;
+    const DxvkDescriptorSetInfo& descriptorSet(uint32_t set) const {
+      return m_sets[set];
+    }
+    
+    /**
+     * \brief Push descriptor set
+     * 
+     * At most one set per layout can use push
+     * descriptors. Such a set is not allocated
+     * from a pool and is never bound, instead its
+     * descriptors are written into the command
+     * buffer with \c vkCmdPushDescriptorSetKHR.
+     * \returns Push descriptor set index, or
+     *          \c DxvkLimits::MaxNumDescriptorSets
+     */
+    uint32_t pushDescriptorSet() const {
+      return m_pushSet;
+    }
+    
+    /**
+     * \brief Binding for a slot
+     * 
+     * Note that the descriptor type may differ from
+     * the one the slot was defined with, since some
+     * uniform buffers use dynamic offsets.
+     * \param [in] slot Resource slot
+     * \returns Binding info, or \c nullptr if
+     *          the slot is not used by the layout
+     */
+    const DxvkDescriptorSlot* getBindingForSlot(uint32_t slot) const {
+      return slot < m_slotBindings.size() && m_slotBindings[slot] != InvalidBinding
+        ? &m_bindingSlots[m_slotBindings[slot]]
+        : nullptr;
+    }
+    
+    /**
+     * \brief Descriptor set containing a slot
+     * 
+     * \param [in] slot Resource slot
+     * \returns Descriptor set index, or
+     *          \c DxvkLimits::MaxNumDescriptorSets
+     */
+    uint32_t getSetForSlot(uint32_t slot) const {
+      const DxvkDescriptorSlot* binding = this->getBindingForSlot(slot);
+      
+      return binding != nullptr
+        ? binding->set
+        : uint32_t(DxvkLimits::MaxNumDescriptorSets);
     }
     
     /**
@@ -136,10 +244,22 @@ namespace dxvk {
     
     Rc<vk::DeviceFn>      m_vkd;
     
-    VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
     VkPipelineLayout      m_pipelineLayout      = VK_NULL_HANDLE;
     
+    uint32_t m_setCount = 0;
+    uint32_t m_pushSet  = DxvkLimits::MaxNumDescriptorSets;
+    std::array<DxvkDescriptorSetInfo, DxvkLimits::MaxNumDescriptorSets> m_sets;
+    
     std::vector<DxvkDescriptorSlot> m_bindingSlots;
+    std::vector<uint32_t>           m_slotBindings;
+    
+    VkDescriptorUpdateTemplateKHR createUpdateTemplate(
+            uint32_t               setId) const;
+    
+    uint32_t choosePushDescriptorSet(
+      const DxvkDeviceExtensions&  extensions) const;
+    
+    void destroySetLayouts();
     
   };
   
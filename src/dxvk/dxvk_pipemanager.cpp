@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "dxvk_pipemanager.h"
 
 namespace dxvk {
@@ -35,8 +37,18 @@ namespace dxvk {
   }
   
   
-  DxvkPipelineManager::DxvkPipelineManager(const Rc<vk::DeviceFn>& vkd)
-  : m_vkd(vkd) { }
+  DxvkPipelineManager::DxvkPipelineManager(
+    const Rc<vk::DeviceFn>&           vkd,
+    const DxvkDeviceExtensions&       extensions,
+    const VkPhysicalDeviceProperties& properties,
+    const Rc<DxvkRenderPassPool>&     renderPassPool)
+  : m_vkd              (vkd),
+    m_extensions       (extensions),
+    m_maxDescriptorSets(properties.limits.maxBoundDescriptorSets),
+    m_cache            (new DxvkPipelineCache(vkd, properties)),
+    m_renderPassPool   (renderPassPool),
+    m_stateCache       (new DxvkStateCache()),
+    m_compiler         (new DxvkPipelineCompiler()) { }
   
   
   DxvkPipelineManager::~DxvkPipelineManager() {
@@ -52,16 +64,24 @@ namespace dxvk {
     DxvkComputePipelineKey key;
     key.cs = cs;
     
+    Rc<DxvkComputePipeline> pipeline;
+    
+    if (m_computePipelines.find(key, pipeline))
+      return pipeline;
+    
+    // Creating the pipeline waits for the shader to be
+    // compiled, so the lock is only taken for insertion.
+    // If another thread was faster, use its pipeline.
+    Rc<DxvkComputePipeline> newPipeline = new DxvkComputePipeline(
+      m_vkd, m_extensions, m_cache, cs);
+    
     std::lock_guard<std::mutex> lock(m_mutex);
-    auto pair = m_computePipelines.find(key);
     
-    if (pair != m_computePipelines.end())
-      return pair->second;
+    if (m_computePipelines.find(key, pipeline))
+      return pipeline;
     
-    const Rc<DxvkComputePipeline> pipeline
-      = new DxvkComputePipeline(m_vkd, cs);
-    m_computePipelines.insert(std::make_pair(key, pipeline));
-    return pipeline;
+    m_computePipelines.insert(key, newPipeline);
+    return newPipeline;
   }
   
   
@@ -81,16 +101,99 @@ namespace dxvk {
     key.gs  = gs;
     key.fs  = fs;
     
+    Rc<DxvkGraphicsPipeline> pipeline;
+    
+    if (m_graphicsPipelines.find(key, pipeline))
+      return pipeline;
+    
+    // Same as for compute pipelines, a compiler worker that
+    // builds a cached pipeline must not block other threads
+    // while it waits for the shaders to be compiled.
+    Rc<DxvkGraphicsPipeline> newPipeline = new DxvkGraphicsPipeline(
+      m_vkd, m_extensions, m_maxDescriptorSets, m_cache,
+      m_compiler.ptr(), m_stateCache.ptr(),
+      vs, tcs, tes, gs, fs);
+    
     std::lock_guard<std::mutex> lock(m_mutex);
-    auto pair = m_graphicsPipelines.find(key);
     
-    if (pair != m_graphicsPipelines.end())
-      return pair->second;
+    if (m_graphicsPipelines.find(key, pipeline))
+      return pipeline;
+    
+    m_graphicsPipelines.insert(key, newPipeline);
+    return newPipeline;
+  }
+  
+  
+  Rc<DxvkShader> DxvkPipelineManager::registerShader(
+    const Rc<DxvkShader>& shader) {
+    if (shader == nullptr || shader->shaderKey() == Sha1Hash())
+      return shader;
+    
+    std::lock_guard<std::mutex> lock(m_shaderLock);
+    
+    auto pair = m_shaders.insert({ shader->shaderKey(), shader });
+    
+    if (!pair.second)
+      return pair.first->second;
+    
+    if (m_shaders.size() >= m_shaderPruneCount) {
+      this->pruneShaders();
+      
+      m_shaderPruneCount = std::max(
+        2 * m_shaders.size(), MinShaderPruneCount);
+    }
+    
+    // Creating the pipeline waits for the shader to be
+    // compiled, so this must not run on the calling thread.
+    // The task holds on to the shaders until it has run.
+    for (const auto& entry : m_stateCache->registerShader(shader->shaderKey())) {
+      std::array<Rc<DxvkShader>, 5> shaders;
+      
+      for (uint32_t i = 0; i < shaders.size(); i++) {
+        if (entry.shaders[i] != Sha1Hash())
+          shaders[i] = m_shaders.at(entry.shaders[i]);
+      }
+      
+      m_compiler->queueTask([this, entry, shaders] {
+        this->compileCachedPipeline(entry, shaders);
+      });
+    }
+    
+    return shader;
+  }
+  
+  
+  void DxvkPipelineManager::compileCachedPipeline(
+    const DxvkStateCacheEntry&            entry,
+    const std::array<Rc<DxvkShader>, 5>&  shaders) {
+    try {
+      Rc<DxvkGraphicsPipeline> pipeline = this->createGraphicsPipeline(
+        shaders[0], shaders[1], shaders[2], shaders[3], shaders[4]);
+      
+      DxvkGraphicsPipelineStateInfo state = entry.state;
+      state.omRenderPass = m_renderPassPool->getRenderPass(entry.format)->handle();
+      
+      pipeline->getPipelineHandleAsync(state, entry.format);
+    } catch (const DxvkError& e) {
+      Logger::err(e.message());
+    }
+  }
     
-    const Rc<DxvkGraphicsPipeline> pipeline
-      = new DxvkGraphicsPipeline(m_vkd, vs, tcs, tes, gs, fs);
-    m_graphicsPipelines.insert(std::make_pair(key, pipeline));
-    return pipeline;
+  void DxvkPipelineManager::pruneShaders() {
+    // A shader that is only referenced by the map is used by
+    // neither the application nor any pipeline. New references
+    // can only be obtained from the map while the lock is held,
+    // so the reference count cannot go up in the meantime. The
+    // state cache forgets the shader as well, so that its cached
+    // pipelines get compiled again if it is ever recreated.
+    for (auto i = m_shaders.begin(); i != m_shaders.end(); ) {
+      if (i->second.ptr()->refCount() == 1) {
+        m_stateCache->unregisterShader(i->first);
+        i = m_shaders.erase(i);
+      } else {
+        i++;
+      }
+    }
   }
   
 }
\ No newline at end of file
@@ -3,8 +3,12 @@
 #include <mutex>
 #include <unordered_map>
 
+#include "../util/sync/sync_map.h"
+
 #include "dxvk_compute.h"
 #include "dxvk_graphics.h"
+#include "dxvk_pipecompiler.h"
+#include "dxvk_statecache.h"
 
 namespace dxvk {
   
@@ -54,13 +58,24 @@ namespace dxvk {
    * used within the application. This is necessary
    * because DXVK does not expose the concept of shader
    * pipeline objects to the client API.
+   * 
+   * All pipelines share a single Vulkan pipeline cache
+   * and a pool of background compiler threads. Pipelines
+   * recorded in the state cache during previous runs are
+   * compiled as soon as their shaders get registered.
    */
   class DxvkPipelineManager : public RcObject {
-    
+    // Shaders that are no longer in use are removed from
+    // the shader map whenever its size doubles, but only
+    // once it has reached a reasonable size to begin with.
+    constexpr static size_t MinShaderPruneCount = 256;
   public:
     
     DxvkPipelineManager(
-      const Rc<vk::DeviceFn>&   vkd);
+      const Rc<vk::DeviceFn>&           vkd,
+      const DxvkDeviceExtensions&       extensions,
+      const VkPhysicalDeviceProperties& properties,
+      const Rc<DxvkRenderPassPool>&     renderPassPool);
     ~DxvkPipelineManager();
     
     /**
@@ -95,24 +110,80 @@ namespace dxvk {
       const Rc<DxvkShader>& gs,
       const Rc<DxvkShader>& fs);
     
+    /**
+     * \brief Registers a shader
+     * 
+     * Makes the shader available to the state cache, and
+     * queues all cached pipelines that use the shader for
+     * compilation. If a shader with the same key has been
+     * registered before and is still in use, that shader
+     * will be returned so that pipelines can be shared.
+     * \param [in] shader The shader to register
+     * \returns Shader object to use
+     */
+    Rc<DxvkShader> registerShader(
+      const Rc<DxvkShader>& shader);
+    
+    /**
+     * \brief Retrieves pipeline compiler statistics
+     * \returns Pipeline compiler statistics
+     */
+    DxvkPipelineCompilerStats compilerStats() const {
+      return m_compiler->stats();
+    }
+    
+    /**
+     * \brief Retrieves pipeline cache statistics
+     * \returns Pipeline cache statistics
+     */
+    DxvkPipelineCacheStats cacheStats() const {
+      return m_cache->stats();
+    }
+    
   private:
     
-    const Rc<vk::DeviceFn> m_vkd;
+    const Rc<vk::DeviceFn>     m_vkd;
+    const DxvkDeviceExtensions m_extensions;
+    const uint32_t             m_maxDescriptorSets;
+    
+    Rc<DxvkPipelineCache>   m_cache;
+    Rc<DxvkRenderPassPool>  m_renderPassPool;
+    Rc<DxvkStateCache>      m_stateCache;
     
+    // Only serializes pipeline insertion
     std::mutex m_mutex;
     
-    std::unordered_map<
+    ReadMostlyMap<
       DxvkComputePipelineKey,
       Rc<DxvkComputePipeline>,
       DxvkPipelineKeyHash,
       DxvkPipelineKeyEq> m_computePipelines;
     
-    std::unordered_map<
+    ReadMostlyMap<
       DxvkGraphicsPipelineKey,
       Rc<DxvkGraphicsPipeline>,
       DxvkPipelineKeyHash,
       DxvkPipelineKeyEq> m_graphicsPipelines;
     
+    std::mutex m_shaderLock;
+    
+    std::unordered_map<
+      Sha1Hash,
+      Rc<DxvkShader>,
+      DxvkHash> m_shaders;
+    
+    size_t m_shaderPruneCount = MinShaderPruneCount;
+    
+    // Declared last so that the worker threads are
+    // stopped before any of the pipelines are destroyed
+    Rc<DxvkPipelineCompiler> m_compiler;
+    
+    void compileCachedPipeline(
+      const DxvkStateCacheEntry&            entry,
+      const std::array<Rc<DxvkShader>, 5>&  shaders);
+    
+    void pruneShaders();
+    
   };
   
 }
\ No newline at end of file
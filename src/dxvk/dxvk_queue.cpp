@@ -0,0 +1,98 @@
+#include "dxvk_device.h"
+#include "dxvk_queue.h"
+
+namespace dxvk {
+  
+  DxvkSubmissionQueue::DxvkSubmissionQueue(DxvkDevice* device)
+  : m_device(device),
+    m_thread([this] () { threadFunc(); }) {
+    
+  }
+  
+  
+  DxvkSubmissionQueue::~DxvkSubmissionQueue() {
+    { std::unique_lock<std::mutex> lock(m_mutex);
+      m_stopped.store(true);
+    }
+    
+    m_condOnAdd.notify_one();
+    m_thread.join();
+  }
+  
+  
+  void DxvkSubmissionQueue::submit(
+    const Rc<DxvkFence>&        fence,
+    const Rc<DxvkCommandList>&  cmdList) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    m_condOnTake.wait(lock, [this] {
+      return m_pending.load() < MaxNumQueuedCommandBuffers;
+    });
+    
+    m_entries.push({ fence, cmdList });
+    m_pending += 1;
+    m_condOnAdd.notify_one();
+  }
+  
+  
+  void DxvkSubmissionQueue::synchronize() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    m_condOnTake.wait(lock, [this] {
+      return m_pending.load() == 0;
+    });
+  }
+  
+  
+  void DxvkSubmissionQueue::waitForSubmission(uint64_t submissionId) {
+    if (m_retired.load() >= submissionId)
+      return;
+    
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    m_condOnTake.wait(lock, [this, submissionId] {
+      return m_retired.load() >= submissionId;
+    });
+  }
+  
+  
+  void DxvkSubmissionQueue::threadFunc() {
+    while (true) {
+      DxvkSubmission entry;
+      
+      { std::unique_lock<std::mutex> lock(m_mutex);
+        
+        m_condOnAdd.wait(lock, [this] {
+          return m_stopped.load() || !m_entries.empty();
+        });
+        
+        // Drain the queue before exiting so that
+        // all command lists get properly reset
+        if (m_entries.empty())
+          return;
+        
+        entry = std::move(m_entries.front());
+        m_entries.pop();
+      }
+      
+      // Command lists are retired in submission order, so
+      // waiting for the oldest fence first is sufficient
+      entry.fence->wait(std::numeric_limits<uint64_t>::max());
+      
+      // Resources must be released before the submission
+      // is marked as retired, see DxvkResource::lastSubmission
+      const uint64_t submissionId = entry.cmdList->submissionId();
+      
+      entry.cmdList->reset();
+      m_device->recycleCommandList(entry.cmdList);
+      
+      { std::unique_lock<std::mutex> lock(m_mutex);
+        m_pending -= 1;
+        m_retired.store(submissionId);
+      }
+      
+      m_condOnTake.notify_all();
+    }
+  }
+  
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include "dxvk_cmdlist.h"
+#include "dxvk_sync.h"
+
+namespace dxvk {
+  
+  class DxvkDevice;
+  
+  /**
+   * \brief In-flight submission
+   * 
+   * Stores a command list that has been submitted
+   * to a device queue, along with the fence that
+   * will be signaled once execution has completed.
+   */
+  struct DxvkSubmission {
+    Rc<DxvkFence>       fence;
+    Rc<DxvkCommandList> cmdList;
+  };
+  
+  
+  /**
+   * \brief Submission queue
+   * 
+   * Keeps track of command lists that are currently being
+   * executed by the GPU. A background thread waits for the
+   * fence of each submission to be signaled, and then resets
+   * the command list and returns it to the device. This
+   * releases all resources that were tracked by it.
+   * 
+   * The number of in-flight submissions is limited in
+   * order to prevent the CPU from running too far ahead.
+   */
+  class DxvkSubmissionQueue {
+    constexpr static uint32_t MaxNumQueuedCommandBuffers = 8;
+  public:
+    
+    DxvkSubmissionQueue(DxvkDevice* device);
+    ~DxvkSubmissionQueue();
+    
+    /**
+     * \brief Adds a submission to the queue
+     * 
+     * The command list must have been submitted to a device
+     * queue with the given fence. If the maximum number of
+     * in-flight submissions is reached, this will block
+     * until the oldest submission has been retired.
+     * \param [in] fence Fence signaled by the submission
+     * \param [in] cmdList The submitted command list
+     */
+    void submit(
+      const Rc<DxvkFence>&        fence,
+      const Rc<DxvkCommandList>&  cmdList);
+    
+    /**
+     * \brief Waits for all submissions to retire
+     * 
+     * Blocks until all command lists that have been added
+     * to the queue have completed execution and have been
+     * reset, i.e. all tracked resources are released.
+     */
+    void synchronize();
+    
+    /**
+     * \brief Waits for a submission to retire
+     * 
+     * Blocks until the command list with the given
+     * submission ID and all previous ones have been
+     * reset. Does not wait for later submissions.
+     * \param [in] submissionId Submission ID
+     */
+    void waitForSubmission(uint64_t submissionId);
+    
+    /**
+     * \brief Last retired submission
+     * 
+     * All command lists with this ID or a lower one
+     * have completed execution and have been reset.
+     * \returns ID of the last retired submission
+     */
+    uint64_t retiredSubmission() const {
+      return m_retired.load();
+    }
+    
+    /**
+     * \brief Number of in-flight submissions
+     * \returns Number of pending submissions
+     */
+    uint32_t pending() const {
+      return m_pending.load();
+    }
+    
+  private:
+    
+    DxvkDevice* m_device;
+    
+    std::atomic<bool>     m_stopped = { false };
+    std::atomic<uint32_t> m_pending = { 0u };
+    std::atomic<uint64_t> m_retired = { 0ull };
+    
+    std::mutex                  m_mutex;
+    std::condition_variable     m_condOnAdd;
+    std::condition_variable     m_condOnTake;
+    std::queue<DxvkSubmission>  m_entries;
+    std::thread                 m_thread;
+    
+    void threadFunc();
+    
+  };
+  
+}
\ No newline at end of file
@@ -123,6 +123,14 @@ namespace dxvk {
       return m_renderPass;
     }
     
+    /**
+     * \brief Render pass format
+     * \returns Render target formats
+     */
+    const DxvkRenderPassFormat& format() const {
+      return m_format;
+    }
+    
     /**
      * \brief Render pass sample count
      * \returns Render pass sample count
@@ -17,6 +17,10 @@ namespace dxvk {
    * Keeps track of whether the resource is currently in use
    * by the GPU. As soon as a command that uses the resource
    * is recorded, it will be marked as 'in use'.
+   * 
+   * Also stores the ID of the most recent submission that
+   * used the resource, so that the host can wait for that
+   * submission only rather than for the entire device.
    */
   class DxvkResource : public RcObject {
     
@@ -24,16 +28,70 @@ namespace dxvk {
     
     virtual ~DxvkResource();
     
+    /**
+     * \brief Checks whether the resource is in use
+     * 
+     * \returns \c true if any command list that uses the
+     *          resource has not yet completed execution
+     */
     bool isInUse() const {
       return m_useCount != 0;
     }
     
-    void acquire() { m_useCount += 1; }
-    void release() { m_useCount -= 1; }
+    /**
+     * \brief Checks for unsubmitted commands
+     * 
+     * \returns \c true if the resource is used by a command
+     *          list that has not been submitted yet
+     */
+    bool isPending() const {
+      return m_pendingCount != 0;
+    }
+    
+    /**
+     * \brief Last submission using the resource
+     * 
+     * Once the device has retired this submission, only
+     * command lists that have not been submitted at the
+     * time of the query may still use the resource.
+     * \returns Submission ID, or zero if never submitted
+     */
+    uint64_t lastSubmission() const {
+      return m_submission.load();
+    }
+    
+    void acquire() {
+      m_useCount     += 1;
+      m_pendingCount += 1;
+    }
+    
+    void release() {
+      m_useCount     -= 1;
+    }
+    
+    /**
+     * \brief Notifies the resource of a submission
+     * 
+     * Called once for every command list that acquired
+     * the resource, with an ID of zero if the command
+     * list was reset without being submitted.
+     * \param [in] submissionId Submission ID
+     */
+    void submit(uint64_t submissionId) {
+      uint64_t current = m_submission.load();
+      
+      while (current < submissionId
+        && !m_submission.compare_exchange_weak(current, submissionId))
+        continue;
+      
+      m_pendingCount -= 1;
+    }
     
   private:
     
-    std::atomic<uint32_t> m_useCount = { 0u };
+    std::atomic<uint32_t> m_useCount     = { 0u };
+    std::atomic<uint32_t> m_pendingCount = { 0u };
+    std::atomic<uint64_t> m_submission   = { 0ull };
     
   };
   
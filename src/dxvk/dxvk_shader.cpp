@@ -1,3 +1,5 @@
+#include <unordered_map>
+
 #include "dxvk_shader.h"
 
 namespace dxvk {
@@ -6,17 +8,27 @@ namespace dxvk {
     const Rc<vk::DeviceFn>&     vkd,
           VkShaderStageFlagBits stage,
     const SpirvCodeBuffer&      code)
+  : DxvkShaderModule(vkd, stage, code.size(), code.data()) {
+    
+  }
+  
+  
+  DxvkShaderModule::DxvkShaderModule(
+    const Rc<vk::DeviceFn>&     vkd,
+          VkShaderStageFlagBits stage,
+          size_t                codeSize,
+    const uint32_t*             code)
   : m_vkd(vkd), m_stage(stage) {
     VkShaderModuleCreateInfo info;
     info.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     info.pNext    = nullptr;
     info.flags    = 0;
-    info.codeSize = code.size();
-    info.pCode    = code.data();
+    info.codeSize = codeSize;
+    info.pCode    = code;
     
     if (m_vkd->vkCreateShaderModule(m_vkd->device(),
           &info, nullptr, &m_module) != VK_SUCCESS)
-      throw DxvkError("DxvkComputePipeline::DxvkComputePipeline: Failed to create shader module");
+      throw DxvkError("DxvkShaderModule::DxvkShaderModule: Failed to create shader module");
   }
   
   
@@ -48,6 +60,15 @@ namespace dxvk {
   : m_stage(stage), m_code(code) {
     for (uint32_t i = 0; i < slotCount; i++)
       m_slots.push_back(slotInfos[i]);
+    
+    this->findBindingOffsets();
+  }
+  
+  
+  DxvkShader::DxvkShader(
+          VkShaderStageFlagBits   stage)
+  : m_stage(stage), m_ready(false) {
+    
   }
   
   
@@ -56,8 +77,40 @@ namespace dxvk {
   }
   
   
+  void DxvkShader::complete(
+    const Rc<DxvkShader>&         shader) {
+    { std::unique_lock<std::mutex> lock(m_readyLock);
+      
+      if (shader != nullptr) {
+        m_code  = shader->code();
+        m_slots = shader->slots();
+        m_bindingOffsets = shader->m_bindingOffsets;
+      } else {
+        m_failed = true;
+      }
+      
+      m_ready.store(true);
+    }
+    
+    m_readyCond.notify_all();
+  }
+  
+  
+  void DxvkShader::wait() const {
+    if (m_ready.load())
+      return;
+    
+    std::unique_lock<std::mutex> lock(m_readyLock);
+    m_readyCond.wait(lock, [this] {
+      return m_ready.load();
+    });
+  }
+  
+  
   void DxvkShader::defineResourceSlots(
           DxvkDescriptorSlotMapping& mapping) const {
+    this->wait();
+    
     for (const auto& slot : m_slots)
       mapping.defineSlot(slot.slot, slot.type, m_stage);
   }
@@ -66,31 +119,115 @@ namespace dxvk {
   Rc<DxvkShaderModule> DxvkShader::createShaderModule(
     const Rc<vk::DeviceFn>&          vkd,
     const DxvkDescriptorSlotMapping& mapping) const {
-    // Iterate over the code and replace every resource slot
-    // index with the corresponding mapped binding index.
-    SpirvCodeBuffer spirvCode = m_code;
+    this->wait();
     
-    for (auto ins : spirvCode) {
-      if (ins.opCode() == spv::OpDecorate
-       && ins.arg(2)   == spv::DecorationBinding) {
-        
-        const uint32_t oldBinding = ins.arg(3);
-        const uint32_t newBinding = mapping.getBindingId(oldBinding);
-        ins.setArg(3, newBinding);
-      }
+    if (m_failed)
+      throw DxvkError("DxvkShader::createShaderModule: Shader compilation failed");
+    
+    // The resulting code only depends on the descriptor set and
+    // binding that the mapping assigns to our own resource slots
+    std::vector<uint32_t> bindingIds(2 * m_bindingOffsets.size());
+    
+    for (uint32_t i = 0; i < m_bindingOffsets.size(); i++) {
+      const uint32_t bindingId = mapping.getBindingId(m_bindingOffsets[i].slot);
+      
+      if (bindingId >= mapping.bindingCount())
+        throw DxvkError("DxvkShader::createShaderModule: Resource slot not defined");
+      
+      const DxvkDescriptorSlot& binding = mapping.bindingInfos()[bindingId];
+      bindingIds[2 * i + 0] = binding.set;
+      bindingIds[2 * i + 1] = binding.binding;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_moduleLock);
+    
+    // Shaders are typically used with a handful of
+    // different layouts, so a linear search is fine
+    for (const auto& entry : m_modules) {
+      if (entry.bindingIds == bindingIds)
+        return entry.module;
     }
     
-    return new DxvkShaderModule(vkd, m_stage, spirvCode);
+    // Patch the binding numbers in a copy of the code. The
+    // buffer is reused to avoid allocating memory every time.
+    static thread_local std::vector<uint32_t> s_code;
+    s_code.assign(m_code.data(), m_code.data() + m_code.size() / sizeof(uint32_t));
+    
+    for (uint32_t i = 0; i < m_bindingOffsets.size(); i++) {
+      if (m_bindingOffsets[i].setOffset != 0)
+        s_code[m_bindingOffsets[i].setOffset] = bindingIds[2 * i + 0];
+      s_code[m_bindingOffsets[i].offset] = bindingIds[2 * i + 1];
+    }
+    
+    ModuleEntry entry;
+    entry.bindingIds = std::move(bindingIds);
+    entry.module     = new DxvkShaderModule(vkd, m_stage,
+      s_code.size() * sizeof(uint32_t), s_code.data());
+    
+    m_modules.push_back(entry);
+    return entry.module;
   }
   
   
   void DxvkShader::dump(std::ostream&& outputStream) const {
+    this->wait();
     m_code.store(std::move(outputStream));
   }
   
   
   void DxvkShader::read(std::istream&& inputStream) {
+    this->wait();
     m_code = SpirvCodeBuffer(std::move(inputStream));
+    
+    this->findBindingOffsets();
+    
+    std::lock_guard<std::mutex> lock(m_moduleLock);
+    m_modules.clear();
+  }
+  
+  
+  void DxvkShader::findBindingOffsets() {
+    m_bindingOffsets.clear();
+    
+    const uint32_t* code = m_code.data();
+    const uint32_t  size = m_code.size() / sizeof(uint32_t);
+    
+    // Descriptor set decorations, indexed by target ID
+    std::unordered_map<uint32_t, uint32_t> setOffsets;
+    std::vector<uint32_t>                  bindingTargets;
+    
+    // Skip the header if there is one
+    uint32_t offset = size >= 5 && code[0] == spv::MagicNumber ? 5 : 0;
+    
+    while (offset < size) {
+      const uint32_t length = code[offset] >> spv::WordCountShift;
+      
+      if (length == 0 || offset + length > size)
+        break;
+      
+      if ((code[offset] & spv::OpCodeMask) == spv::OpDecorate && length >= 4) {
+        if (code[offset + 2] == spv::DecorationBinding) {
+          BindingOffset binding;
+          binding.slot      = code[offset + 3];
+          binding.offset    = offset + 3;
+          binding.setOffset = 0;
+          m_bindingOffsets.push_back(binding);
+          bindingTargets.push_back(code[offset + 1]);
+        }
+        
+        if (code[offset + 2] == spv::DecorationDescriptorSet)
+          setOffsets.insert({ code[offset + 1], offset + 3 });
+      }
+      
+      offset += length;
+    }
+    
+    for (uint32_t i = 0; i < m_bindingOffsets.size(); i++) {
+      auto setOffset = setOffsets.find(bindingTargets[i]);
+      
+      if (setOffset != setOffsets.end())
+        m_bindingOffsets[i].setOffset = setOffset->second;
+    }
   }
   
 }
\ No newline at end of file
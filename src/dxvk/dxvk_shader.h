@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <vector>
 
 #include "dxvk_include.h"
@@ -7,6 +10,8 @@
 
 #include "../spirv/spirv_code_buffer.h"
 
+#include "../util/sha1/sha1_util.h"
+
 namespace dxvk {
   
   /**
@@ -38,6 +43,12 @@ namespace dxvk {
             VkShaderStageFlagBits stage,
       const SpirvCodeBuffer&      code);
     
+    DxvkShaderModule(
+      const Rc<vk::DeviceFn>&     vkd,
+            VkShaderStageFlagBits stage,
+            size_t                codeSize,
+      const uint32_t*             code);
+    
     ~DxvkShaderModule();
     
     VkShaderModule handle() const {
@@ -62,6 +73,12 @@ namespace dxvk {
    * bindings that the shader uses. In order to use
    * the shader with a pipeline, a shader module
    * needs to be created from he shader object.
+   * 
+   * Shaders can also be created before their code is
+   * available, e.g. while they are being compiled on a
+   * worker thread. In that case, all methods that need
+   * the code or the resource slots will block until the
+   * shader has been completed.
    */
   class DxvkShader : public RcObject {
     
@@ -73,8 +90,67 @@ namespace dxvk {
       const DxvkResourceSlot*       slotInfos,
       const SpirvCodeBuffer&        code);
     
+    /**
+     * \brief Creates a pending shader
+     * 
+     * The code and resource slots must be
+     * provided later by calling \ref complete.
+     * \param [in] stage Shader stage
+     */
+    DxvkShader(
+            VkShaderStageFlagBits   stage);
+    
     ~DxvkShader();
     
+    /**
+     * \brief Completes a pending shader
+     * 
+     * Takes the code and resource slots from the given
+     * shader and wakes up all threads waiting for them.
+     * \param [in] shader The compiled shader, or
+     *        \c nullptr if compilation failed
+     */
+    void complete(
+      const Rc<DxvkShader>&         shader);
+    
+    /**
+     * \brief Waits for the shader to be completed
+     * 
+     * Returns immediately if the shader was not
+     * created as a pending shader, or if it has
+     * already been completed.
+     */
+    void wait() const;
+    
+    /**
+     * \brief Shader stage
+     * \returns Shader stage
+     */
+    VkShaderStageFlagBits stage() const {
+      return m_stage;
+    }
+    
+    /**
+     * \brief Resource slots used by the shader
+     * \returns Resource slot definitions
+     */
+    const std::vector<DxvkResourceSlot>& slots() const {
+      this->wait();
+      return m_slots;
+    }
+    
+    /**
+     * \brief SPIR-V code
+     * 
+     * Resource slot numbers in the code are not
+     * yet mapped to the actual binding numbers.
+     * \returns SPIR-V code buffer
+     */
+    const SpirvCodeBuffer& code() const {
+      this->wait();
+      return m_code;
+    }
+    
     /**
      * \brief Adds resource slots definitions to a mapping
      * 
@@ -88,7 +164,11 @@ namespace dxvk {
     /**
      * \brief Creates a shader module
      * 
-     * Maps the binding slot numbers 
+     * Maps the binding slot numbers to the binding IDs
+     * of the given mapping. Only the binding decorations
+     * recorded when the code was set are patched, and
+     * pipelines that map all slots used by the shader to
+     * the same bindings will share one shader module.
      * \param [in] vkd Vulkan device functions
      * \param [in] mapping Resource slot mapping
      * \returns The shader module
@@ -113,12 +193,69 @@ namespace dxvk {
      */
     void read(std::istream&& inputStream);
     
+    /**
+     * \brief Shader key
+     * 
+     * Identifies the shader across runs, e.g. by
+     * the hash of the source code it was compiled
+     * from. Shaders without a key will not be
+     * recorded in the pipeline state cache.
+     * \returns Shader key, or a null hash
+     */
+    const Sha1Hash& shaderKey() const {
+      return m_key;
+    }
+    
+    /**
+     * \brief Sets the shader key
+     * \param [in] key Shader key
+     */
+    void setShaderKey(const Sha1Hash& key) {
+      m_key = key;
+    }
+    
   private:
     
+    /**
+     * \brief Binding decoration
+     * 
+     * Word offsets of the binding number and the
+     * descriptor set index within the code, and
+     * the resource slot they refer to.
+     */
+    struct BindingOffset {
+      uint32_t slot;
+      uint32_t offset;
+      uint32_t setOffset;
+    };
+    
+    /**
+     * \brief Shader module for a set of bindings
+     * 
+     * Stores the descriptor set and binding
+     * index for each binding decoration.
+     */
+    struct ModuleEntry {
+      std::vector<uint32_t> bindingIds;
+      Rc<DxvkShaderModule>  module;
+    };
+    
     VkShaderStageFlagBits m_stage;
     SpirvCodeBuffer       m_code;
+    Sha1Hash              m_key;
     
     std::vector<DxvkResourceSlot> m_slots;
+    std::vector<BindingOffset>    m_bindingOffsets;
+    
+    mutable std::mutex               m_moduleLock;
+    mutable std::vector<ModuleEntry> m_modules;
+    
+    std::atomic<bool>               m_ready  = { true };
+    bool                            m_failed = false;
+    mutable std::mutex              m_readyLock;
+    mutable std::condition_variable m_readyCond;
+    
+    void findBindingOffsets();
     
   };
   
@@ -0,0 +1,320 @@
+#include <cstring>
+
+#include "dxvk_shadercache.h"
+
+namespace dxvk {
+  
+  DxvkShaderCache::DxvkShaderCache(
+    const std::string&      fileName,
+          uint32_t          compilerVersion) {
+    // Other devices in this process, or other processes,
+    // may use the same file at the same time. Appends are
+    // serialized with a file lock.
+    m_file = ::CreateFileA(fileName.c_str(),
+      GENERIC_READ | GENERIC_WRITE,
+      FILE_SHARE_READ | FILE_SHARE_WRITE,
+      nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    
+    if (m_file == INVALID_HANDLE_VALUE) {
+      Logger::warn(str::format("DxvkShaderCache: Failed to open ", fileName,
+        " (error ", ::GetLastError(), "), shader cache disabled"));
+      return;
+    }
+    
+    if (!this->lockFile()) {
+      Logger::warn(str::format("DxvkShaderCache: Failed to lock ", fileName,
+        ", shader cache disabled"));
+      return;
+    }
+    
+    m_fileSize = this->mapFile(this->getFileSize(), compilerVersion);
+    
+    // Start over if the file is empty or outdated. Truncating
+    // fails while another process has the file mapped, and the
+    // new header must not end up in front of stale entries.
+    if (m_fileSize == 0) {
+      const DxvkShaderCacheHeader header = getFileHeader(compilerVersion);
+      
+      if (!this->truncateFile(0)) {
+        Logger::warn(str::format("DxvkShaderCache: Failed to reset ", fileName,
+          " (error ", ::GetLastError(), "), shader cache disabled"));
+      } else if (this->writeFile(0, &header, sizeof(header))) {
+        m_fileSize = sizeof(header);
+      }
+    }
+    
+    this->unlockFile();
+    
+    Logger::info(str::format("DxvkShaderCache: Found ", m_index.size(), " shaders in ", fileName));
+  }
+  
+  
+  DxvkShaderCache::~DxvkShaderCache() {
+    this->unmapFile();
+    
+    if (m_file != INVALID_HANDLE_VALUE)
+      ::CloseHandle(m_file);
+  }
+  
+  
+  Rc<DxvkShader> DxvkShaderCache::lookup(
+    const Sha1Hash&         key) const {
+    auto pair = m_index.find(key);
+    
+    if (pair == m_index.end())
+      return nullptr;
+    
+    const char* data = m_mapPtr + pair->second;
+    
+    DxvkShaderCacheEntry entry;
+    std::memcpy(&entry, data, sizeof(entry));
+    
+    auto slots = reinterpret_cast<const DxvkResourceSlot*>(
+      data + sizeof(entry));
+    auto code  = reinterpret_cast<const uint32_t*>(
+      data + sizeof(entry) + entry.slotCount * sizeof(DxvkResourceSlot));
+    
+    return new DxvkShader(
+      VkShaderStageFlagBits(entry.stage),
+      entry.slotCount, slots,
+      SpirvCodeBuffer(entry.codeSize / sizeof(uint32_t), code));
+  }
+  
+  
+  void DxvkShaderCache::store(
+    const Sha1Hash&         key,
+    const Rc<DxvkShader>&   shader) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    if (m_fileSize == 0
+     || m_index.find(key) != m_index.end()
+     || !m_stored.insert(key).second)
+      return;
+    
+    const std::vector<DxvkResourceSlot>& slots = shader->slots();
+    const SpirvCodeBuffer&               code  = shader->code();
+    
+    DxvkShaderCacheEntry entry;
+    std::memcpy(entry.magic, "SHDR", 4);
+    entry.key       = key.digest();
+    entry.stage     = shader->stage();
+    entry.slotCount = slots.size();
+    entry.codeSize  = code.size();
+    
+    // Write the entry in one go so that a crash cannot
+    // leave a complete header with incomplete data behind
+    std::vector<char> data(sizeof(entry)
+      + slots.size() * sizeof(DxvkResourceSlot)
+      + code.size());
+    
+    char* dst = data.data();
+    std::memcpy(dst, &entry, sizeof(entry));
+    dst += sizeof(entry);
+    std::memcpy(dst, slots.data(), slots.size() * sizeof(DxvkResourceSlot));
+    dst += slots.size() * sizeof(DxvkResourceSlot);
+    std::memcpy(dst, code.data(), code.size());
+    
+    // Entries may have been appended by other users of the
+    // file, and a crash may have left an incomplete entry
+    // at the end. Write right after the last valid entry.
+    if (!this->lockFile())
+      return;
+    
+    const uint64_t offset = this->findFileEnd(
+      m_fileSize, this->getFileSize());
+    
+    if (this->writeFile(offset, data.data(), data.size()))
+      m_fileSize = offset + data.size();
+    
+    this->unlockFile();
+  }
+  
+  
+  size_t DxvkShaderCache::mapFile(
+          uint64_t          fileSize,
+          uint32_t          compilerVersion) {
+    if (fileSize < sizeof(DxvkShaderCacheHeader))
+      return 0;
+    
+    m_mapping = ::CreateFileMappingA(m_file,
+      nullptr, PAGE_READONLY, 0, 0, nullptr);
+    
+    if (m_mapping != nullptr) {
+      m_mapPtr = reinterpret_cast<const char*>(
+        ::MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    
+    const DxvkShaderCacheHeader header = getFileHeader(compilerVersion);
+    
+    if (m_mapPtr == nullptr
+     || std::memcmp(m_mapPtr, &header, sizeof(header)) != 0) {
+      this->unmapFile();
+      return 0;
+    }
+    
+    // Build the index from the entry headers. Reading stops at
+    // the first incomplete or invalid entry, which will then be
+    // overwritten by the next entry that gets appended.
+    size_t offset = sizeof(header);
+    
+    while (offset + sizeof(DxvkShaderCacheEntry) <= fileSize) {
+      DxvkShaderCacheEntry entry;
+      std::memcpy(&entry, m_mapPtr + offset, sizeof(entry));
+      
+      const uint64_t entrySize = getEntrySize(entry);
+      
+      if (entrySize == 0 || offset + entrySize > fileSize)
+        break;
+      
+      m_index.insert({ Sha1Hash(entry.key), offset });
+      offset += entrySize;
+    }
+    
+    return offset;
+  }
+  
+  
+  void DxvkShaderCache::unmapFile() {
+    if (m_mapPtr != nullptr)
+      ::UnmapViewOfFile(m_mapPtr);
+    
+    if (m_mapping != nullptr)
+      ::CloseHandle(m_mapping);
+    
+    m_mapPtr  = nullptr;
+    m_mapping = nullptr;
+    m_index.clear();
+  }
+  
+  
+  bool DxvkShaderCache::writeFile(
+          uint64_t          offset,
+    const void*             data,
+          size_t            size) {
+    LARGE_INTEGER position;
+    position.QuadPart = offset;
+    
+    DWORD written = 0;
+    
+    if (!::SetFilePointerEx(m_file, position, nullptr, FILE_BEGIN)
+     || !::WriteFile(m_file, data, size, &written, nullptr)
+     || written != size) {
+      Logger::warn("DxvkShaderCache: Failed to write shader cache");
+      return false;
+    }
+    
+    return true;
+  }
+  
+  
+  bool DxvkShaderCache::readFile(
+          uint64_t          offset,
+          void*             data,
+          size_t            size) {
+    LARGE_INTEGER position;
+    position.QuadPart = offset;
+    
+    DWORD read = 0;
+    
+    return ::SetFilePointerEx(m_file, position, nullptr, FILE_BEGIN)
+        && ::ReadFile(m_file, data, size, &read, nullptr)
+        && read == size;
+  }
+  
+  
+  bool DxvkShaderCache::truncateFile(
+          uint64_t          size) {
+    LARGE_INTEGER position;
+    position.QuadPart = size;
+    
+    return ::SetFilePointerEx(m_file, position, nullptr, FILE_BEGIN)
+        && ::SetEndOfFile(m_file);
+  }
+  
+  
+  uint64_t DxvkShaderCache::findFileEnd(
+          uint64_t          offset,
+          uint64_t          fileSize) {
+    // Skip entries appended by other users of the file
+    // since the last write. These are not mapped, so
+    // the entry headers have to be read explicitly.
+    while (offset + sizeof(DxvkShaderCacheEntry) <= fileSize) {
+      DxvkShaderCacheEntry entry;
+      
+      if (!this->readFile(offset, &entry, sizeof(entry)))
+        break;
+      
+      const uint64_t entrySize = getEntrySize(entry);
+      
+      if (entrySize == 0 || offset + entrySize > fileSize)
+        break;
+      
+      offset += entrySize;
+    }
+    
+    // Drop an incomplete entry left behind by a crash, so
+    // that all entries written afterwards can be found. If
+    // the file is mapped by another process, truncating it
+    // fails, and the entry is merely overwritten instead.
+    if (offset < fileSize)
+      this->truncateFile(offset);
+    
+    return offset;
+  }
+  
+  
+  uint64_t DxvkShaderCache::getFileSize() const {
+    LARGE_INTEGER fileSize;
+    
+    if (!::GetFileSizeEx(m_file, &fileSize))
+      return 0;
+    
+    return fileSize.QuadPart;
+  }
+  
+  
+  bool DxvkShaderCache::lockFile() {
+    // Lock a single byte far beyond the end of the file
+    // rather than the file contents, since locked regions
+    // could not be read through other processes' mappings.
+    OVERLAPPED overlapped = { };
+    overlapped.Offset     = 0xFFFFFFFFu;
+    overlapped.OffsetHigh = 0x7FFFFFFFu;
+    
+    return ::LockFileEx(m_file, LOCKFILE_EXCLUSIVE_LOCK,
+      0, 1, 0, &overlapped);
+  }
+  
+  
+  void DxvkShaderCache::unlockFile() {
+    OVERLAPPED overlapped = { };
+    overlapped.Offset     = 0xFFFFFFFFu;
+    overlapped.OffsetHigh = 0x7FFFFFFFu;
+    
+    ::UnlockFileEx(m_file, 0, 1, 0, &overlapped);
+  }
+  
+  
+  uint64_t DxvkShaderCache::getEntrySize(
+    const DxvkShaderCacheEntry& entry) {
+    if (std::memcmp(entry.magic, "SHDR", 4) != 0
+     || entry.slotCount > MaxSlotCount
+     || entry.codeSize % sizeof(uint32_t) != 0)
+      return 0;
+    
+    return sizeof(entry)
+      + uint64_t(entry.slotCount) * sizeof(DxvkResourceSlot)
+      + uint64_t(entry.codeSize);
+  }
+  
+  
+  DxvkShaderCacheHeader DxvkShaderCache::getFileHeader(
+          uint32_t          compilerVersion) {
+    DxvkShaderCacheHeader header;
+    std::memcpy(header.magic, "DXVK", 4);
+    header.version         = FileVersion;
+    header.compilerVersion = compilerVersion;
+    return header;
+  }
+  
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "dxvk_hash.h"
+#include "dxvk_shader.h"
+
+namespace dxvk {
+  
+  /**
+   * \brief Shader cache file header
+   */
+  struct DxvkShaderCacheHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t compilerVersion;
+  };
+  
+  
+  /**
+   * \brief Shader cache entry header
+   * 
+   * Precedes the data of each cached shader. The
+   * resource slot definitions and the SPIR-V code
+   * are stored directly after the header.
+   */
+  struct DxvkShaderCacheEntry {
+    char       magic[4];
+    Sha1Digest key;
+    uint32_t   stage;
+    uint32_t   slotCount;
+    uint32_t   codeSize;
+  };
+  
+  
+  /**
+   * \brief Shader cache
+   * 
+   * Persistent cache for compiled shaders, identified by
+   * the hash of the source code they were compiled from.
+   * The cache file is mapped into memory on creation, and
+   * an index of all entries is built from the entry headers.
+   * Shaders that are compiled while the application runs
+   * are appended to the file, but will only be found by
+   * lookups in future runs. The file can be shared with
+   * other devices and processes, appends are serialized
+   * using a file lock.
+   * 
+   * If the compiler version of the cache file does not
+   * match the current version, the file is discarded. If
+   * another process still has it mapped, the cache is
+   * disabled instead.
+   */
+  class DxvkShaderCache : public RcObject {
+    constexpr static uint32_t FileVersion   = 1;
+    constexpr static uint32_t MaxSlotCount  = 1024;
+  public:
+    
+    DxvkShaderCache(
+      const std::string&      fileName,
+            uint32_t          compilerVersion);
+    ~DxvkShaderCache();
+    
+    /**
+     * \brief Looks up a shader
+     * 
+     * Creates a shader object from the cached
+     * data if the shader is in the cache.
+     * \param [in] key Shader key
+     * \returns The shader, or \c nullptr
+     */
+    Rc<DxvkShader> lookup(
+      const Sha1Hash&         key) const;
+    
+    /**
+     * \brief Adds a shader to the cache
+     * 
+     * Appends the shader to the cache file
+     * unless it is already stored in it.
+     * \param [in] key Shader key
+     * \param [in] shader The compiled shader
+     */
+    void store(
+      const Sha1Hash&         key,
+      const Rc<DxvkShader>&   shader);
+    
+  private:
+    
+    HANDLE      m_file    = INVALID_HANDLE_VALUE;
+    HANDLE      m_mapping = nullptr;
+    const char* m_mapPtr  = nullptr;
+    
+    std::unordered_map<Sha1Hash, size_t, DxvkHash> m_index;
+    
+    std::mutex                              m_mutex;
+    std::unordered_set<Sha1Hash, DxvkHash>  m_stored;
+    uint64_t                                m_fileSize = 0;
+    
+    size_t mapFile(
+            uint64_t          fileSize,
+            uint32_t          compilerVersion);
+    
+    void unmapFile();
+    
+    bool writeFile(
+            uint64_t          offset,
+      const void*             data,
+            size_t            size);
+    
+    bool readFile(
+            uint64_t          offset,
+            void*             data,
+            size_t            size);
+    
+    bool truncateFile(
+            uint64_t          size);
+    
+    uint64_t findFileEnd(
+            uint64_t          offset,
+            uint64_t          fileSize);
+    
+    uint64_t getFileSize() const;
+    
+    bool lockFile();
+    
+    void unlockFile();
+    
+    static uint64_t getEntrySize(
+      const DxvkShaderCacheEntry& entry);
+    
+    static DxvkShaderCacheHeader getFileHeader(
+            uint32_t          compilerVersion);
+    
+  };
+  
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "dxvk_shadercompiler.h"
+
+namespace dxvk {
+  
+  DxvkShaderCompiler::DxvkShaderCompiler(uint32_t workerCount) {
+    for (uint32_t i = 0; i < workerCount; i++)
+      m_workers.emplace_back([this] () { runWorker(); });
+  }
+  
+  
+  DxvkShaderCompiler::~DxvkShaderCompiler() {
+    { std::unique_lock<std::mutex> lock(m_queueLock);
+      m_stopped.store(true);
+    }
+    
+    m_queueCond.notify_all();
+    
+    for (auto& worker : m_workers)
+      worker.join();
+    
+    // Shaders may still be referenced by the application,
+    // so pending ones must not be left in a waiting state
+    while (!m_queue.empty()) {
+      m_queue.front().shader->complete(nullptr);
+      m_queue.pop();
+    }
+    
+    const DxvkShaderCompilerStats stats = this->stats();
+    
+    if (stats.numCompiled != 0 && stats.busyTimeUs != 0) {
+      Logger::info(str::format("DxvkShaderCompiler: Compiled ",
+        stats.numCompiled, " shaders (", stats.numDwords, " DWORDs): ",
+        stats.numCompiled * 1000000 / stats.busyTimeUs, " shaders/s, ",
+        stats.numDwords   * 1000000 / stats.busyTimeUs, " DWORDs/s"));
+    }
+  }
+  
+  
+  void DxvkShaderCompiler::queueCompilation(
+    const Rc<DxvkShader>&         shader,
+          uint32_t                dwordCount,
+          CompileFn&&             compileFn) {
+    ShaderEntry entry = { shader, dwordCount, std::move(compileFn) };
+    
+    { std::unique_lock<std::mutex> lock(m_queueLock);
+      
+      if (m_numActive++ == 0)
+        m_busyStart = Clock::now();
+      
+      if (!m_workers.empty())
+        m_queue.push(std::move(entry));
+    }
+    
+    if (!m_workers.empty())
+      m_queueCond.notify_one();
+    else
+      this->compileShader(entry);
+  }
+  
+  
+  DxvkShaderCompilerStats DxvkShaderCompiler::stats() const {
+    std::unique_lock<std::mutex> lock(m_queueLock);
+    
+    DxvkShaderCompilerStats result;
+    result.queueDepth  = m_queue.size();
+    result.numCompiled = m_numCompiled.load();
+    result.numDwords   = m_numDwords.load();
+    result.busyTimeUs  = m_busyTimeUs;
+    
+    if (m_numActive != 0) {
+      result.busyTimeUs += std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - m_busyStart).count();
+    }
+    
+    return result;
+  }
+  
+  
+  void DxvkShaderCompiler::compileShader(
+          ShaderEntry&            entry) {
+    Rc<DxvkShader> shader;
+    
+    // Exceptions must not escape the worker thread, since
+    // that would terminate the process. The shader simply
+    // fails to compile instead.
+    try {
+      shader = entry.compileFn();
+    } catch (const DxvkError& e) {
+      Logger::err(e.message());
+    } catch (const std::exception& e) {
+      Logger::err(str::format("DxvkShaderCompiler: ", e.what()));
+    }
+    
+    entry.shader->complete(shader);
+    
+    m_numCompiled += 1;
+    m_numDwords   += entry.dwordCount;
+    
+    std::unique_lock<std::mutex> lock(m_queueLock);
+    
+    if (--m_numActive == 0) {
+      m_busyTimeUs += std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - m_busyStart).count();
+    }
+  }
+  
+  
+  void DxvkShaderCompiler::runWorker() {
+    while (!m_stopped.load()) {
+      ShaderEntry entry;
+      
+      { std::unique_lock<std::mutex> lock(m_queueLock);
+        
+        m_queueCond.wait(lock, [this] {
+          return m_stopped.load() || !m_queue.empty();
+        });
+        
+        if (m_stopped.load())
+          return;
+        
+        entry = std::move(m_queue.front());
+        m_queue.pop();
+      }
+      
+      this->compileShader(entry);
+    }
+  }
+  
+}
\ No newline at end of file
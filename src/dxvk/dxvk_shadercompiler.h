@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "dxvk_shader.h"
+
+namespace dxvk {
+  
+  /**
+   * \brief Shader compiler statistics
+   */
+  struct DxvkShaderCompilerStats {
+    uint32_t queueDepth;      ///< Number of queued shaders
+    uint64_t numCompiled;     ///< Number of compiled shaders
+    uint64_t numDwords;       ///< Size of the compiled source code
+    uint64_t busyTimeUs;      ///< Time spent with non-empty queue
+  };
+  
+  
+  /**
+   * \brief Shader compiler
+   * 
+   * Runs shader compile jobs provided by the front end
+   * on a pool of worker threads. Each job completes a
+   * pending shader object, so that the shader can be
+   * handed out to the application immediately and
+   * will only be waited on when creating a pipeline.
+   * 
+   * Throughput is measured over the time during which
+   * at least one shader is queued or being compiled,
+   * so that the numbers reflect the parallel speedup.
+   */
+  class DxvkShaderCompiler : public RcObject {
+    using Clock     = std::chrono::high_resolution_clock;
+    using TimePoint = typename Clock::time_point;
+  public:
+    
+    using CompileFn = std::function<Rc<DxvkShader>()>;
+    
+    DxvkShaderCompiler(uint32_t workerCount);
+    ~DxvkShaderCompiler();
+    
+    /**
+     * \brief Queues a shader for compilation
+     * 
+     * If the compiler does not have any worker
+     * threads, the shader is compiled immediately.
+     * \param [in] shader The pending shader
+     * \param [in] dwordCount Source code size
+     * \param [in] compileFn Compiles the shader
+     */
+    void queueCompilation(
+      const Rc<DxvkShader>&         shader,
+            uint32_t                dwordCount,
+            CompileFn&&             compileFn);
+    
+    /**
+     * \brief Retrieves compiler statistics
+     * \returns Compiler statistics
+     */
+    DxvkShaderCompilerStats stats() const;
+    
+  private:
+    
+    struct ShaderEntry {
+      Rc<DxvkShader> shader;
+      uint32_t       dwordCount;
+      CompileFn      compileFn;
+    };
+    
+    std::atomic<bool>     m_stopped     = { false };
+    std::atomic<uint64_t> m_numCompiled = { 0ull };
+    std::atomic<uint64_t> m_numDwords   = { 0ull };
+    
+    mutable std::mutex        m_queueLock;
+    std::condition_variable   m_queueCond;
+    std::queue<ShaderEntry>   m_queue;
+    std::vector<std::thread>  m_workers;
+    
+    uint32_t  m_numActive  = 0;
+    uint64_t  m_busyTimeUs = 0;
+    TimePoint m_busyStart;
+    
+    void compileShader(
+            ShaderEntry&            entry);
+    
+    void runWorker();
+    
+  };
+  
+}
\ No newline at end of file
@@ -1,90 +1,228 @@
+#include <numeric>
+
 #include "dxvk_device.h"
 #include "dxvk_staging.h"
 
 namespace dxvk {
   
-  DxvkStagingBuffer::DxvkStagingBuffer(
+  DxvkStagingRingBuffer::DxvkStagingRingBuffer(
     const Rc<DxvkBuffer>& buffer)
-  : m_buffer(buffer), m_bufferSize(buffer->info().size){
+  : m_buffer(buffer), m_size(buffer->info().size) {
     
   }
   
   
-  DxvkStagingBuffer::~DxvkStagingBuffer() {
+  DxvkStagingRingBuffer::~DxvkStagingRingBuffer() {
     
   }
   
   
-  VkDeviceSize DxvkStagingBuffer::size() const {
-    return m_bufferSize;
-  }
-  
-  
-  VkDeviceSize DxvkStagingBuffer::freeBytes() const {
-    return m_bufferSize - m_bufferOffset;
+  VkDeviceSize DxvkStagingRingBuffer::usedBytes() const {
+    if (m_ranges.empty())
+      return 0;
+    
+    return m_head > m_tail
+      ? m_head - m_tail
+      : m_head + m_size - m_tail;
   }
   
   
-  bool DxvkStagingBuffer::alloc(
+  bool DxvkStagingRingBuffer::alloc(
           VkDeviceSize            size,
-          DxvkStagingBufferSlice& slice) {
-    if (m_bufferOffset + size > m_bufferSize)
-      return false;
+          VkDeviceSize            align,
+          DxvkStagingBufferSlice& slice,
+          uint64_t&               id) {
+    // The head and tail pointers are equal both if the
+    // ring is empty and if it is full, so we need to
+    // check whether there are any allocations in use.
+    VkDeviceSize offset = ((m_head + align - 1) / align) * align;
+    
+    if (m_ranges.empty() || m_head > m_tail) {
+      // The free range is [head, size) followed by [0, tail),
+      // so wrap around if the slice doesn't fit at the end.
+      if (offset + size > m_size) {
+        offset = 0;
+        
+        if (size > (m_ranges.empty() ? m_size : m_tail))
+          return false;
+      }
+    } else {
+      // The free range is [head, tail)
+      if (offset + size > m_tail)
+        return false;
+    }
     
     slice.buffer = m_buffer->handle();
-    slice.offset = m_bufferOffset;
-    slice.mapPtr = m_buffer->mapPtr(m_bufferOffset);
+    slice.offset = offset;
+    slice.mapPtr = m_buffer->mapPtr(offset);
     
-    m_bufferOffset += size;
+    id = m_firstId + m_ranges.size();
+    
+    m_head = offset + size;
+    m_ranges.push_back({ m_head, false });
     return true;
   }
   
   
-  void DxvkStagingBuffer::reset() {
-    m_bufferOffset = 0;
+  void DxvkStagingRingBuffer::free(
+          uint64_t                id) {
+    m_ranges.at(id - m_firstId).freed = true;
+    
+    // Advance the tail past all ranges that were
+    // released, including any padding before them.
+    while (!m_ranges.empty() && m_ranges.front().freed) {
+      m_tail = m_ranges.front().end;
+      m_ranges.pop_front();
+      m_firstId += 1;
+    }
+    
+    if (m_ranges.empty()) {
+      m_head = 0;
+      m_tail = 0;
+    }
   }
   
   
-  DxvkStagingAlloc::DxvkStagingAlloc(DxvkDevice* device)
-  : m_device(device) { }
+  DxvkStagingRing::DxvkStagingRing(DxvkDevice* device)
+  : m_device(device) {
+    
+  }
   
   
-  DxvkStagingAlloc::~DxvkStagingAlloc() {
-    this->reset();
+  DxvkStagingRing::~DxvkStagingRing() {
+    
   }
   
   
-  DxvkStagingBufferSlice DxvkStagingAlloc::alloc(VkDeviceSize size) {
-    Rc<DxvkStagingBuffer> selectedBuffer;
+  DxvkStagingBufferSlice DxvkStagingRing::alloc(
+          VkDeviceSize      size,
+          VkDeviceSize      align,
+          DxvkStagingRange& range) {
+    std::lock_guard<std::mutex> lock(m_mutex);
     
-    // Try a worst-fit allocation strategy on the existing staging
-    // buffers first. This should keep the amount of wasted space
-    // small, especially if there are large allocations.
-    for (const auto& buf : m_stagingBuffers) {
-      if (selectedBuffer == nullptr || (buf->freeBytes() > selectedBuffer->freeBytes()))
-        selectedBuffer = buf;
-    }
+    // Slice offsets must be a multiple of both the requested
+    // alignment, e.g. the texel size for buffer-image copies,
+    // and the minimum alignment required for buffer copies.
+    align = std::lcm(std::max<VkDeviceSize>(align, 1), MinSliceAlignment);
     
-    // If we have no suitable buffer, allocate one from the device
-    // that is *at least* as large as the amount of data we need
-    // to upload. Usually it will be bigger.
     DxvkStagingBufferSlice slice;
     
-    if ((selectedBuffer == nullptr) || (!selectedBuffer->alloc(size, slice))) {
-      selectedBuffer = m_device->allocStagingBuffer(size);
-      selectedBuffer->alloc(size, slice);
-      m_stagingBuffers.push_back(selectedBuffer);
+    // The ring buffer is created on first use, since the
+    // staging ring gets created along with the device
+    if (m_ring == nullptr)
+      m_ring = this->createRingBuffer(MinRingSize);
+    
+    // Allocations that are too large for any ring buffer
+    // get a dedicated buffer which is freed after use.
+    if (size > MaxRingSize) {
+      range.buffer = this->createRingBuffer(size);
+      range.buffer->alloc(size, align, slice, range.id);
+      return slice;
+    }
+    
+    if (!m_ring->alloc(size, align, slice, range.id)) {
+      // Replace the ring buffer by a larger one. The old
+      // buffer stays alive until all its slices are freed.
+      VkDeviceSize ringSize = std::max(size,
+        std::min(2 * m_ring->size(), MaxRingSize));
+      
+      m_ring      = this->createRingBuffer(ringSize);
+      m_highWater = 0;
+      m_idleCount = 0;
+      m_ring->alloc(size, align, slice, range.id);
+    }
+    
+    range.buffer = m_ring;
+    
+    m_highWater      = std::max(m_highWater,      m_ring->usedBytes());
+    m_highWaterTotal = std::max(m_highWaterTotal, m_ring->usedBytes());
+    return slice;
+  }
+  
+  
+  void DxvkStagingRing::free(
+    const DxvkStagingRange& range) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    range.buffer->free(range.id);
+    
+    // Periodically check whether the ring can be shrunk while
+    // it is idle. This is the case if less than a quarter of
+    // it has been used since the last time we checked.
+    if (range.buffer == m_ring && m_ring->isIdle()
+     && ++m_idleCount >= ShrinkInterval) {
+      if (m_ring->size() > MinRingSize && m_highWater < m_ring->size() / 4)
+        m_ring = this->createRingBuffer(m_ring->size() / 2);
+      
+      m_highWater = 0;
+      m_idleCount = 0;
+    }
+  }
+  
+  
+  DxvkStagingRingStats DxvkStagingRing::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    DxvkStagingRingStats result;
+    result.ringSize  = m_ring != nullptr ? m_ring->size() : 0;
+    result.highWater = m_highWaterTotal;
+    return result;
+  }
+  
+  
+  Rc<DxvkStagingRingBuffer> DxvkStagingRing::createRingBuffer(
+          VkDeviceSize      size) {
+    // Staging buffers only need to be able to handle transfer
+    // operations, and they need to be in host-visible memory.
+    DxvkBufferCreateInfo info;
+    info.size   = size;
+    info.usage  = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    info.stages = VK_PIPELINE_STAGE_TRANSFER_BIT
+                | VK_PIPELINE_STAGE_HOST_BIT;
+    info.access = VK_ACCESS_TRANSFER_READ_BIT
+                | VK_ACCESS_HOST_WRITE_BIT;
+    
+    // Slices are read by both the graphics queue and the
+    // transfer queue without any ownership transfers
+    if (m_device->hasTransferQueue()) {
+      info.queueFamilies = {
+        m_device->adapter()->graphicsQueueFamily(),
+        m_device->adapter()->transferQueueFamily() };
     }
     
+    VkMemoryPropertyFlags memFlags
+      = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+      | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    
+    return new DxvkStagingRingBuffer(
+      m_device->createBuffer(info, memFlags));
+  }
+  
+  
+  DxvkStagingAlloc::DxvkStagingAlloc(DxvkDevice* device)
+  : m_ring(device->stagingRing()) { }
+  
+  
+  DxvkStagingAlloc::~DxvkStagingAlloc() {
+    this->reset();
+  }
+  
+  
+  DxvkStagingBufferSlice DxvkStagingAlloc::alloc(
+          VkDeviceSize      size,
+          VkDeviceSize      align) {
+    DxvkStagingRange range;
+    DxvkStagingBufferSlice slice = m_ring->alloc(size, align, range);
+    
+    m_ranges.push_back(std::move(range));
     return slice;
   }
   
   
   void DxvkStagingAlloc::reset() {
-    for (const auto& buf : m_stagingBuffers)
-      m_device->recycleStagingBuffer(buf);
+    for (const auto& range : m_ranges)
+      m_ring->free(range);
     
-    m_stagingBuffers.resize(0);
+    m_ranges.resize(0);
   }
   
 }
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <deque>
+
 #include "dxvk_buffer.h"
 
 namespace dxvk {
   
   class DxvkDevice;
+  class DxvkStagingRingBuffer;
   
   /**
    * \brief Staging buffer slice
@@ -20,60 +23,178 @@ namespace dxvk {
   
   
   /**
-   * \brief Staging uffer
+   * \brief Staging ring range
+   * 
+   * Identifies an allocation made from the staging
+   * ring, so that it can be returned once the GPU
+   * has finished reading from it.
+   */
+  struct DxvkStagingRange {
+    Rc<DxvkStagingRingBuffer> buffer;
+    uint64_t                  id = 0;
+  };
+  
+  
+  /**
+   * \brief Staging ring statistics
+   */
+  struct DxvkStagingRingStats {
+    VkDeviceSize ringSize  = 0; ///< Size of the current ring buffer
+    VkDeviceSize highWater = 0; ///< Max. number of bytes in use
+  };
+  
+  
+  /**
+   * \brief Staging ring buffer
    * 
-   * A mapped buffer that can be used for fast data
-   * transfer operations from the host to the GPU.
-   * Implements a linear sub-allocator for staging
-   * buffer slices.
+   * A mapped buffer from which slices are allocated
+   * linearly. Slices are released in any order, but
+   * memory is only reclaimed in allocation order, by
+   * advancing the tail of the ring past the oldest
+   * allocation that has been released.
    */
-  class DxvkStagingBuffer : public RcObject {
+  class DxvkStagingRingBuffer : public RcObject {
     
   public:
     
-    DxvkStagingBuffer(
+    DxvkStagingRingBuffer(
       const Rc<DxvkBuffer>& buffer);
-    ~DxvkStagingBuffer();
+    ~DxvkStagingRingBuffer();
     
     /**
      * \brief Buffer size, in bytes
      * \returns Buffer size, in bytes
      */
-    VkDeviceSize size() const;
+    VkDeviceSize size() const {
+      return m_size;
+    }
     
     /**
-     * \brief Number of bytes still available
-     * \returns Number of bytes still available
+     * \brief Number of bytes in use
+     * 
+     * Includes padding that was skipped for
+     * alignment or when wrapping around.
+     * \returns Number of bytes in use
      */
-    VkDeviceSize freeBytes() const;
+    VkDeviceSize usedBytes() const;
+    
+    /**
+     * \brief Checks whether the buffer is idle
+     * \returns \c true if no slices are in use
+     */
+    bool isIdle() const {
+      return m_ranges.empty();
+    }
     
     /**
      * \brief Allocates a staging buffer slice
      * 
-     * This may fail if the amount of data requested is
-     * larger than the amount of data still available.
+     * This may fail if there is no contiguous
+     * free range that can hold the slice.
      * \param [in] size Requested allocation size
+     * \param [in] align Required slice alignment
      * \param [out] slice Allocated staging buffer slice
+     * \param [out] id Allocation ID
      * \returns \c true on success, \c false on failure
      */
     bool alloc(
             VkDeviceSize            size,
-            DxvkStagingBufferSlice& slice);
+            VkDeviceSize            align,
+            DxvkStagingBufferSlice& slice,
+            uint64_t&               id);
     
     /**
-     * \brief Resets staging buffer
+     * \brief Releases a slice
+     * \param [in] id Allocation ID
+     */
+    void free(
+            uint64_t                id);
+    
+  private:
+    
+    struct Range {
+      VkDeviceSize end;
+      bool         freed;
+    };
+    
+    Rc<DxvkBuffer>    m_buffer;
+    VkDeviceSize      m_size;
+    
+    VkDeviceSize      m_head = 0;
+    VkDeviceSize      m_tail = 0;
+    
+    uint64_t          m_firstId = 0;
+    std::deque<Range> m_ranges;
+    
+  };
+  
+  
+  /**
+   * \brief Staging ring
+   * 
+   * Device-wide, persistently mapped staging memory.
+   * Command lists allocate slices from the current
+   * ring buffer and release them once the submission
+   * has completed. If the ring runs out of space, a
+   * larger ring buffer replaces it, and if the ring
+   * remains mostly unused over a number of idle
+   * periods, it will be replaced by a smaller one.
+   */
+  class DxvkStagingRing : public RcObject {
+    constexpr static VkDeviceSize MinRingSize       =  16 * 1024 * 1024;
+    constexpr static VkDeviceSize MaxRingSize       = 256 * 1024 * 1024;
+    constexpr static VkDeviceSize MinSliceAlignment = 16;
+    constexpr static uint32_t     ShrinkInterval    = 64;
+  public:
+    
+    DxvkStagingRing(DxvkDevice* device);
+    ~DxvkStagingRing();
+    
+    /**
+     * \brief Allocates a staging buffer slice
      * 
-     * Resets the allocator and thus frees
-     * all slices allocated from the buffer.
+     * The slice offset will be a multiple of the
+     * given alignment, which does not need to be
+     * a power of two. This method should not fail.
+     * \param [in] size Required amount of memory
+     * \param [in] align Required slice alignment
+     * \param [out] range Range to release later
+     * \returns Allocated staging buffer slice
      */
-    void reset();
+    DxvkStagingBufferSlice alloc(
+            VkDeviceSize      size,
+            VkDeviceSize      align,
+            DxvkStagingRange& range);
+    
+    /**
+     * \brief Releases a staging buffer slice
+     * 
+     * Must only be called once the GPU has
+     * finished reading from the slice.
+     * \param [in] range The range to release
+     */
+    void free(
+      const DxvkStagingRange& range);
+    
+    /**
+     * \brief Queries ring statistics
+     * \returns Current ring size and high-water mark
+     */
+    DxvkStagingRingStats stats();
     
   private:
     
-    Rc<DxvkBuffer> m_buffer;
+    DxvkDevice* const m_device;
     
-    VkDeviceSize m_bufferSize   = 0;
-    VkDeviceSize m_bufferOffset = 0;
+    std::mutex                m_mutex;
+    Rc<DxvkStagingRingBuffer> m_ring;
+    
+    VkDeviceSize m_highWater      = 0;
+    VkDeviceSize m_highWaterTotal = 0;
+    uint32_t     m_idleCount      = 0;
+    
+    Rc<DxvkStagingRingBuffer> createRingBuffer(
+            VkDeviceSize      size);
     
   };
   
@@ -81,8 +202,10 @@ namespace dxvk {
   /**
    * \brief Staging buffer allocator
    * 
-   * Convenient allocator for staging buffer slices
-   * which creates new staging buffers on demand.
+   * Allocates staging buffer slices from the device's
+   * staging ring on behalf of a command list, and keeps
+   * track of them so that they can be released once
+   * the command list has completed execution.
    */
   class DxvkStagingAlloc {
     
@@ -94,28 +217,26 @@ namespace dxvk {
     /**
      * \brief Allocates a staging buffer slice
      * 
-     * This \e may create a new staging buffer
-     * if needed. This method should not fail.
      * \param [in] size Required amount of memory
+     * \param [in] align Required slice alignment
      * \returns Allocated staging buffer slice
      */
     DxvkStagingBufferSlice alloc(
-            VkDeviceSize      size);
+            VkDeviceSize      size,
+            VkDeviceSize      align);
     
     /**
      * \brief Resets staging buffer allocator
      * 
-     * Returns all buffers to the device so that
-     * they can be recycled. Buffers must not be
-     * in use when this is called.
+     * Returns all slices to the staging ring. The
+     * slices must not be in use when this is called.
      */
     void reset();
     
   private:
     
-    DxvkDevice* const m_device;
-    
-    std::vector<Rc<DxvkStagingBuffer>> m_stagingBuffers;
+    Rc<DxvkStagingRing>           m_ring;
+    std::vector<DxvkStagingRange> m_ranges;
     
   };
   
@@ -0,0 +1,485 @@
+#include <cstring>
+#include <sstream>
+
+#include "dxvk_pipecache.h"
+#include "dxvk_statecache.h"
+
+namespace dxvk {
+  
+  DxvkStateCacheKey::DxvkStateCacheKey(
+    const DxvkStateCacheEntry& entry)
+  : m_shaders (entry.shaders),
+    m_format  (entry.format),
+    m_state   (entry.state) { }
+  
+  
+  size_t DxvkStateCacheKey::hash() const {
+    DxvkHashState state;
+    
+    for (const auto& shader : m_shaders)
+      state.add(shader.hash());
+    
+    state.add(m_format.hash());
+    state.add(m_state.hash());
+    return state;
+  }
+  
+  
+  bool DxvkStateCacheKey::operator == (const DxvkStateCacheKey& other) const {
+    return m_shaders == other.m_shaders
+        && m_format  == other.m_format
+        && m_state   == other.m_state;
+  }
+  
+  
+  bool DxvkStateCacheKey::operator != (const DxvkStateCacheKey& other) const {
+    return !this->operator == (other);
+  }
+  
+  
+  DxvkStateCache::DxvkStateCache() {
+    const std::string fileName
+      = DxvkPipelineCache::getCacheFilePath("dxvk.statecache");
+    
+    m_file = ::CreateFileA(fileName.c_str(),
+      GENERIC_READ | GENERIC_WRITE,
+      FILE_SHARE_READ | FILE_SHARE_WRITE,
+      nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    
+    if (m_file == INVALID_HANDLE_VALUE) {
+      Logger::warn(str::format("DxvkStateCache: Failed to open ", fileName,
+        " (error ", ::GetLastError(), "), state cache disabled"));
+      return;
+    }
+    
+    if (!this->lockFile()) {
+      Logger::warn(str::format("DxvkStateCache: Failed to lock ", fileName,
+        ", state cache disabled"));
+      return;
+    }
+    
+    std::string data;
+    
+    if (!this->readFile(0, this->getFileSize(), data)) {
+      Logger::warn(str::format("DxvkStateCache: Failed to read ", fileName,
+        ", state cache disabled"));
+      this->unlockFile();
+      return;
+    }
+    
+    std::istringstream stream(data);
+    m_fileSize = this->loadEntries(stream);
+    
+    // Start over if the file is empty or outdated. An incomplete
+    // entry at the end of the file is dropped by the next append.
+    if (m_fileSize == 0) {
+      if (!data.empty())
+        Logger::warn(str::format("DxvkStateCache: Incompatible state cache file ", fileName));
+      
+      const DxvkStateCacheHeader header = getFileHeader();
+      const std::string headerData(
+        reinterpret_cast<const char*>(&header), sizeof(header));
+      
+      if (this->truncateFile(0) && this->writeFile(0, headerData))
+        m_fileSize = headerData.size();
+      else
+        Logger::warn(str::format("DxvkStateCache: Failed to reset ", fileName));
+    }
+    
+    this->unlockFile();
+    
+    Logger::info(str::format("DxvkStateCache: Loaded ", m_entries.size(), " pipelines from ", fileName));
+  }
+  
+  
+  DxvkStateCache::~DxvkStateCache() {
+    if (m_file != INVALID_HANDLE_VALUE)
+      ::CloseHandle(m_file);
+  }
+  
+  
+  void DxvkStateCache::addPipeline(
+    const DxvkStateCacheEntry&  entry) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    if (!m_keys.insert(DxvkStateCacheKey(entry)).second || m_fileSize == 0)
+      return;
+    
+    // Write each entry immediately and in one go, so that
+    // the file stays useful if the process crashes
+    std::ostringstream stream;
+    writeEntry(stream, entry);
+    
+    const std::string data = stream.str();
+    
+    if (!this->lockFile())
+      return;
+    
+    const uint64_t offset = this->findFileEnd(
+      m_fileSize, this->getFileSize());
+    
+    if (offset == 0) {
+      Logger::warn("DxvkStateCache: State cache file was replaced, state cache disabled");
+      m_fileSize = 0;
+    } else if (this->writeFile(offset, data)) {
+      m_fileSize = offset + data.size();
+    }
+    
+    this->unlockFile();
+  }
+  
+  
+  std::vector<DxvkStateCacheEntry> DxvkStateCache::registerShader(
+    const Sha1Hash&             key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    std::vector<DxvkStateCacheEntry> result;
+    
+    if (!m_shaders.insert(key).second)
+      return result;
+    
+    auto entries = m_entryMap.equal_range(key);
+    
+    for (auto e = entries.first; e != entries.second; e++) {
+      const DxvkStateCacheEntry& entry = m_entries.at(e->second);
+      
+      if (this->isEntryReady(entry))
+        result.push_back(entry);
+    }
+    
+    return result;
+  }
+  
+  
+  void DxvkStateCache::unregisterShader(
+    const Sha1Hash&             key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_shaders.erase(key);
+  }
+  
+  
+  uint64_t DxvkStateCache::loadEntries(
+          std::istream&         stream) {
+    const DxvkStateCacheHeader expected = getFileHeader();
+    DxvkStateCacheHeader header;
+    
+    if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header))
+     || std::memcmp(&header, &expected, sizeof(header)) != 0)
+      return 0;
+    
+    // Reading stops at the first incomplete or invalid
+    // entry, which will be overwritten by the next append
+    DxvkStateCacheEntry entry;
+    uint64_t entryEnd = sizeof(header);
+    
+    while (readEntry(stream, entry)) {
+      if (m_keys.insert(DxvkStateCacheKey(entry)).second) {
+        for (const auto& shader : entry.shaders) {
+          if (shader != Sha1Hash())
+            m_entryMap.insert({ shader, m_entries.size() });
+        }
+        
+        m_entries.push_back(entry);
+      }
+      
+      entryEnd = stream.tellg();
+    }
+    
+    return entryEnd;
+  }
+  
+  
+  bool DxvkStateCache::isEntryReady(
+    const DxvkStateCacheEntry&  entry) const {
+    for (const auto& shader : entry.shaders) {
+      if (shader != Sha1Hash() && m_shaders.find(shader) == m_shaders.end())
+        return false;
+    }
+    
+    return true;
+  }
+  
+  
+  bool DxvkStateCache::readEntry(
+          std::istream&         stream,
+          DxvkStateCacheEntry&  entry) {
+    for (auto& shader : entry.shaders) {
+      Sha1Digest digest;
+      
+      if (!stream.read(reinterpret_cast<char*>(digest.data()), digest.size()))
+        return false;
+      
+      shader = Sha1Hash(digest);
+    }
+    
+    DxvkGraphicsPipelineStateInfo& state = entry.state;
+    char* stateData = reinterpret_cast<char*>(&state);
+    
+    if (!stream.read(reinterpret_cast<char*>(&entry.format), sizeof(entry.format))
+     || !stream.read(stateData, StateIaSize))
+      return false;
+    
+    if (state.ilAttributeCount > DxvkLimits::MaxNumVertexAttributes
+     || state.ilBindingCount   > DxvkLimits::MaxNumVertexBindings)
+      return false;
+    
+    if (!stream.read(reinterpret_cast<char*>(state.ilAttributes),
+          state.ilAttributeCount * sizeof(*state.ilAttributes))
+     || !stream.read(reinterpret_cast<char*>(state.ilBindings),
+          state.ilBindingCount * sizeof(*state.ilBindings))
+     || !stream.read(stateData + StateRsOffset, StateRsSize)
+     || !stream.read(reinterpret_cast<char*>(state.omBlendAttachments),
+          sizeof(state.omBlendAttachments)))
+      return false;
+    
+    state.omRenderPass = VK_NULL_HANDLE;
+    return validateEntry(entry);
+  }
+  
+  
+  void DxvkStateCache::writeEntry(
+          std::ostream&         stream,
+    const DxvkStateCacheEntry&  entry) {
+    for (const auto& shader : entry.shaders) {
+      stream.write(reinterpret_cast<const char*>(
+        shader.digest().data()), shader.digest().size());
+    }
+    
+    const DxvkGraphicsPipelineStateInfo& state = entry.state;
+    const char* stateData = reinterpret_cast<const char*>(&state);
+    
+    stream.write(reinterpret_cast<const char*>(&entry.format), sizeof(entry.format));
+    stream.write(stateData, StateIaSize);
+    stream.write(reinterpret_cast<const char*>(state.ilAttributes),
+      state.ilAttributeCount * sizeof(*state.ilAttributes));
+    stream.write(reinterpret_cast<const char*>(state.ilBindings),
+      state.ilBindingCount * sizeof(*state.ilBindings));
+    stream.write(stateData + StateRsOffset, StateRsSize);
+    stream.write(reinterpret_cast<const char*>(state.omBlendAttachments),
+      sizeof(state.omBlendAttachments));
+  }
+  
+  
+  bool DxvkStateCache::validateEntry(
+    const DxvkStateCacheEntry&  entry) {
+    // The state vector is passed to the driver as-is, so
+    // every enum read from the file has to be checked.
+    auto isBool = [] (VkBool32 value) {
+      return value == VK_FALSE || value == VK_TRUE;
+    };
+    
+    auto isSampleCount = [] (VkSampleCountFlagBits samples) {
+      const uint32_t count = samples;
+      return count != 0 && count <= VK_SAMPLE_COUNT_64_BIT
+          && (count & (count - 1)) == 0;
+    };
+    
+    auto isStencilOp = [] (const VkStencilOpState& op) {
+      return uint32_t(op.failOp)      <= VK_STENCIL_OP_END_RANGE
+          && uint32_t(op.passOp)      <= VK_STENCIL_OP_END_RANGE
+          && uint32_t(op.depthFailOp) <= VK_STENCIL_OP_END_RANGE
+          && uint32_t(op.compareOp)   <= VK_COMPARE_OP_END_RANGE;
+    };
+    
+    for (uint32_t i = 0; i < DxvkLimits::MaxNumRenderTargets; i++) {
+      if (!validateFormat(entry.format.getColorFormat(i)))
+        return false;
+    }
+    
+    if (!validateFormat(entry.format.getDepthFormat())
+     || !isSampleCount(entry.format.getSampleCount()))
+      return false;
+    
+    const DxvkGraphicsPipelineStateInfo& state = entry.state;
+    
+    for (uint32_t i = 0; i < state.ilAttributeCount; i++) {
+      if (state.ilAttributes[i].location >= DxvkLimits::MaxNumVertexAttributes
+       || state.ilAttributes[i].binding  >= DxvkLimits::MaxNumVertexBindings
+       || !validateFormat(state.ilAttributes[i].format))
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < state.ilBindingCount; i++) {
+      if (state.ilBindings[i].binding >= DxvkLimits::MaxNumVertexBindings
+       || uint32_t(state.ilBindings[i].inputRate) > VK_VERTEX_INPUT_RATE_END_RANGE)
+        return false;
+    }
+    
+    if (uint32_t(state.iaPrimitiveTopology) > VK_PRIMITIVE_TOPOLOGY_END_RANGE
+     || uint32_t(state.rsPolygonMode)       > VK_POLYGON_MODE_END_RANGE
+     || uint32_t(state.rsCullMode)          > VK_CULL_MODE_FRONT_AND_BACK
+     || uint32_t(state.rsFrontFace)         > VK_FRONT_FACE_END_RANGE
+     || uint32_t(state.dsDepthCompareOp)    > VK_COMPARE_OP_END_RANGE
+     || uint32_t(state.omLogicOp)           > VK_LOGIC_OP_END_RANGE
+     || state.rsViewportCount > DxvkLimits::MaxNumViewports
+     || !isSampleCount(state.msSampleCount)
+     || !isStencilOp(state.dsStencilOpFront)
+     || !isStencilOp(state.dsStencilOpBack))
+      return false;
+    
+    const std::array<VkBool32, 12> flags = {
+      state.iaPrimitiveRestart,
+      state.rsEnableDepthClamp,
+      state.rsEnableDiscard,
+      state.rsDepthBiasEnable,
+      state.msEnableAlphaToCoverage,
+      state.msEnableAlphaToOne,
+      state.msEnableSampleShading,
+      state.dsEnableDepthTest,
+      state.dsEnableDepthWrite,
+      state.dsEnableDepthBounds,
+      state.dsEnableStencilTest,
+      state.omEnableLogicOp,
+    };
+    
+    for (VkBool32 flag : flags) {
+      if (!isBool(flag))
+        return false;
+    }
+    
+    const VkColorComponentFlags colorMask
+      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+      | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    
+    for (const auto& blend : state.omBlendAttachments) {
+      if (!isBool(blend.blendEnable)
+       || uint32_t(blend.srcColorBlendFactor) > VK_BLEND_FACTOR_END_RANGE
+       || uint32_t(blend.dstColorBlendFactor) > VK_BLEND_FACTOR_END_RANGE
+       || uint32_t(blend.srcAlphaBlendFactor) > VK_BLEND_FACTOR_END_RANGE
+       || uint32_t(blend.dstAlphaBlendFactor) > VK_BLEND_FACTOR_END_RANGE
+       || uint32_t(blend.colorBlendOp)        > VK_BLEND_OP_END_RANGE
+       || uint32_t(blend.alphaBlendOp)        > VK_BLEND_OP_END_RANGE
+       || (blend.colorWriteMask & ~colorMask) != 0)
+        return false;
+    }
+    
+    return true;
+  }
+  
+  
+  bool DxvkStateCache::validateFormat(
+          VkFormat              format) {
+    // Formats from extensions are not used for rendering
+    return uint32_t(format) <= VK_FORMAT_END_RANGE;
+  }
+  
+  
+  bool DxvkStateCache::writeFile(
+          uint64_t              offset,
+    const std::string&          data) {
+    LARGE_INTEGER position;
+    position.QuadPart = offset;
+    
+    DWORD written = 0;
+    
+    if (!::SetFilePointerEx(m_file, position, nullptr, FILE_BEGIN)
+     || !::WriteFile(m_file, data.data(), data.size(), &written, nullptr)
+     || written != data.size()) {
+      Logger::warn("DxvkStateCache: Failed to write state cache");
+      return false;
+    }
+    
+    return true;
+  }
+  
+  
+  bool DxvkStateCache::readFile(
+          uint64_t              offset,
+          uint64_t              size,
+          std::string&          data) {
+    LARGE_INTEGER position;
+    position.QuadPart = offset;
+    
+    data.resize(size);
+    DWORD read = 0;
+    
+    return ::SetFilePointerEx(m_file, position, nullptr, FILE_BEGIN)
+        && ::ReadFile(m_file, &data[0], data.size(), &read, nullptr)
+        && read == data.size();
+  }
+  
+  
+  bool DxvkStateCache::truncateFile(
+          uint64_t              size) {
+    LARGE_INTEGER position;
+    position.QuadPart = size;
+    
+    return ::SetFilePointerEx(m_file, position, nullptr, FILE_BEGIN)
+        && ::SetEndOfFile(m_file);
+  }
+  
+  
+  uint64_t DxvkStateCache::findFileEnd(
+          uint64_t              offset,
+          uint64_t              fileSize) {
+    // Another process may have started over with a different
+    // file version, in which case we must not append to it.
+    const DxvkStateCacheHeader expected = getFileHeader();
+    std::string data;
+    
+    if (fileSize < offset
+     || !this->readFile(0, sizeof(expected), data)
+     || std::memcmp(data.data(), &expected, sizeof(expected)) != 0
+     || !this->readFile(offset, fileSize - offset, data))
+      return 0;
+    
+    // Skip entries appended by other users of the file since
+    // the last write, and drop an incomplete entry left behind
+    // by a crash so that all entries written later can be read.
+    std::istringstream stream(data);
+    
+    DxvkStateCacheEntry entry;
+    uint64_t entryEnd = 0;
+    
+    while (readEntry(stream, entry))
+      entryEnd = stream.tellg();
+    
+    offset += entryEnd;
+    
+    if (offset < fileSize)
+      this->truncateFile(offset);
+    
+    return offset;
+  }
+  
+  
+  uint64_t DxvkStateCache::getFileSize() const {
+    LARGE_INTEGER fileSize;
+    
+    if (!::GetFileSizeEx(m_file, &fileSize))
+      return 0;
+    
+    return fileSize.QuadPart;
+  }
+  
+  
+  bool DxvkStateCache::lockFile() {
+    // Same lock region as the shader cache, a single
+    // byte beyond any size the file will ever reach
+    OVERLAPPED overlapped = { };
+    overlapped.Offset     = 0xFFFFFFFFu;
+    overlapped.OffsetHigh = 0x7FFFFFFFu;
+    
+    return ::LockFileEx(m_file, LOCKFILE_EXCLUSIVE_LOCK,
+      0, 1, 0, &overlapped);
+  }
+  
+  
+  void DxvkStateCache::unlockFile() {
+    OVERLAPPED overlapped = { };
+    overlapped.Offset     = 0xFFFFFFFFu;
+    overlapped.OffsetHigh = 0x7FFFFFFFu;
+    
+    ::UnlockFileEx(m_file, 0, 1, 0, &overlapped);
+  }
+  
+  
+  DxvkStateCacheHeader DxvkStateCache::getFileHeader() {
+    DxvkStateCacheHeader header;
+    std::memcpy(header.magic, "DXVK", 4);
+    header.version   = FileVersion;
+    header.stateSize = sizeof(DxvkGraphicsPipelineStateInfo);
+    return header;
+  }
+  
+}
\ No newline at end of file
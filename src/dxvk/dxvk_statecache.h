@@ -0,0 +1,187 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "dxvk_graphics.h"
+
+namespace dxvk {
+  
+  /**
+   * \brief State cache entry
+   * 
+   * Stores everything that is needed to compile a graphics
+   * pipeline in a way that does not depend on any objects
+   * of the current process. Shaders are identified by their
+   * shader keys, in the order VS, TCS, TES, GS, FS, where
+   * unused stages have a null key. The render pass handle
+   * in the state vector is always \c VK_NULL_HANDLE.
+   */
+  struct DxvkStateCacheEntry {
+    std::array<Sha1Hash, 5>       shaders;
+    DxvkRenderPassFormat          format;
+    DxvkGraphicsPipelineStateInfo state;
+  };
+  
+  
+  /**
+   * \brief State cache key
+   * 
+   * Normalized representation of a state cache
+   * entry, used to detect duplicate entries.
+   */
+  class DxvkStateCacheKey {
+    
+  public:
+    
+    DxvkStateCacheKey(
+      const DxvkStateCacheEntry& entry);
+    
+    size_t hash() const;
+    
+    bool operator == (const DxvkStateCacheKey& other) const;
+    bool operator != (const DxvkStateCacheKey& other) const;
+    
+  private:
+    
+    std::array<Sha1Hash, 5>       m_shaders;
+    DxvkRenderPassFormat          m_format;
+    DxvkGraphicsPipelineStateKey  m_state;
+    
+  };
+  
+  
+  /**
+   * \brief State cache file header
+   */
+  struct DxvkStateCacheHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t stateSize;
+  };
+  
+  
+  /**
+   * \brief Pipeline state cache
+   * 
+   * Records the shader and state combinations of all graphics
+   * pipelines that get compiled, and appends them to a file.
+   * On the next run, the recorded pipelines are compiled in
+   * the background as soon as all their shaders are available,
+   * so that they are ready by the time they are first used.
+   * 
+   * The file may be shared by multiple devices and processes.
+   * Loading and appending entries is serialized with a file
+   * lock, and entries are validated before they are used.
+   */
+  class DxvkStateCache : public RcObject {
+    constexpr static uint32_t FileVersion = 1;
+    
+    // Only the used vertex attributes and bindings are
+    // written to the file, the rest of the state vector
+    // is written as-is in two contiguous blocks.
+    constexpr static size_t StateIaSize   = offsetof(DxvkGraphicsPipelineStateInfo, ilAttributes);
+    constexpr static size_t StateRsOffset = offsetof(DxvkGraphicsPipelineStateInfo, rsEnableDepthClamp);
+    constexpr static size_t StateRsSize   = offsetof(DxvkGraphicsPipelineStateInfo, omRenderPass) - StateRsOffset;
+  public:
+    
+    DxvkStateCache();
+    ~DxvkStateCache();
+    
+    /**
+     * \brief Adds a pipeline to the cache
+     * 
+     * If the entry is not already known, it will
+     * be appended to the state cache file.
+     * \param [in] entry The state cache entry
+     */
+    void addPipeline(
+      const DxvkStateCacheEntry&  entry);
+    
+    /**
+     * \brief Registers a shader
+     * 
+     * Marks the shader as available and returns all
+     * entries loaded from the state cache file that
+     * can be compiled now that the shader exists.
+     * \param [in] key Shader key
+     * \returns Entries that are ready to be compiled
+     */
+    std::vector<DxvkStateCacheEntry> registerShader(
+      const Sha1Hash&             key);
+    
+    /**
+     * \brief Unregisters a shader
+     * 
+     * Marks the shader as no longer available, so that
+     * entries using the shader will be returned again
+     * once a shader with the same key is registered.
+     * \param [in] key Shader key
+     */
+    void unregisterShader(
+      const Sha1Hash&             key);
+    
+  private:
+    
+    std::mutex                        m_mutex;
+    std::vector<DxvkStateCacheEntry>  m_entries;
+    
+    std::unordered_set<DxvkStateCacheKey, DxvkHash>     m_keys;
+    std::unordered_set<Sha1Hash, DxvkHash>              m_shaders;
+    std::unordered_multimap<Sha1Hash, size_t, DxvkHash> m_entryMap;
+    
+    HANDLE   m_file     = INVALID_HANDLE_VALUE;
+    uint64_t m_fileSize = 0;
+    
+    uint64_t loadEntries(
+            std::istream&         stream);
+    
+    bool isEntryReady(
+      const DxvkStateCacheEntry&  entry) const;
+    
+    bool writeFile(
+            uint64_t              offset,
+      const std::string&          data);
+    
+    bool readFile(
+            uint64_t              offset,
+            uint64_t              size,
+            std::string&          data);
+    
+    bool truncateFile(
+            uint64_t              size);
+    
+    uint64_t findFileEnd(
+            uint64_t              offset,
+            uint64_t              fileSize);
+    
+    uint64_t getFileSize() const;
+    
+    bool lockFile();
+    
+    void unlockFile();
+    
+    static bool readEntry(
+            std::istream&         stream,
+            DxvkStateCacheEntry&  entry);
+    
+    static bool validateEntry(
+      const DxvkStateCacheEntry&  entry);
+    
+    static bool validateFormat(
+            VkFormat              format);
+    
+    static void writeEntry(
+            std::ostream&         stream,
+      const DxvkStateCacheEntry&  entry);
+    
+    static DxvkStateCacheHeader getFileHeader();
+    
+  };
+  
+}
\ No newline at end of file
@@ -12,6 +12,8 @@ namespace dxvk {
    */
   enum class DxvkStat : uint32_t {
     CtxDescriptorUpdates, ///< # of descriptor set writes
+    CtxDescriptorReuses,  ///< # of descriptor sets reused from the cache
+    CtxDescriptorPushes,  ///< # of push descriptor updates
     CtxDrawCalls,         ///< # of vkCmdDraw/vkCmdDrawIndexed
     CtxDispatchCalls,     ///< # of vkCmdDispatch
     CtxFramebufferBinds,  ///< # of render pass begin/end
@@ -19,6 +21,20 @@ namespace dxvk {
     DevQueueSubmissions,  ///< # of vkQueueSubmit
     DevQueuePresents,     ///< # of vkQueuePresentKHR (aka frames)
     DevSynchronizations,  ///< # of vkDeviceWaitIdle
+    DevResourceWaits,     ///< # of waits for individual resources
+    DevQueuePendingOps,   ///< # of queued submits/presents (snapshot)
+    DevStagingRingSize,   ///< Staging ring size in kB (snapshot)
+    DevStagingHighWater,  ///< Max. staging memory in use in kB
+    DevPipelineCompiles,  ///< # of compiled graphics pipelines
+    DevPipelineTimeTotal, ///< Total pipeline compile time in ms
+    DevPipelineTimeMax,   ///< Max. pipeline compile time in ms
+    DevPipelineQueued,    ///< # of pipelines queued for compilation (snapshot)
+    DevPipeCacheLoaded,   ///< Pipeline cache data loaded from disk in kB
+    DevPipeCacheSaved,    ///< Pipeline cache data written to disk in kB
+    DevShaderCompiles,    ///< # of compiled shaders
+    DevShaderDwords,      ///< # of compiled shader code DWORDs
+    DevShaderTimeTotal,   ///< Time spent compiling shaders in ms
+    DevShaderQueued,      ///< # of shaders queued for compilation (snapshot)
     ResBufferCreations,   ///< # of buffer creations
     ResBufferUpdates,     ///< # of unmapped buffer updates
     ResImageCreations,    ///< # of image creations
@@ -56,6 +72,18 @@ namespace dxvk {
       m_counters.at(counterId(counter)) += amount;
     }
     
+    /**
+     * \brief Sets a counter to a given value
+     * 
+     * Used for counters that represent a snapshot
+     * of the current state rather than a total.
+     * \param [in] counter The counter to set
+     * \param [in] value New counter value
+     */
+    void set(DxvkStat counter, uint32_t value) {
+      m_counters.at(counterId(counter)) = value;
+    }
+    
     /**
      * \brief Returns a counter
      * 
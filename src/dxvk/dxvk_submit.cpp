@@ -0,0 +1,187 @@
+#include "dxvk_submit.h"
+
+namespace dxvk {
+  
+  DxvkSubmitThread::DxvkSubmitThread(
+    const Rc<vk::DeviceFn>&     vkd,
+          DxvkSubmissionQueue*  submissionQueue,
+          VkQueue               graphicsQueue,
+          VkQueue               transferQueue,
+          VkQueue               presentQueue)
+  : m_vkd             (vkd),
+    m_submissionQueue (submissionQueue),
+    m_graphicsQueue   (graphicsQueue),
+    m_transferQueue   (transferQueue),
+    m_presentQueue    (presentQueue),
+    m_thread          ([this] () { threadFunc(); }) {
+    
+  }
+  
+  
+  DxvkSubmitThread::~DxvkSubmitThread() {
+    { std::unique_lock<std::mutex> lock(m_mutex);
+      m_stopped.store(true);
+    }
+    
+    m_condOnAdd.notify_one();
+    m_thread.join();
+  }
+  
+  
+  void DxvkSubmitThread::submit(
+    const Rc<DxvkCommandList>&  cmdList,
+    const Rc<DxvkFence>&        fence,
+    const Rc<DxvkSemaphore>&    waitSync,
+    const Rc<DxvkSemaphore>&    wakeSync) {
+    DxvkQueueEntry entry;
+    entry.op       = DxvkQueueOp::Submit;
+    entry.cmdList  = cmdList;
+    entry.fence    = fence;
+    entry.waitSync = waitSync;
+    entry.wakeSync = wakeSync;
+    this->enqueue(std::move(entry));
+  }
+  
+  
+  void DxvkSubmitThread::present(
+          VkSwapchainKHR        swapchain,
+          uint32_t              imageIndex,
+    const Rc<DxvkSemaphore>&    waitSync) {
+    DxvkQueueEntry entry;
+    entry.op         = DxvkQueueOp::Present;
+    entry.waitSync   = waitSync;
+    entry.swapchain  = swapchain;
+    entry.imageIndex = imageIndex;
+    this->enqueue(std::move(entry));
+  }
+  
+  
+  void DxvkSubmitThread::synchronize() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    m_condOnDone.wait(lock, [this] {
+      return m_pending.load() == 0;
+    });
+  }
+  
+  
+  void DxvkSubmitThread::synchronizePresents() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    m_condOnDone.wait(lock, [this] {
+      return m_presents.load() == 0;
+    });
+  }
+  
+  
+  void DxvkSubmitThread::enqueue(DxvkQueueEntry&& entry) {
+    const bool isPresent = entry.op == DxvkQueueOp::Present;
+    
+    // Count the entry before it becomes visible, so that
+    // the submission thread cannot retire it first and
+    // synchronize() cannot return while it is in flight
+    { std::unique_lock<std::mutex> lock(m_mutex);
+      m_pending += 1;
+      
+      if (isPresent)
+        m_presents += 1;
+    }
+    
+    // If the queue is full, the submission thread is
+    // lagging behind and we have no choice but to wait
+    while (!m_entries.push(std::move(entry)))
+      std::this_thread::yield();
+    
+    // The counter was updated under the lock, so the
+    // submission thread cannot miss this notification
+    m_condOnAdd.notify_one();
+  }
+  
+  
+  void DxvkSubmitThread::execute(const DxvkQueueEntry& entry) {
+    if (entry.op == DxvkQueueOp::Submit) {
+      VkSemaphore waitSemaphore = VK_NULL_HANDLE;
+      VkSemaphore wakeSemaphore = VK_NULL_HANDLE;
+      
+      if (entry.waitSync != nullptr) waitSemaphore = entry.waitSync->handle();
+      if (entry.wakeSync != nullptr) wakeSemaphore = entry.wakeSync->handle();
+      
+      const VkQueue queue = entry.cmdList->queueType() == DxvkQueueType::Transfer
+        ? m_transferQueue : m_graphicsQueue;
+      
+      entry.cmdList->submit(queue,
+        waitSemaphore, wakeSemaphore,
+        entry.fence->handle());
+      
+      // The fence must have been submitted before
+      // the submission queue is allowed to wait on it
+      m_submissionQueue->submit(entry.fence, entry.cmdList);
+    } else {
+      const VkSemaphore waitSemaphore = entry.waitSync->handle();
+      
+      VkPresentInfoKHR info;
+      info.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+      info.pNext              = nullptr;
+      info.waitSemaphoreCount = 1;
+      info.pWaitSemaphores    = &waitSemaphore;
+      info.swapchainCount     = 1;
+      info.pSwapchains        = &entry.swapchain;
+      info.pImageIndices      = &entry.imageIndex;
+      info.pResults           = nullptr;
+      
+      m_presentStatus.store(m_vkd->vkQueuePresentKHR(m_presentQueue, &info));
+    }
+  }
+  
+  
+  void DxvkSubmitThread::threadFunc() {
+    while (true) {
+      DxvkQueueEntry entry;
+      
+      if (!m_entries.pop(entry)) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        
+        // Drain the queue before exiting so that all
+        // command lists are submitted and retired
+        if (m_stopped.load() && m_pending.load() == 0)
+          return;
+        
+        // An entry has been counted, but the producer
+        // has not finished adding it to the queue yet
+        if (m_pending.load() != 0) {
+          lock.unlock();
+          std::this_thread::yield();
+          continue;
+        }
+        
+        m_condOnAdd.wait(lock, [this] {
+          return m_stopped.load() || m_pending.load() != 0;
+        });
+        
+        continue;
+      }
+      
+      try {
+        this->execute(entry);
+      } catch (const DxvkError& e) {
+        Logger::err(e.message());
+      }
+      
+      const bool isPresent = entry.op == DxvkQueueOp::Present;
+      
+      // Release all references before notifying
+      // threads that wait for the queue to drain
+      entry = DxvkQueueEntry();
+      
+      { std::unique_lock<std::mutex> lock(m_mutex);
+        m_pending -= 1;
+        
+        if (isPresent)
+          m_presents -= 1;
+      }
+      
+      m_condOnDone.notify_all();
+    }
+  }
+  
+}
\ No newline at end of file
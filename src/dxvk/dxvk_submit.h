@@ -0,0 +1,162 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "../util/sync/sync_queue.h"
+
+#include "dxvk_cmdlist.h"
+#include "dxvk_queue.h"
+#include "dxvk_sync.h"
+
+namespace dxvk {
+  
+  /**
+   * \brief Queue operation type
+   */
+  enum class DxvkQueueOp : uint32_t {
+    Submit,   ///< Command list submission
+    Present,  ///< Swap chain image presentation
+  };
+  
+  
+  /**
+   * \brief Queue operation
+   * 
+   * Stores all objects needed to perform a queue
+   * submission or a present operation. References
+   * are held until the operation is executed.
+   */
+  struct DxvkQueueEntry {
+    DxvkQueueOp         op          = DxvkQueueOp::Submit;
+    Rc<DxvkCommandList> cmdList;
+    Rc<DxvkFence>       fence;
+    Rc<DxvkSemaphore>   waitSync;
+    Rc<DxvkSemaphore>   wakeSync;
+    VkSwapchainKHR      swapchain   = VK_NULL_HANDLE;
+    uint32_t            imageIndex  = 0;
+  };
+  
+  
+  /**
+   * \brief Queue submission thread
+   * 
+   * Owns the graphics, transfer and present queues of a
+   * device and executes queue submissions and present
+   * operations on a dedicated thread, so that threads
+   * recording commands do not have to wait for the
+   * driver. Operations are passed to the thread through
+   * a lock-free queue and are executed in the order in
+   * which they were added.
+   * 
+   * Submitted command lists are forwarded to the submission
+   * queue, which retires them once they have completed.
+   */
+  class DxvkSubmitThread {
+    constexpr static size_t MaxNumPendingOps = 64;
+  public:
+    
+    DxvkSubmitThread(
+      const Rc<vk::DeviceFn>&     vkd,
+            DxvkSubmissionQueue*  submissionQueue,
+            VkQueue               graphicsQueue,
+            VkQueue               transferQueue,
+            VkQueue               presentQueue);
+    ~DxvkSubmitThread();
+    
+    /**
+     * \brief Queues a command list submission
+     * 
+     * The command list is submitted to the queue
+     * that matches the command list's queue type.
+     * \param [in] cmdList The command list to submit
+     * \param [in] fence Fence to signal
+     * \param [in] waitSync (Optional) Semaphore to wait on
+     * \param [in] wakeSync (Optional) Semaphore to notify
+     */
+    void submit(
+      const Rc<DxvkCommandList>&  cmdList,
+      const Rc<DxvkFence>&        fence,
+      const Rc<DxvkSemaphore>&    waitSync,
+      const Rc<DxvkSemaphore>&    wakeSync);
+    
+    /**
+     * \brief Queues a present operation
+     * 
+     * \param [in] swapchain The swap chain
+     * \param [in] imageIndex Index of the image to present
+     * \param [in] waitSync Semaphore to wait on
+     */
+    void present(
+            VkSwapchainKHR        swapchain,
+            uint32_t              imageIndex,
+      const Rc<DxvkSemaphore>&    waitSync);
+    
+    /**
+     * \brief Waits for all queued operations
+     * 
+     * Blocks until all operations that have been added
+     * so far have been passed on to the Vulkan queues.
+     */
+    void synchronize();
+    
+    /**
+     * \brief Waits for all queued present operations
+     * 
+     * Swap chains must be externally synchronized, so no
+     * present operation may be executed while an image is
+     * acquired from the same swap chain. Only waits for
+     * present operations, not for command submissions.
+     */
+    void synchronizePresents();
+    
+    /**
+     * \brief Result of the last present operation
+     * 
+     * Since presentation is asynchronous, errors can
+     * only be reported with a delay of one frame.
+     * \returns Status of the most recent present
+     */
+    VkResult presentStatus() const {
+      return m_presentStatus.load();
+    }
+    
+    /**
+     * \brief Number of pending operations
+     * \returns Operations not yet executed
+     */
+    uint32_t pending() const {
+      return m_pending.load();
+    }
+    
+  private:
+    
+    Rc<vk::DeviceFn>      m_vkd;
+    DxvkSubmissionQueue*  m_submissionQueue;
+    
+    VkQueue m_graphicsQueue = VK_NULL_HANDLE;
+    VkQueue m_transferQueue = VK_NULL_HANDLE;
+    VkQueue m_presentQueue  = VK_NULL_HANDLE;
+    
+    std::atomic<bool>     m_stopped       = { false };
+    std::atomic<uint32_t> m_pending       = { 0u };
+    std::atomic<uint32_t> m_presents      = { 0u };
+    std::atomic<VkResult> m_presentStatus = { VK_SUCCESS };
+    
+    LockFreeQueue<DxvkQueueEntry, MaxNumPendingOps> m_entries;
+    
+    std::mutex              m_mutex;
+    std::condition_variable m_condOnAdd;
+    std::condition_variable m_condOnDone;
+    std::thread             m_thread;
+    
+    void enqueue(DxvkQueueEntry&& entry);
+    
+    void execute(const DxvkQueueEntry& entry);
+    
+    void threadFunc();
+    
+  };
+  
+}
\ No newline at end of file
@@ -44,19 +44,8 @@ namespace dxvk {
   
   
   void DxvkSwapchain::present(const Rc<DxvkSemaphore>& waitSync) {
-    const VkSemaphore waitSemaphore = waitSync->handle();
-    
-    VkPresentInfoKHR info;
-    info.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    info.pNext              = nullptr;
-    info.waitSemaphoreCount = 1;
-    info.pWaitSemaphores    = &waitSemaphore;
-    info.swapchainCount     = 1;
-    info.pSwapchains        = &m_handle;
-    info.pImageIndices      = &m_imageIndex;
-    info.pResults           = nullptr;
-    
-    VkResult status = m_device->presentSwapImage(info);
+    VkResult status = m_device->presentSwapImage(
+      m_handle, m_imageIndex, waitSync);
     
     if (status != VK_SUCCESS
      && status != VK_SUBOPTIMAL_KHR
@@ -74,6 +63,10 @@ namespace dxvk {
   
   VkResult DxvkSwapchain::acquireNextImage(
     const Rc<DxvkSemaphore>& wakeSync) {
+    // The previous present operation may still be executing
+    // on the submission thread, using the same swap chain
+    m_device->synchronizePresents();
+    
     return m_vkd->vkAcquireNextImageKHR(
       m_vkd->device(), m_handle,
       std::numeric_limits<uint64_t>::max(),
@@ -51,6 +51,9 @@ namespace dxvk {
      * This may actually fail to present an image. If that is the
      * case, the surface contents will be undefined for this frame
      * and the swapchain object will be recreated.
+     * 
+     * The present operation is executed asynchronously, so
+     * errors are reported by the next call to this method.
      * \param [in] waitSync Semaphore to wait on
      */
     void present(
@@ -0,0 +1,186 @@
+#include <cstring>
+
+#include "dxvk_device.h"
+#include "dxvk_transfer.h"
+
+namespace dxvk {
+  
+  DxvkTransferContext::DxvkTransferContext(const Rc<DxvkDevice>& device)
+  : m_device              (device),
+    m_graphicsQueueFamily (device->adapter()->graphicsQueueFamily()),
+    m_transferQueueFamily (device->adapter()->transferQueueFamily()) {
+    
+  }
+  
+  
+  DxvkTransferContext::~DxvkTransferContext() {
+    
+  }
+  
+  
+  void DxvkTransferContext::submit() {
+    if (m_transferCmd == nullptr)
+      return;
+    
+    m_releaseBarriers.recordCommands(m_transferCmd);
+    m_acquireBarriers.recordCommands(m_acquireCmd);
+    
+    m_transferCmd->endRecording();
+    m_acquireCmd ->endRecording();
+    
+    // The acquire operations must not execute before
+    // the matching release operations have completed
+    const Rc<DxvkSemaphore> semaphore = m_device->createSemaphore();
+    
+    m_device->submitCommandList(
+      std::exchange(m_transferCmd, nullptr),
+      nullptr, semaphore);
+    
+    m_device->submitCommandList(
+      std::exchange(m_acquireCmd, nullptr),
+      semaphore, nullptr);
+  }
+  
+  
+  void DxvkTransferContext::updateBuffer(
+    const Rc<DxvkBuffer>&           buffer,
+          VkDeviceSize              offset,
+          VkDeviceSize              size,
+    const void*                     data) {
+    if (size == VK_WHOLE_SIZE)
+      size = buffer->info().size - offset;
+    
+    if (size == 0)
+      return;
+    
+    this->beginRecording();
+    
+    auto slice = m_transferCmd->stagedAlloc(size, 1);
+    std::memcpy(slice.mapPtr, data, size);
+    
+    m_transferCmd->stagedBufferCopy(
+      buffer->handle(),
+      offset, size, slice);
+    
+    m_releaseBarriers.transferBufferOwnership(
+      buffer, offset, size,
+      m_transferQueueFamily,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_WRITE_BIT,
+      m_graphicsQueueFamily, 0, 0);
+    
+    m_acquireBarriers.transferBufferOwnership(
+      buffer, offset, size,
+      m_transferQueueFamily, 0, 0,
+      m_graphicsQueueFamily,
+      buffer->info().stages,
+      buffer->info().access);
+    
+    m_transferCmd->trackResource(buffer->resource());
+    m_acquireCmd ->trackResource(buffer->resource());
+  }
+  
+  
+  void DxvkTransferContext::updateImage(
+    const Rc<DxvkImage>&            image,
+    const VkImageSubresourceLayers& subresources,
+    const void*                     data,
+          VkDeviceSize              pitchPerRow,
+          VkDeviceSize              pitchPerLayer) {
+    if (subresources.layerCount == 0)
+      return;
+    
+    this->beginRecording();
+    
+    const DxvkFormatInfo* formatInfo
+      = imageFormatInfo(image->info().format);
+    
+    const VkExtent3D imageExtent = image->mipLevelExtent(subresources.mipLevel);
+    
+    // Partial blocks at the edges of small mip
+    // levels of compressed images still count
+    VkExtent3D blockCount;
+    blockCount.width  = (imageExtent.width  + formatInfo->blockSize.width  - 1) / formatInfo->blockSize.width;
+    blockCount.height = (imageExtent.height + formatInfo->blockSize.height - 1) / formatInfo->blockSize.height;
+    blockCount.depth  = (imageExtent.depth  + formatInfo->blockSize.depth  - 1) / formatInfo->blockSize.depth;
+    blockCount.depth *= subresources.layerCount;
+    
+    const VkDeviceSize bytesTotal = formatInfo->elementSize
+      * blockCount.width * blockCount.height * blockCount.depth;
+    
+    // Queues without graphics or compute support require
+    // buffer offsets for image copies to be 4-byte aligned
+    DxvkStagingBufferSlice slice = m_transferCmd->stagedAlloc(
+      bytesTotal, std::max<VkDeviceSize>(formatInfo->elementSize, 4));
+    
+    util::packImageData(
+      reinterpret_cast<char*>(slice.mapPtr),
+      reinterpret_cast<const char*>(data),
+      blockCount, formatInfo->elementSize,
+      pitchPerRow, pitchPerLayer);
+    
+    VkImageSubresourceRange subresourceRange;
+    subresourceRange.aspectMask     = subresources.aspectMask;
+    subresourceRange.baseMipLevel   = subresources.mipLevel;
+    subresourceRange.levelCount     = 1;
+    subresourceRange.baseArrayLayer = subresources.baseArrayLayer;
+    subresourceRange.layerCount     = subresources.layerCount;
+    
+    m_layoutBarriers.accessImage(
+      image, subresourceRange,
+      VK_IMAGE_LAYOUT_UNDEFINED, 0, 0,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_WRITE_BIT);
+    m_layoutBarriers.recordCommands(m_transferCmd);
+    
+    VkBufferImageCopy region;
+    region.bufferOffset       = slice.offset;
+    region.bufferRowLength    = 0;
+    region.bufferImageHeight  = 0;
+    region.imageSubresource   = subresources;
+    region.imageOffset        = VkOffset3D { 0, 0, 0 };
+    region.imageExtent        = imageExtent;
+    
+    m_transferCmd->stagedBufferImageCopy(image->handle(),
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      region, slice);
+    
+    // Release and acquire barriers must use the same
+    // layouts. The layout transition happens only once,
+    // and all of them are recorded at submission time.
+    m_releaseBarriers.transferImageOwnership(
+      image, subresourceRange,
+      m_transferQueueFamily,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_WRITE_BIT,
+      m_graphicsQueueFamily,
+      image->info().layout, 0, 0);
+    
+    m_acquireBarriers.transferImageOwnership(
+      image, subresourceRange,
+      m_transferQueueFamily,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, 0,
+      m_graphicsQueueFamily,
+      image->info().layout,
+      image->info().stages,
+      image->info().access);
+    
+    m_transferCmd->trackResource(image);
+    m_acquireCmd ->trackResource(image);
+  }
+  
+  
+  void DxvkTransferContext::beginRecording() {
+    if (m_transferCmd != nullptr)
+      return;
+    
+    m_transferCmd = m_device->createTransferCommandList();
+    m_acquireCmd  = m_device->createCommandList();
+    
+    m_transferCmd->beginRecording();
+    m_acquireCmd ->beginRecording();
+  }
+  
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "dxvk_barrier.h"
+#include "dxvk_cmdlist.h"
+#include "dxvk_util.h"
+
+namespace dxvk {
+  
+  class DxvkDevice;
+  
+  /**
+   * \brief Transfer context
+   * 
+   * Records uploads into command lists for the device's
+   * dedicated transfer queue, so that they can execute
+   * alongside rendering. Uploaded resources are released
+   * to the graphics queue family, and the matching acquire
+   * barriers are recorded into a graphics command list
+   * which waits for the transfer command list to complete.
+   * 
+   * Uploads always discard the previous contents of the
+   * destination, so this is only suitable for resources
+   * that are not yet used by any other command list.
+   */
+  class DxvkTransferContext : public RcObject {
+    
+  public:
+    
+    DxvkTransferContext(const Rc<DxvkDevice>& device);
+    ~DxvkTransferContext();
+    
+    /**
+     * \brief Checks whether any uploads are pending
+     * \returns \c true if there are unsubmitted uploads
+     */
+    bool hasPendingUploads() const {
+      return m_transferCmd != nullptr;
+    }
+    
+    /**
+     * \brief Submits pending uploads
+     * 
+     * Submits the transfer command list, followed by
+     * the graphics command list that acquires all
+     * uploaded resources. Command lists that use any
+     * of these resources must be submitted afterwards.
+     */
+    void submit();
+    
+    /**
+     * \brief Uploads buffer data
+     * 
+     * \param [in] buffer Buffer to write to
+     * \param [in] offset Offset of the region to update
+     * \param [in] size Size of the region to update
+     * \param [in] data Pointer to the data
+     */
+    void updateBuffer(
+      const Rc<DxvkBuffer>&           buffer,
+            VkDeviceSize              offset,
+            VkDeviceSize              size,
+      const void*                     data);
+    
+    /**
+     * \brief Uploads image data
+     * 
+     * Replaces the contents of entire subresources. The
+     * image is transitioned to its default layout.
+     * \param [in] image Image to write to
+     * \param [in] subresources Subresources to update
+     * \param [in] data Pointer to the data
+     * \param [in] pitchPerRow Row pitch of the data
+     * \param [in] pitchPerLayer Layer pitch of the data
+     */
+    void updateImage(
+      const Rc<DxvkImage>&            image,
+      const VkImageSubresourceLayers& subresources,
+      const void*                     data,
+            VkDeviceSize              pitchPerRow,
+            VkDeviceSize              pitchPerLayer);
+    
+  private:
+    
+    const Rc<DxvkDevice> m_device;
+    
+    const uint32_t m_graphicsQueueFamily;
+    const uint32_t m_transferQueueFamily;
+    
+    Rc<DxvkCommandList> m_transferCmd;
+    Rc<DxvkCommandList> m_acquireCmd;
+    
+    DxvkBarrierSet m_layoutBarriers;
+    DxvkBarrierSet m_releaseBarriers;
+    DxvkBarrierSet m_acquireBarriers;
+    
+    void beginRecording();
+    
+  };
+  
+}
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include <cstring>
+
 #include "dxvk_util.h"
 
 namespace dxvk::util {
@@ -34,6 +36,40 @@ namespace dxvk::util {
     return mipCnt;
   }
   
+  
+  void packImageData(
+          char*           dstData,
+    const char*           srcData,
+          VkExtent3D      blockCount,
+          VkDeviceSize    blockSize,
+          VkDeviceSize    pitchPerRow,
+          VkDeviceSize    pitchPerLayer) {
+    const VkDeviceSize bytesPerRow   = blockCount.width  * blockSize;
+    const VkDeviceSize bytesPerLayer = blockCount.height * bytesPerRow;
+    const VkDeviceSize bytesTotal    = blockCount.depth  * bytesPerLayer;
+    
+    // If the application provides tightly packed data as well,
+    // we can minimize the number of memcpy calls in order to
+    // improve performance.
+    bool useDirectCopy = true;
+    
+    useDirectCopy &= (pitchPerLayer == bytesPerLayer) || (blockCount.depth  == 1);
+    useDirectCopy &= (pitchPerRow   == bytesPerRow)   || (blockCount.height == 1);
+    
+    if (useDirectCopy) {
+      std::memcpy(dstData, srcData, bytesTotal);
+    } else {
+      for (uint32_t i = 0; i < blockCount.depth; i++) {
+        const char* srcLayer = srcData + i * pitchPerLayer;
+        
+        for (uint32_t j = 0; j < blockCount.height; j++) {
+          std::memcpy(dstData, srcLayer + j * pitchPerRow, bytesPerRow);
+          dstData += bytesPerRow;
+        }
+      }
+    }
+  }
+  
 }
 
 bool operator == (VkExtent3D a, VkExtent3D b) {
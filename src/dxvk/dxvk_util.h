@@ -21,6 +21,28 @@ namespace dxvk::util {
    */
   uint32_t computeMipLevelCount(VkExtent3D imageSize);
   
+  /**
+   * \brief Writes tightly packed image data
+   * 
+   * Copies image data with arbitrary row and layer
+   * pitches into a tightly packed buffer, which is
+   * what buffer-to-image copies without explicit
+   * strides expect.
+   * \param [in] dstData Destination buffer
+   * \param [in] srcData Source data
+   * \param [in] blockCount Number of pixels or blocks
+   * \param [in] blockSize Size of a pixel or block
+   * \param [in] pitchPerRow Source row pitch
+   * \param [in] pitchPerLayer Source layer pitch
+   */
+  void packImageData(
+          char*           dstData,
+    const char*           srcData,
+          VkExtent3D      blockCount,
+          VkDeviceSize    blockSize,
+          VkDeviceSize    pitchPerRow,
+          VkDeviceSize    pitchPerLayer);
+  
 }
 
 bool operator == (VkExtent3D a, VkExtent3D b);
@@ -262,6 +262,19 @@ namespace dxvk::vk {
     VULKAN_FN(vkAcquireNextImageKHR);
     VULKAN_FN(vkQueuePresentKHR);
     #endif
+    
+    #ifdef VK_KHR_descriptor_update_template
+    VULKAN_FN(vkCreateDescriptorUpdateTemplateKHR);
+    VULKAN_FN(vkDestroyDescriptorUpdateTemplateKHR);
+    VULKAN_FN(vkUpdateDescriptorSetWithTemplateKHR);
+    #endif
+    
+    #ifdef VK_KHR_push_descriptor
+    VULKAN_FN(vkCmdPushDescriptorSetKHR);
+    #ifdef VK_KHR_descriptor_update_template
+    VULKAN_FN(vkCmdPushDescriptorSetWithTemplateKHR);
+    #endif
+    #endif
   };
   
 }
\ No newline at end of file
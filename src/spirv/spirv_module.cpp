@@ -1,7 +1,23 @@
+#include <array>
+#include <cstring>
+
 #include "spirv_module.h"
 
 namespace dxvk {
   
+  size_t SpirvDeclaration::hash() const {
+    size_t result = 0;
+    
+    for (uint32_t word : words) {
+      result ^= word + 0x9e3779b9
+              + (result << 6)
+              + (result >> 2);
+    }
+    
+    return result;
+  }
+  
+  
   SpirvModule:: SpirvModule() {
     this->instImportGlsl450();
   }
@@ -125,91 +141,79 @@ namespace dxvk {
   
   uint32_t SpirvModule::constBool(
           bool                    v) {
-    uint32_t typeId   = this->defBoolType();
-    uint32_t resultId = this->allocateId();
-    
-    m_typeConstDefs.putIns  (v ? spv::OpConstantTrue : spv::OpConstantFalse, 3);
-    m_typeConstDefs.putWord (typeId);
-    m_typeConstDefs.putWord (resultId);
-    return resultId;
+    return this->defConst(v
+        ? spv::OpConstantTrue
+        : spv::OpConstantFalse,
+      this->defBoolType(),
+      0, nullptr);
   }
   
   
   uint32_t SpirvModule::consti32(
           int32_t                 v) {
-    uint32_t typeId   = this->defIntType(32, 1);
-    uint32_t resultId = this->allocateId();
+    std::array<uint32_t, 1> data = { uint32_t(v) };
     
-    m_typeConstDefs.putIns  (spv::OpConstant, 4);
-    m_typeConstDefs.putWord (typeId);
-    m_typeConstDefs.putWord (resultId);
-    m_typeConstDefs.putInt32(v);
-    return resultId;
+    return this->defConst(spv::OpConstant,
+      this->defIntType(32, 1),
+      data.size(), data.data());
   }
   
   
   uint32_t SpirvModule::consti64(
           int64_t                 v) {
-    uint32_t typeId   = this->defIntType(64, 1);
-    uint32_t resultId = this->allocateId();
+    std::array<uint32_t, 2> data = {
+      uint32_t(uint64_t(v) >>  0),
+      uint32_t(uint64_t(v) >> 32),
+    };
     
-    m_typeConstDefs.putIns  (spv::OpConstant, 5);
-    m_typeConstDefs.putWord (typeId);
-    m_typeConstDefs.putWord (resultId);
-    m_typeConstDefs.putInt64(v);
-    return resultId;
+    return this->defConst(spv::OpConstant,
+      this->defIntType(64, 1),
+      data.size(), data.data());
   }
   
   
   uint32_t SpirvModule::constu32(
           uint32_t                v) {
-    uint32_t typeId   = this->defIntType(32, 0);
-    uint32_t resultId = this->allocateId();
+    std::array<uint32_t, 1> data = { v };
     
-    m_typeConstDefs.putIns  (spv::OpConstant, 4);
-    m_typeConstDefs.putWord (typeId);
-    m_typeConstDefs.putWord (resultId);
-    m_typeConstDefs.putInt32(v);
-    return resultId;
+    return this->defConst(spv::OpConstant,
+      this->defIntType(32, 0),
+      data.size(), data.data());
   }
   
   
   uint32_t SpirvModule::constu64(
           uint64_t                v) {
-    uint32_t typeId   = this->defIntType(64, 0);
-    uint32_t resultId = this->allocateId();
+    std::array<uint32_t, 2> data = {
+      uint32_t(v >>  0),
+      uint32_t(v >> 32),
+    };
     
-    m_typeConstDefs.putIns  (spv::OpConstant, 5);
-    m_typeConstDefs.putWord (typeId);
-    m_typeConstDefs.putWord (resultId);
-    m_typeConstDefs.putInt64(v);
-    return resultId;
+    return this->defConst(spv::OpConstant,
+      this->defIntType(64, 0),
+      data.size(), data.data());
   }
   
   
   uint32_t SpirvModule::constf32(
           float                   v) {
-    uint32_t typeId   = this->defFloatType(32);
-    uint32_t resultId = this->allocateId();
+    std::array<uint32_t, 1> data;
+    std::memcpy(data.data(), &v, sizeof(v));
     
-    m_typeConstDefs.putIns  (spv::OpConstant, 4);
-    m_typeConstDefs.putWord (typeId);
-    m_typeConstDefs.putWord (resultId);
-    m_typeConstDefs.putFloat32(v);
-    return resultId;
+    return this->defConst(spv::OpConstant,
+      this->defFloatType(32),
+      data.size(), data.data());
   }
   
   
   uint32_t SpirvModule::constf64(
           double                  v) {
-    uint32_t typeId   = this->defFloatType(64);
-    uint32_t resultId = this->allocateId();
+    std::array<uint32_t, 2> data;
+    std::memcpy(data.data(), &v, sizeof(v));
     
-    m_typeConstDefs.putIns  (spv::OpConstant, 5);
-    m_typeConstDefs.putWord (typeId);
-    m_typeConstDefs.putWord (resultId);
-    m_typeConstDefs.putFloat64(v);
-    return resultId;
+    return this->defConst(spv::OpConstant,
+      this->defFloatType(64),
+      data.size(), data.data());
   }
   
   
@@ -217,15 +221,8 @@ namespace dxvk {
           uint32_t                typeId,
           uint32_t                constCount,
     const uint32_t*               constIds) {
-    uint32_t resultId = this->allocateId();
-    
-    m_typeConstDefs.putIns  (spv::OpConstantComposite, 3 + constCount);
-    m_typeConstDefs.putWord (typeId);
-    m_typeConstDefs.putWord (resultId);
-    
-    for (uint32_t i = 0; i < constCount; i++)
-      m_typeConstDefs.putWord(constIds[i]);
-    return resultId;
+    return this->defConst(spv::OpConstantComposite,
+      typeId, constCount, constIds);
   }
     
   
@@ -902,30 +899,77 @@ namespace dxvk {
           spv::Op                 op, 
           uint32_t                argCount,
     const uint32_t*               argIds) {
-    // Since the type info is stored in the code buffer,
-    // we can use the code buffer to look up type IDs as
-    // well. Result IDs are always stored as argument 1.
-    for (auto ins : m_typeConstDefs) {
-      bool match = ins.opCode() == op;
-      
-      for (uint32_t i = 0; i < argCount && match; i++)
-        match &= ins.arg(2 + i) == argIds[i];
-      
-      if (match)
-        return ins.arg(1);
-    }
+    m_declaration.words.clear();
+    m_declaration.words.push_back(op);
+    
+    for (uint32_t i = 0; i < argCount; i++)
+      m_declaration.words.push_back(argIds[i]);
+    
+    uint32_t resultId = this->lookupDeclaration();
+    
+    if (resultId != 0)
+      return resultId;
     
     // Type not yet declared, create a new one.
-    uint32_t resultId = this->allocateId();
+    resultId = this->allocateId();
     m_typeConstDefs.putIns (op, 2 + argCount);
     m_typeConstDefs.putWord(resultId);
     
     for (uint32_t i = 0; i < argCount; i++)
       m_typeConstDefs.putWord(argIds[i]);
+    
+    this->addDeclaration(resultId);
+    return resultId;
+  }
+  
+  
+  uint32_t SpirvModule::defConst(
+          spv::Op                 op,
+          uint32_t                typeId,
+          uint32_t                argCount,
+    const uint32_t*               argIds) {
+    m_declaration.words.clear();
+    m_declaration.words.push_back(op);
+    m_declaration.words.push_back(typeId);
+    
+    for (uint32_t i = 0; i < argCount; i++)
+      m_declaration.words.push_back(argIds[i]);
+    
+    uint32_t resultId = this->lookupDeclaration();
+    
+    if (resultId != 0)
+      return resultId;
+    
+    // Constant not yet declared, create a new one.
+    // Unlike types, constants store the result ID
+    // after the result type ID.
+    resultId = this->allocateId();
+    m_typeConstDefs.putIns (op, 3 + argCount);
+    m_typeConstDefs.putWord(typeId);
+    m_typeConstDefs.putWord(resultId);
+    
+    for (uint32_t i = 0; i < argCount; i++)
+      m_typeConstDefs.putWord(argIds[i]);
+    
+    this->addDeclaration(resultId);
     return resultId;
   }
   
   
+  uint32_t SpirvModule::lookupDeclaration() {
+    auto entry = m_declarations.find(m_declaration);
+    
+    return entry != m_declarations.end()
+      ? entry->second : 0;
+  }
+  
+  
+  void SpirvModule::addDeclaration(
+          uint32_t                resultId) {
+    m_declarations.insert({ m_declaration, resultId });
+  }
+  
+  
   void SpirvModule::instImportGlsl450() {
     m_instExtGlsl450 = this->allocateId();
     const char* name = "GLSL.std.450";
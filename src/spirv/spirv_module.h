@@ -1,9 +1,36 @@
 #pragma once
 
+#include <unordered_map>
+
 #include "spirv_code_buffer.h"
 
 namespace dxvk {
   
+  /**
+   * \brief Type or constant declaration
+   * 
+   * Stores the opcode of a type or constant declaration,
+   * followed by all operands except for the result ID.
+   * Used to look up existing declarations by value.
+   */
+  struct SpirvDeclaration {
+    std::vector<uint32_t> words;
+    
+    bool operator == (const SpirvDeclaration& other) const {
+      return words == other.words;
+    }
+    
+    size_t hash() const;
+  };
+  
+  
+  struct SpirvDeclarationHash {
+    size_t operator () (const SpirvDeclaration& decl) const {
+      return decl.hash();
+    }
+  };
+  
+  
   /**
    * \brief SPIR-V module
    * 
@@ -335,11 +362,28 @@ namespace dxvk {
     SpirvCodeBuffer m_variables;
     SpirvCodeBuffer m_code;
     
+    SpirvDeclaration m_declaration;
+    
+    std::unordered_map<
+      SpirvDeclaration, uint32_t,
+      SpirvDeclarationHash> m_declarations;
+    
     uint32_t defType(
             spv::Op                 op, 
             uint32_t                argCount,
       const uint32_t*               argIds);
     
+    uint32_t defConst(
+            spv::Op                 op,
+            uint32_t                typeId,
+            uint32_t                argCount,
+      const uint32_t*               argIds);
+    
+    uint32_t lookupDeclaration();
+    
+    void addDeclaration(
+            uint32_t                resultId);
+    
     void instImportGlsl450();
     
   };
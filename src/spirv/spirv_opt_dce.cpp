@@ -0,0 +1,95 @@
+#include "spirv_opt_passes.h"
+
+namespace dxvk {
+  
+  void SpirvDeadCodePass::run(SpirvOptModule& module) {
+    // Count uses of each ID within the functions. Global
+    // declarations are not considered since they only
+    // reference types, constants and other globals.
+    std::unordered_map<uint32_t, uint32_t> useCounts;
+    std::unordered_map<uint32_t, uint32_t> storeCounts;
+    
+    for (uint32_t i = module.functionBegin(); i < module.functionEnd(); i++) {
+      if (module.isRemoved(i))
+        continue;
+      
+      module.forEachIdOperand(i, [&] (uint32_t& id) {
+        useCounts[module.resolve(id)] += 1;
+      });
+      
+      if (module.op(i) == spv::OpStore)
+        storeCounts[module.resolve(module.arg(i, 1))] += 1;
+    }
+    
+    // Remove variables that are only ever written
+    std::unordered_set<uint32_t> deadVars;
+    
+    for (uint32_t i = 0; i < module.functionEnd(); i++) {
+      if (module.isRemoved(i) || module.op(i) != spv::OpVariable)
+        continue;
+      
+      const uint32_t storageClass = module.arg(i, 3);
+      
+      if (storageClass != spv::StorageClassPrivate
+       && storageClass != spv::StorageClassFunction)
+        continue;
+      
+      const uint32_t id = module.resultId(i);
+      
+      if (useCounts[id] == storeCounts[id]) {
+        deadVars.insert(id);
+        module.remove(i);
+      }
+    }
+    
+    std::vector<uint32_t> worklist;
+    
+    auto release = [&] (uint32_t& id) {
+      const uint32_t resolved = module.resolve(id);
+      
+      if (--useCounts[resolved] == 0) {
+        const uint32_t def = module.getDef(resolved);
+        
+        if (def != SpirvOptModule::NoIns)
+          worklist.push_back(def);
+      }
+    };
+    
+    if (deadVars.size() != 0) {
+      for (uint32_t i = module.functionBegin(); i < module.functionEnd(); i++) {
+        if (module.isRemoved(i) || module.op(i) != spv::OpStore)
+          continue;
+        
+        if (deadVars.find(module.resolve(module.arg(i, 1))) != deadVars.end()) {
+          module.remove(i);
+          module.forEachIdOperand(i, release);
+        }
+      }
+    }
+    
+    // Remove pure instructions without uses, and
+    // then any operands that become unused.
+    for (uint32_t i = module.functionBegin(); i < module.functionEnd(); i++)
+      worklist.push_back(i);
+    
+    while (worklist.size() != 0) {
+      const uint32_t i = worklist.back();
+      worklist.pop_back();
+      
+      if (module.isRemoved(i)
+       || i < module.functionBegin()
+       || i >= module.functionEnd()
+       || !SpirvOptModule::isPure(module.op(i)))
+        continue;
+      
+      const uint32_t id = module.resultId(i);
+      
+      if (id == 0 || useCounts[id] != 0)
+        continue;
+      
+      module.remove(i);
+      module.forEachIdOperand(i, release);
+    }
+  }
+  
+}
\ No newline at end of file
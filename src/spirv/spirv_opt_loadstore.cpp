@@ -0,0 +1,150 @@
+#include "spirv_opt_passes.h"
+
+namespace dxvk {
+  
+  void SpirvLoadStorePass::run(SpirvOptModule& module) {
+    // Variables that we track, as well as access chains
+    // into those variables. Other storage classes may be
+    // accessed by other invocations or the host.
+    std::unordered_map<uint32_t, uint32_t> aliases;
+    
+    for (uint32_t i = 0; i < module.functionEnd(); i++) {
+      if (module.isRemoved(i))
+        continue;
+      
+      const spv::Op op = module.op(i);
+      
+      if (op == spv::OpVariable) {
+        switch (module.arg(i, 3)) {
+          case spv::StorageClassInput:
+          case spv::StorageClassOutput:
+          case spv::StorageClassPrivate:
+          case spv::StorageClassFunction:
+            aliases.insert({ module.resultId(i), module.resultId(i) });
+            break;
+          
+          default:
+            break;
+        }
+      }
+      
+      if (op == spv::OpAccessChain
+       || op == spv::OpInBoundsAccessChain) {
+        auto base = aliases.find(module.resolve(module.arg(i, 3)));
+        
+        if (base != aliases.end())
+          aliases.insert({ module.resultId(i), base->second });
+      }
+    }
+    
+    if (aliases.size() == 0)
+      return;
+    
+    // Values currently stored in each variable, and stores
+    // that have not been read by any instruction so far.
+    std::unordered_map<uint32_t, uint32_t> known;
+    std::unordered_map<uint32_t, uint32_t> pending;
+    
+    auto invalidate = [&] (uint32_t id) {
+      auto alias = aliases.find(id);
+      
+      if (alias != aliases.end()) {
+        known  .erase(alias->second);
+        pending.erase(alias->second);
+      }
+    };
+    
+    for (uint32_t i = module.functionBegin(); i < module.functionEnd(); i++) {
+      if (module.isRemoved(i))
+        continue;
+      
+      const spv::Op op = module.op(i);
+      
+      if (op == spv::OpLabel
+       || op == spv::OpFunctionCall
+       || SpirvOptModule::isBlockTerminator(op)) {
+        known  .clear();
+        pending.clear();
+        continue;
+      }
+      
+      if (op == spv::OpLoad && module.length(i) == 4) {
+        const uint32_t ptr   = module.resolve(module.arg(i, 3));
+        const auto     alias = aliases.find(ptr);
+        
+        if (alias == aliases.end())
+          continue;
+        
+        // Loads through access chains read the variable,
+        // but we do not track the value of the members.
+        if (alias->second != ptr) {
+          pending.erase(alias->second);
+          continue;
+        }
+        
+        auto value = known.find(ptr);
+        
+        if (value != known.end()) {
+          module.replace(module.resultId(i), value->second);
+          module.remove(i);
+        } else {
+          known.insert({ ptr, module.resultId(i) });
+          pending.erase(ptr);
+        }
+        
+        continue;
+      }
+      
+      if (op == spv::OpStore && module.length(i) == 3) {
+        const uint32_t ptr   = module.resolve(module.arg(i, 1));
+        const uint32_t value = module.resolve(module.arg(i, 2));
+        const auto     alias = aliases.find(ptr);
+        
+        // The stored value itself may be a pointer
+        invalidate(value);
+        
+        if (alias == aliases.end())
+          continue;
+        
+        if (alias->second != ptr) {
+          invalidate(ptr);
+          continue;
+        }
+        
+        auto knownValue = known.find(ptr);
+        
+        if (knownValue != known.end()
+         && module.resolve(knownValue->second) == value) {
+          module.remove(i);
+          continue;
+        }
+        
+        // The previous store was never read, and
+        // this one overwrites the entire variable
+        auto pendingStore = pending.find(ptr);
+        
+        if (pendingStore != pending.end())
+          module.remove(pendingStore->second);
+        
+        known  [ptr] = value;
+        pending[ptr] = i;
+        continue;
+      }
+      
+      // Access chains do not access memory by themselves
+      if (op == spv::OpAccessChain
+       || op == spv::OpInBoundsAccessChain) {
+        for (uint32_t j = 4; j < module.length(i); j++)
+          invalidate(module.resolve(module.arg(i, j)));
+        continue;
+      }
+      
+      // Any other use of a variable, including loads and
+      // stores with memory operands, may read or write it.
+      module.forEachIdOperand(i, [&] (uint32_t& id) {
+        invalidate(module.resolve(id));
+      });
+    }
+  }
+  
+}
\ No newline at end of file
@@ -0,0 +1,488 @@
+#include <array>
+
+#include "spirv_opt_module.h"
+
+namespace dxvk {
+  
+  SpirvOptModule::SpirvOptModule(const SpirvCodeBuffer& code)
+  : m_words(code.data(), code.data() + code.size() / sizeof(uint32_t)) {
+    if (m_words.size() >= 5 && m_words[0] == spv::MagicNumber)
+      m_headerSize = 5;
+    
+    uint32_t offset = m_headerSize;
+    
+    while (offset < m_words.size()) {
+      const uint32_t length = m_words[offset] >> spv::WordCountShift;
+      
+      if (length == 0 || offset + length > m_words.size())
+        break;
+      
+      this->addInstruction(length, nullptr);
+      m_ins.back().offset = offset;
+      
+      offset += length;
+    }
+    
+    m_functionBegin = m_ins.size();
+    m_functionEnd   = m_ins.size();
+    
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      if (this->op(i) == spv::OpFunction) {
+        m_functionBegin = i;
+        break;
+      }
+    }
+    
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      const uint32_t id = this->resultId(i);
+      
+      if (id != 0)
+        m_defs.insert({ id, i });
+    }
+  }
+  
+  
+  SpirvOptModule::~SpirvOptModule() {
+    
+  }
+  
+  
+  bool SpirvOptModule::isSupported() const {
+    if (m_headerSize == 0)
+      return false;
+    
+    for (uint32_t i = m_functionBegin; i < m_functionEnd; i++) {
+      if (!getLayout(this->op(i), m_ins[i].length).known)
+        return false;
+    }
+    
+    return true;
+  }
+  
+  
+  uint32_t SpirvOptModule::typeId(uint32_t index) const {
+    const SpirvOpLayout layout = getLayout(
+      this->op(index), m_ins[index].length);
+    
+    return layout.hasType ? this->arg(index, 1) : 0;
+  }
+  
+  
+  uint32_t SpirvOptModule::resultId(uint32_t index) const {
+    const SpirvOpLayout layout = getLayout(
+      this->op(index), m_ins[index].length);
+    
+    if (!layout.hasResult)
+      return 0;
+    
+    return this->arg(index, layout.hasType ? 2 : 1);
+  }
+  
+  
+  void SpirvOptModule::remove(uint32_t index) {
+    if (m_ins[index].removed)
+      return;
+    
+    m_ins[index].removed = true;
+    m_liveCount -= 1;
+    
+    const uint32_t id = this->resultId(index);
+    
+    if (id != 0)
+      m_removedIds.insert(id);
+  }
+  
+  
+  uint32_t SpirvOptModule::getDef(uint32_t id) const {
+    auto entry = m_defs.find(id);
+    
+    if (entry == m_defs.end() || m_ins[entry->second].removed)
+      return NoIns;
+    
+    return entry->second;
+  }
+  
+  
+  uint32_t SpirvOptModule::getTypeOf(uint32_t id) const {
+    const uint32_t def = this->getDef(id);
+    
+    return def != NoIns
+      ? this->typeId(def) : 0;
+  }
+  
+  
+  uint32_t SpirvOptModule::getVectorSize(uint32_t typeId) const {
+    const uint32_t def = this->getDef(typeId);
+    
+    if (def == NoIns || this->op(def) != spv::OpTypeVector)
+      return 0;
+    
+    return this->arg(def, 3);
+  }
+  
+  
+  uint32_t SpirvOptModule::resolve(uint32_t id) const {
+    auto entry = m_replacements.find(id);
+    
+    while (entry != m_replacements.end()) {
+      id    = entry->second;
+      entry = m_replacements.find(id);
+    }
+    
+    return id;
+  }
+  
+  
+  void SpirvOptModule::replace(uint32_t oldId, uint32_t newId) {
+    newId = this->resolve(newId);
+    
+    if (oldId != newId)
+      m_replacements.insert({ oldId, newId });
+  }
+  
+  
+  void SpirvOptModule::applyReplacements() {
+    if (m_replacements.size() == 0)
+      return;
+    
+    for (uint32_t i = m_functionBegin; i < m_functionEnd; i++) {
+      if (m_ins[i].removed)
+        continue;
+      
+      this->forEachIdOperand(i, [this] (uint32_t& id) {
+        id = this->resolve(id);
+      });
+    }
+    
+    m_replacements.clear();
+  }
+  
+  
+  uint32_t SpirvOptModule::defUndef(uint32_t typeId) {
+    // Reuse existing undefined values of the same type
+    for (uint32_t i = m_functionEnd; i < m_ins.size(); i++) {
+      if (this->arg(i, 1) == typeId)
+        return this->arg(i, 2);
+    }
+    
+    const uint32_t resultId = m_words[3]++;
+    
+    const std::array<uint32_t, 3> words = {
+      uint32_t(spv::OpUndef) | (3u << spv::WordCountShift),
+      typeId, resultId,
+    };
+    
+    m_defs.insert({ resultId,
+      this->addInstruction(words.size(), words.data()) });
+    return resultId;
+  }
+  
+  
+  SpirvCodeBuffer SpirvOptModule::compile() const {
+    std::vector<uint32_t> words;
+    words.reserve(m_words.size());
+    words.insert(words.end(), m_words.begin(), m_words.begin() + m_headerSize);
+    
+    auto emit = [&] (uint32_t i) {
+      const uint32_t* ins = m_words.data() + m_ins[i].offset;
+      words.insert(words.end(), ins, ins + m_ins[i].length);
+    };
+    
+    for (uint32_t i = 0; i < m_functionEnd; i++) {
+      // Undefined values have to be declared
+      // along with the global variables
+      if (i == m_functionBegin) {
+        for (uint32_t j = m_functionEnd; j < m_ins.size(); j++)
+          emit(j);
+      }
+      
+      if (m_ins[i].removed)
+        continue;
+      
+      switch (this->op(i)) {
+        case spv::OpName:
+        case spv::OpMemberName:
+        case spv::OpDecorate:
+        case spv::OpMemberDecorate:
+          if (m_removedIds.find(this->arg(i, 1)) != m_removedIds.end())
+            continue;
+          break;
+        
+        default:
+          break;
+      }
+      
+      emit(i);
+    }
+    
+    return SpirvCodeBuffer(words.size(), words.data());
+  }
+  
+  
+  SpirvOpLayout SpirvOptModule::getLayout(
+          spv::Op         op,
+          uint32_t        length) {
+    SpirvOpLayout layout;
+    layout.known = true;
+    
+    // Sets up the layout for an instruction that takes
+    // ID operands from the given index up to the end
+    auto idsFrom = [&layout, length] (uint32_t r, uint32_t first) {
+      layout.idFirst[r] = first;
+      layout.idCount[r] = first < length ? length - first : 0;
+    };
+    
+    auto idsAt = [&layout, length] (uint32_t r, uint32_t first, uint32_t count) {
+      layout.idFirst[r] = first;
+      layout.idCount[r] = first + count <= length ? count : 0;
+    };
+    
+    switch (op) {
+      // Global declarations. ID operands are not
+      // needed since these are never rewritten.
+      case spv::OpExtInstImport:
+      case spv::OpString:
+      case spv::OpTypeVoid:
+      case spv::OpTypeBool:
+      case spv::OpTypeInt:
+      case spv::OpTypeFloat:
+      case spv::OpTypeVector:
+      case spv::OpTypeMatrix:
+      case spv::OpTypeImage:
+      case spv::OpTypeSampler:
+      case spv::OpTypeSampledImage:
+      case spv::OpTypeArray:
+      case spv::OpTypeRuntimeArray:
+      case spv::OpTypeStruct:
+      case spv::OpTypePointer:
+      case spv::OpTypeFunction:
+        layout.hasResult = true;
+        break;
+      
+      case spv::OpConstantTrue:
+      case spv::OpConstantFalse:
+      case spv::OpConstant:
+      case spv::OpConstantComposite:
+      case spv::OpConstantNull:
+      case spv::OpSpecConstantTrue:
+      case spv::OpSpecConstantFalse:
+      case spv::OpSpecConstant:
+      case spv::OpSpecConstantComposite:
+        layout.hasType   = true;
+        layout.hasResult = true;
+        break;
+      
+      // Function structure and control flow
+      case spv::OpNop:
+      case spv::OpFunctionEnd:
+      case spv::OpReturn:
+      case spv::OpKill:
+      case spv::OpUnreachable:
+        break;
+      
+      case spv::OpFunction:
+        layout.hasType   = true;
+        layout.hasResult = true;
+        idsAt(0, 4, 1);
+        break;
+      
+      case spv::OpFunctionParameter:
+      case spv::OpUndef:
+        layout.hasType   = true;
+        layout.hasResult = true;
+        break;
+      
+      case spv::OpLabel:
+        layout.hasResult = true;
+        break;
+      
+      case spv::OpReturnValue:
+      case spv::OpBranch:
+      case spv::OpSelectionMerge:
+        idsAt(0, 1, 1);
+        break;
+      
+      case spv::OpLoopMerge:
+        idsAt(0, 1, 2);
+        break;
+      
+      case spv::OpBranchConditional:
+        idsAt(0, 1, 3);
+        break;
+      
+      case spv::OpVariable:
+        layout.hasType   = true;
+        layout.hasResult = true;
+        idsFrom(0, 4);
+        break;
+      
+      case spv::OpLoad:
+        layout.hasType   = true;
+        layout.hasResult = true;
+        idsAt(0, 3, 1);
+        break;
+      
+      case spv::OpStore:
+        idsAt(0, 1, 2);
+        break;
+      
+      case spv::OpVectorShuffle:
+      case spv::OpCompositeInsert:
+        layout.hasType   = true;
+        layout.hasResult = true;
+        idsAt(0, 3, 2);
+        break;
+      
+      case spv::OpCompositeExtract:
+        layout.hasType   = true;
+        layout.hasResult = true;
+        idsAt(0, 3, 1);
+        break;
+      
+      case spv::OpExtInst:
+        layout.hasType   = true;
+        layout.hasResult = true;
+        idsAt(0, 3, 1);
+        idsFrom(1, 5);
+        break;
+      
+      case spv::OpImageSampleImplicitLod:
+      case spv::OpImageSampleExplicitLod:
+      case spv::OpImageFetch:
+        layout.hasType   = true;
+        layout.hasResult = true;
+        idsAt(0, 3, 2);
+        idsFrom(1, 6);
+        break;
+      
+      case spv::OpImageSampleDrefImplicitLod:
+      case spv::OpImageSampleDrefExplicitLod:
+        layout.hasType   = true;
+        layout.hasResult = true;
+        idsAt(0, 3, 3);
+        idsFrom(1, 7);
+        break;
+      
+      // Instructions where all operands are IDs
+      case spv::OpFunctionCall:
+      case spv::OpPhi:
+      case spv::OpAccessChain:
+      case spv::OpInBoundsAccessChain:
+      case spv::OpCompositeConstruct:
+      case spv::OpCopyObject:
+      case spv::OpSampledImage:
+      case spv::OpConvertFToU:
+      case spv::OpConvertFToS:
+      case spv::OpConvertSToF:
+      case spv::OpConvertUToF:
+      case spv::OpBitcast:
+      case spv::OpSNegate:
+      case spv::OpFNegate:
+      case spv::OpIAdd:
+      case spv::OpFAdd:
+      case spv::OpISub:
+      case spv::OpFSub:
+      case spv::OpIMul:
+      case spv::OpFMul:
+      case spv::OpUDiv:
+      case spv::OpSDiv:
+      case spv::OpFDiv:
+      case spv::OpUMod:
+      case spv::OpSRem:
+      case spv::OpSMod:
+      case spv::OpFRem:
+      case spv::OpFMod:
+      case spv::OpVectorTimesScalar:
+      case spv::OpDot:
+      case spv::OpAny:
+      case spv::OpAll:
+      case spv::OpLogicalEqual:
+      case spv::OpLogicalNotEqual:
+      case spv::OpLogicalOr:
+      case spv::OpLogicalAnd:
+      case spv::OpLogicalNot:
+      case spv::OpSelect:
+      case spv::OpIEqual:
+      case spv::OpINotEqual:
+      case spv::OpUGreaterThan:
+      case spv::OpSGreaterThan:
+      case spv::OpUGreaterThanEqual:
+      case spv::OpSGreaterThanEqual:
+      case spv::OpULessThan:
+      case spv::OpSLessThan:
+      case spv::OpULessThanEqual:
+      case spv::OpSLessThanEqual:
+      case spv::OpFOrdEqual:
+      case spv::OpFOrdNotEqual:
+      case spv::OpFOrdLessThan:
+      case spv::OpFOrdGreaterThan:
+      case spv::OpFOrdLessThanEqual:
+      case spv::OpFOrdGreaterThanEqual:
+      case spv::OpShiftRightLogical:
+      case spv::OpShiftRightArithmetic:
+      case spv::OpShiftLeftLogical:
+      case spv::OpBitwiseOr:
+      case spv::OpBitwiseXor:
+      case spv::OpBitwiseAnd:
+      case spv::OpNot:
+        layout.hasType   = true;
+        layout.hasResult = true;
+        idsFrom(0, 3);
+        break;
+      
+      default:
+        layout.known = false;
+    }
+    
+    return layout;
+  }
+  
+  
+  bool SpirvOptModule::isPure(spv::Op op) {
+    switch (op) {
+      case spv::OpFunction:
+      case spv::OpFunctionParameter:
+      case spv::OpFunctionCall:
+      case spv::OpLabel:
+      case spv::OpVariable:
+        return false;
+      
+      default:
+        return getLayout(op, 0).hasResult;
+    }
+  }
+  
+  
+  bool SpirvOptModule::isBlockTerminator(spv::Op op) {
+    switch (op) {
+      case spv::OpReturn:
+      case spv::OpReturnValue:
+      case spv::OpBranch:
+      case spv::OpBranchConditional:
+      case spv::OpKill:
+      case spv::OpUnreachable:
+        return true;
+      
+      default:
+        return false;
+    }
+  }
+  
+  
+  uint32_t SpirvOptModule::addInstruction(
+          uint32_t        wordCount,
+    const uint32_t*       words) {
+    SpirvOptIns ins;
+    ins.offset  = m_words.size();
+    ins.length  = wordCount;
+    ins.removed = false;
+    
+    if (words != nullptr)
+      m_words.insert(m_words.end(), words, words + wordCount);
+    
+    m_ins.push_back(ins);
+    m_liveCount += 1;
+    return m_ins.size() - 1;
+  }
+  
+}
\ No newline at end of file
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "spirv_code_buffer.h"
+#include "spirv_include.h"
+
+namespace dxvk {
+  
+  /**
+   * \brief Instruction layout
+   * 
+   * Describes where the result type and result ID are
+   * stored, as well as up to two ranges of ID operands.
+   * Operand words outside these ranges are literals.
+   */
+  struct SpirvOpLayout {
+    bool     known      = false;
+    bool     hasType    = false;
+    bool     hasResult  = false;
+    uint32_t idFirst[2] = { 0, 0 };
+    uint32_t idCount[2] = { 0, 0 };
+  };
+  
+  
+  /**
+   * \brief Instruction entry
+   */
+  struct SpirvOptIns {
+    uint32_t offset;      ///< Index of the first word
+    uint32_t length;      ///< Number of words
+    bool     removed;     ///< Removed from the module
+  };
+  
+  
+  /**
+   * \brief Module representation for optimization passes
+   * 
+   * Keeps a copy of the code and an index of all instructions,
+   * so that passes can look up definitions, rewrite operands
+   * in place and remove instructions without rebuilding the
+   * code buffer every time.
+   * 
+   * Value replacements are recorded rather than applied
+   * immediately. Passes must call \ref resolve on operands
+   * that they read, and the optimizer applies all pending
+   * replacements after each pass.
+   */
+  class SpirvOptModule {
+    
+  public:
+    
+    constexpr static uint32_t NoIns = ~0u;
+    
+    SpirvOptModule(const SpirvCodeBuffer& code);
+    ~SpirvOptModule();
+    
+    /**
+     * \brief Checks whether the module can be optimized
+     * 
+     * Passes only know about a subset of instructions. If
+     * a function uses any other instruction, the module
+     * must not be modified since ID operands of unknown
+     * instructions cannot be identified reliably.
+     * \returns \c true if all instructions are known
+     */
+    bool isSupported() const;
+    
+    /**
+     * \brief Index of the first function instruction
+     * \returns Index of the first \c OpFunction
+     */
+    uint32_t functionBegin() const {
+      return m_functionBegin;
+    }
+    
+    /**
+     * \brief Index past the last function instruction
+     * \returns End of the function code
+     */
+    uint32_t functionEnd() const {
+      return m_functionEnd;
+    }
+    
+    /**
+     * \brief Number of instructions that are not removed
+     * \returns Live instruction count
+     */
+    uint32_t liveCount() const {
+      return m_liveCount;
+    }
+    
+    /**
+     * \brief Retrieves an instruction
+     * 
+     * The returned object is invalidated when
+     * new instructions are added to the module.
+     * \param [in] index Instruction index
+     * \returns The instruction
+     */
+    SpirvInstruction ins(uint32_t index) {
+      return SpirvInstruction(
+        m_words.data() + m_ins[index].offset,
+        m_ins[index].length);
+    }
+    
+    spv::Op op(uint32_t index) const {
+      return static_cast<spv::Op>(
+        m_words[m_ins[index].offset] & spv::OpCodeMask);
+    }
+    
+    uint32_t arg(uint32_t index, uint32_t arg) const {
+      return arg < m_ins[index].length
+        ? m_words[m_ins[index].offset + arg] : 0;
+    }
+    
+    uint32_t length(uint32_t index) const {
+      return m_ins[index].length;
+    }
+    
+    bool isRemoved(uint32_t index) const {
+      return m_ins[index].removed;
+    }
+    
+    uint32_t typeId(uint32_t index) const;
+    
+    uint32_t resultId(uint32_t index) const;
+    
+    /**
+     * \brief Removes an instruction
+     * 
+     * Debug names and decorations targeting the
+     * result ID will be removed from the module.
+     * \param [in] index Instruction index
+     */
+    void remove(uint32_t index);
+    
+    /**
+     * \brief Looks up the definition of an ID
+     * 
+     * \param [in] id Result ID
+     * \returns Index of the defining instruction, or
+     *          \c NoIns if the definition was removed
+     */
+    uint32_t getDef(uint32_t id) const;
+    
+    /**
+     * \brief Queries the type of a value
+     * 
+     * \param [in] id Value ID
+     * \returns Type ID, or 0 if unknown
+     */
+    uint32_t getTypeOf(uint32_t id) const;
+    
+    /**
+     * \brief Queries vector component count
+     * 
+     * \param [in] typeId Type ID
+     * \returns Component count, or 0 if the
+     *          type is not a vector type
+     */
+    uint32_t getVectorSize(uint32_t typeId) const;
+    
+    /**
+     * \brief Resolves pending replacements
+     * 
+     * \param [in] id Value ID
+     * \returns The ID that replaces the given ID
+     */
+    uint32_t resolve(uint32_t id) const;
+    
+    /**
+     * \brief Replaces all uses of a value
+     * 
+     * \param [in] oldId The value to replace
+     * \param [in] newId The new value
+     */
+    void replace(uint32_t oldId, uint32_t newId);
+    
+    /**
+     * \brief Applies pending replacements
+     * 
+     * Rewrites the ID operands of all function
+     * instructions that use a replaced value.
+     */
+    void applyReplacements();
+    
+    /**
+     * \brief Defines an undefined value
+     * 
+     * \param [in] typeId Value type
+     * \returns ID of an \c OpUndef instruction
+     */
+    uint32_t defUndef(uint32_t typeId);
+    
+    /**
+     * \brief Iterates over ID operands
+     * 
+     * Calls the given function with a reference to each
+     * ID operand word, which may be modified in place.
+     * The result type and result ID are not included.
+     * \param [in] index Instruction index
+     * \param [in] fn Function to call
+     */
+    template<typename Fn>
+    void forEachIdOperand(uint32_t index, const Fn& fn) {
+      const SpirvOpLayout layout = getLayout(
+        this->op(index), m_ins[index].length);
+      
+      uint32_t* words = m_words.data() + m_ins[index].offset;
+      
+      for (uint32_t r = 0; r < 2; r++) {
+        for (uint32_t i = 0; i < layout.idCount[r]; i++)
+          fn(words[layout.idFirst[r] + i]);
+      }
+    }
+    
+    /**
+     * \brief Generates the optimized code
+     * \returns Code buffer
+     */
+    SpirvCodeBuffer compile() const;
+    
+    static SpirvOpLayout getLayout(
+            spv::Op         op,
+            uint32_t        length);
+    
+    static bool isPure(spv::Op op);
+    
+    static bool isBlockTerminator(spv::Op op);
+    
+  private:
+    
+    std::vector<uint32_t>     m_words;
+    std::vector<SpirvOptIns>  m_ins;
+    
+    uint32_t m_headerSize    = 0;
+    uint32_t m_functionBegin = 0;
+    uint32_t m_functionEnd   = 0;
+    uint32_t m_liveCount     = 0;
+    
+    std::unordered_map<uint32_t, uint32_t> m_defs;
+    std::unordered_map<uint32_t, uint32_t> m_replacements;
+    std::unordered_set<uint32_t>           m_removedIds;
+    
+    uint32_t addInstruction(
+            uint32_t        wordCount,
+      const uint32_t*       words);
+    
+  };
+  
+}
\ No newline at end of file
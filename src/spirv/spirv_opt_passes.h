@@ -0,0 +1,119 @@
+#pragma once
+
+#include "spirv_opt_module.h"
+
+namespace dxvk {
+  
+  /**
+   * \brief Optimization pass
+   */
+  class SpirvPass {
+    
+  public:
+    
+    virtual ~SpirvPass() { }
+    
+    /**
+     * \brief Runs the pass on a module
+     * \param [in] module The module
+     */
+    virtual void run(SpirvOptModule& module) = 0;
+    
+  };
+  
+  
+  /**
+   * \brief Variable promotion pass
+   * 
+   * Replaces private and function variables of scalar
+   * or vector type with SSA values if the variable is
+   * only loaded and stored within a single basic block.
+   * Loads that precede the first store produce an
+   * undefined value if the block can only run once.
+   */
+  class SpirvPromoteVariablesPass : public SpirvPass {
+    
+  public:
+    
+    void run(SpirvOptModule& module) final;
+    
+  private:
+    
+    bool isPromotable(
+            SpirvOptModule&   module,
+            uint32_t          varIndex);
+    
+    bool runsOnce(
+            SpirvOptModule&   module,
+            uint32_t          functionIndex,
+            uint32_t          depth);
+    
+    bool hasLoops(
+            SpirvOptModule&   module,
+            uint32_t          functionIndex);
+    
+  };
+  
+  
+  /**
+   * \brief Load/store elimination pass
+   * 
+   * Within each basic block, forwards stored values
+   * to subsequent loads from the same variable, reuses
+   * previously loaded values, and removes stores that
+   * are overwritten before the variable is read again.
+   */
+  class SpirvLoadStorePass : public SpirvPass {
+    
+  public:
+    
+    void run(SpirvOptModule& module) final;
+    
+  };
+  
+  
+  /**
+   * \brief Shuffle collapsing pass
+   * 
+   * Rewrites vector shuffles and composite extracts
+   * that operate on the results of other shuffles,
+   * inserts or constructs so that they reference the
+   * original vectors directly. Shuffles that reduce
+   * to the identity are removed.
+   */
+  class SpirvShufflePass : public SpirvPass {
+    
+  public:
+    
+    void run(SpirvOptModule& module) final;
+    
+  private:
+    
+    void collapseShuffle(
+            SpirvOptModule&   module,
+            uint32_t          index);
+    
+    void collapseExtract(
+            SpirvOptModule&   module,
+            uint32_t          index);
+    
+  };
+  
+  
+  /**
+   * \brief Dead code elimination pass
+   * 
+   * Removes instructions without side effects whose
+   * results are never used, as well as private and
+   * function variables that are written but never
+   * read, including all stores to them.
+   */
+  class SpirvDeadCodePass : public SpirvPass {
+    
+  public:
+    
+    void run(SpirvOptModule& module) final;
+    
+  };
+  
+}
\ No newline at end of file
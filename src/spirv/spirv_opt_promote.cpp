@@ -0,0 +1,249 @@
+#include "spirv_opt_passes.h"
+
+namespace dxvk {
+  
+  void SpirvPromoteVariablesPass::run(SpirvOptModule& module) {
+    struct VarInfo {
+      uint32_t varIndex;
+      uint32_t typeId;
+      uint32_t block     = SpirvOptModule::NoIns;
+      uint32_t function  = SpirvOptModule::NoIns;
+      bool     promote   = true;
+      bool     stored    = false;
+      bool     loadFirst = false;
+      bool     isGlobal  = false;
+    };
+    
+    std::unordered_map<uint32_t, VarInfo> vars;
+    
+    for (uint32_t i = 0; i < module.functionEnd(); i++) {
+      if (module.op(i) != spv::OpVariable || module.isRemoved(i))
+        continue;
+      
+      VarInfo info;
+      info.varIndex = i;
+      info.isGlobal = i < module.functionBegin();
+      
+      if (this->isPromotable(module, i))
+        vars.insert({ module.resultId(i), info });
+    }
+    
+    if (vars.size() == 0)
+      return;
+    
+    // Check how each variable is used. All uses must be
+    // plain loads and stores within the same basic block.
+    uint32_t function = SpirvOptModule::NoIns;
+    uint32_t block    = SpirvOptModule::NoIns;
+    
+    auto useVar = [&] (uint32_t id, bool isLoad, bool isStore) {
+      auto entry = vars.find(id);
+      
+      if (entry == vars.end())
+        return;
+      
+      VarInfo& info = entry->second;
+      
+      if (info.block == SpirvOptModule::NoIns) {
+        info.block    = block;
+        info.function = function;
+      }
+      
+      info.promote &= info.block == block && (isLoad || isStore);
+      info.loadFirst |= isLoad && !info.stored;
+      info.stored    |= isStore;
+    };
+    
+    for (uint32_t i = module.functionBegin(); i < module.functionEnd(); i++) {
+      if (module.isRemoved(i))
+        continue;
+      
+      switch (module.op(i)) {
+        case spv::OpFunction: function = i; break;
+        case spv::OpLabel:    block    = i; break;
+        
+        case spv::OpLoad:
+          useVar(module.arg(i, 3), module.length(i) == 4, false);
+          break;
+        
+        case spv::OpStore:
+          useVar(module.arg(i, 1), false, module.length(i) == 3);
+          useVar(module.arg(i, 2), false, false);
+          break;
+        
+        default:
+          module.forEachIdOperand(i, [&] (uint32_t& id) {
+            useVar(id, false, false);
+          });
+      }
+    }
+    
+    // Loads preceding the first store read the initial value
+    // of the variable, which is undefined as long as the
+    // block does not run more than once per invocation.
+    // Function variables are re-initialized on each call.
+    for (auto& pair : vars) {
+      VarInfo& info = pair.second;
+      
+      if (info.promote && info.loadFirst) {
+        info.promote = info.isGlobal
+          ? this->runsOnce(module, info.function, 0)
+          : !this->hasLoops(module, info.function);
+      }
+      
+      if (info.promote) {
+        uint32_t ptrType = module.getDef(module.typeId(info.varIndex));
+        info.typeId = module.arg(ptrType, 3);
+      }
+    }
+    
+    // Replace loads with the most recently stored value
+    std::unordered_map<uint32_t, uint32_t> values;
+    
+    for (uint32_t i = module.functionBegin(); i < module.functionEnd(); i++) {
+      if (module.isRemoved(i))
+        continue;
+      
+      const spv::Op op = module.op(i);
+      
+      if (op != spv::OpLoad && op != spv::OpStore)
+        continue;
+      
+      const uint32_t varId = module.arg(i, op == spv::OpLoad ? 3 : 1);
+      auto entry = vars.find(varId);
+      
+      if (entry == vars.end() || !entry->second.promote)
+        continue;
+      
+      if (op == spv::OpStore) {
+        values[varId] = module.resolve(module.arg(i, 2));
+      } else {
+        uint32_t& value = values[varId];
+        
+        if (value == 0)
+          value = module.defUndef(entry->second.typeId);
+        
+        module.replace(module.resultId(i), value);
+      }
+      
+      module.remove(i);
+    }
+    
+    for (const auto& pair : vars) {
+      if (pair.second.promote)
+        module.remove(pair.second.varIndex);
+    }
+  }
+  
+  
+  bool SpirvPromoteVariablesPass::isPromotable(
+          SpirvOptModule&   module,
+          uint32_t          varIndex) {
+    // Private variables are global, function variables
+    // must be declared within the function itself.
+    const uint32_t storageClass = module.arg(varIndex, 3);
+    const bool     isGlobal     = varIndex < module.functionBegin();
+    
+    if (isGlobal && storageClass != spv::StorageClassPrivate)
+      return false;
+    
+    if (!isGlobal && storageClass != spv::StorageClassFunction)
+      return false;
+    
+    // Variables with an initializer are not supported
+    if (module.length(varIndex) != 4)
+      return false;
+    
+    const uint32_t ptrType = module.getDef(module.typeId(varIndex));
+    
+    if (ptrType == SpirvOptModule::NoIns
+     || module.op(ptrType) != spv::OpTypePointer)
+      return false;
+    
+    const uint32_t valueType = module.getDef(module.arg(ptrType, 3));
+    
+    if (valueType == SpirvOptModule::NoIns)
+      return false;
+    
+    switch (module.op(valueType)) {
+      case spv::OpTypeBool:
+      case spv::OpTypeInt:
+      case spv::OpTypeFloat:
+      case spv::OpTypeVector:
+        return true;
+      
+      default:
+        return false;
+    }
+  }
+  
+  
+  bool SpirvPromoteVariablesPass::runsOnce(
+          SpirvOptModule&   module,
+          uint32_t          functionIndex,
+          uint32_t          depth) {
+    if (functionIndex == SpirvOptModule::NoIns || depth > 16)
+      return false;
+    
+    // Blocks inside loops may run multiple times
+    if (this->hasLoops(module, functionIndex))
+      return false;
+    
+    const uint32_t functionId = module.resultId(functionIndex);
+    
+    // Entry points run once per invocation, other functions
+    // must be called at most once from a function that also
+    // runs at most once.
+    for (uint32_t i = 0; i < module.functionBegin(); i++) {
+      if (module.op(i) == spv::OpEntryPoint
+       && module.arg(i, 2) == functionId)
+        return true;
+    }
+    
+    uint32_t callCount = 0;
+    uint32_t caller    = SpirvOptModule::NoIns;
+    uint32_t function  = SpirvOptModule::NoIns;
+    
+    for (uint32_t i = module.functionBegin(); i < module.functionEnd(); i++) {
+      if (module.isRemoved(i))
+        continue;
+      
+      if (module.op(i) == spv::OpFunction)
+        function = i;
+      
+      if (module.op(i) == spv::OpFunctionCall
+       && module.arg(i, 3) == functionId) {
+        callCount += 1;
+        caller = function;
+      }
+    }
+    
+    if (callCount == 0)
+      return true;
+    
+    return callCount == 1
+      && caller != functionIndex
+      && this->runsOnce(module, caller, depth + 1);
+  }
+  
+  
+  bool SpirvPromoteVariablesPass::hasLoops(
+          SpirvOptModule&   module,
+          uint32_t          functionIndex) {
+    if (functionIndex == SpirvOptModule::NoIns)
+      return true;
+    
+    for (uint32_t i = functionIndex; i < module.functionEnd(); i++) {
+      const spv::Op op = module.op(i);
+      
+      if (op == spv::OpLoopMerge)
+        return true;
+      
+      if (op == spv::OpFunctionEnd)
+        break;
+    }
+    
+    return false;
+  }
+  
+}
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include <array>
+
+#include "spirv_opt_passes.h"
+
+namespace dxvk {
+  
+  void SpirvShufflePass::run(SpirvOptModule& module) {
+    for (uint32_t i = module.functionBegin(); i < module.functionEnd(); i++) {
+      if (module.isRemoved(i))
+        continue;
+      
+      switch (module.op(i)) {
+        case spv::OpVectorShuffle:
+          this->collapseShuffle(module, i);
+          break;
+        
+        case spv::OpCompositeExtract:
+          this->collapseExtract(module, i);
+          break;
+        
+        default:
+          break;
+      }
+    }
+  }
+  
+  
+  void SpirvShufflePass::collapseShuffle(
+          SpirvOptModule&   module,
+          uint32_t          index) {
+    const uint32_t componentCount = module.length(index) - 5;
+    
+    if (componentCount > 4)
+      return;
+    
+    // Shuffles that return their first operand as-is
+    // can be removed without looking at other shuffles
+    const uint32_t vec1 = module.resolve(module.arg(index, 3));
+    
+    bool isIdentity = module.getTypeOf(vec1) == module.typeId(index);
+    
+    for (uint32_t i = 0; i < componentCount; i++)
+      isIdentity &= module.arg(index, 5 + i) == i;
+    
+    if (isIdentity) {
+      module.replace(module.resultId(index), vec1);
+      module.remove(index);
+      return;
+    }
+    
+    // Find the original vector and component index
+    // for each component of the shuffle result
+    std::array<uint32_t, 4> srcVectors;
+    std::array<uint32_t, 4> srcIndices;
+    
+    for (uint32_t i = 0; i < componentCount; i++) {
+      uint32_t srcVec1 = vec1;
+      uint32_t srcVec2 = module.resolve(module.arg(index, 4));
+      uint32_t comp    = module.arg(index, 5 + i);
+      
+      for (uint32_t depth = 0; depth < 16; depth++) {
+        if (comp == 0xFFFFFFFFu)
+          break;
+        
+        const uint32_t size1 = module.getVectorSize(module.getTypeOf(srcVec1));
+        
+        if (size1 == 0)
+          return;
+        
+        srcVectors[i] = comp < size1 ? srcVec1 : srcVec2;
+        srcIndices[i] = comp < size1 ? comp : comp - size1;
+        
+        const uint32_t def = module.getDef(srcVectors[i]);
+        
+        if (def == SpirvOptModule::NoIns
+         || module.op(def) != spv::OpVectorShuffle)
+          break;
+        
+        srcVec1 = module.resolve(module.arg(def, 3));
+        srcVec2 = module.resolve(module.arg(def, 4));
+        comp    = module.arg(def, 5 + srcIndices[i]);
+      }
+      
+      // Undefined components can be taken from any vector
+      if (comp == 0xFFFFFFFFu) {
+        srcVectors[i] = 0;
+        srcIndices[i] = comp;
+      }
+    }
+    
+    // Only rewrite the shuffle if it can still
+    // reference all components directly
+    std::array<uint32_t, 2> vectors = { 0, 0 };
+    uint32_t vectorCount = 0;
+    
+    for (uint32_t i = 0; i < componentCount; i++) {
+      if (srcVectors[i] == 0
+       || srcVectors[i] == vectors[0]
+       || srcVectors[i] == vectors[1])
+        continue;
+      
+      if (vectorCount == vectors.size())
+        return;
+      
+      vectors[vectorCount++] = srcVectors[i];
+    }
+    
+    if (vectorCount == 0)
+      return;
+    
+    if (vectorCount == 1)
+      vectors[1] = vectors[0];
+    
+    const uint32_t size1 = module.getVectorSize(module.getTypeOf(vectors[0]));
+    
+    if (size1 == 0)
+      return;
+    
+    // Check whether the shuffle returns the original vector
+    isIdentity = vectorCount == 1
+      && module.getTypeOf(vectors[0]) == module.typeId(index);
+    
+    for (uint32_t i = 0; i < componentCount; i++)
+      isIdentity &= srcVectors[i] == vectors[0] && srcIndices[i] == i;
+    
+    if (isIdentity) {
+      module.replace(module.resultId(index), vectors[0]);
+      module.remove(index);
+      return;
+    }
+    
+    SpirvInstruction ins = module.ins(index);
+    ins.setArg(3, vectors[0]);
+    ins.setArg(4, vectors[1]);
+    
+    for (uint32_t i = 0; i < componentCount; i++) {
+      uint32_t comp = srcIndices[i];
+      
+      if (srcVectors[i] != 0 && srcVectors[i] != vectors[0])
+        comp += size1;
+      
+      ins.setArg(5 + i, comp);
+    }
+  }
+  
+  
+  void SpirvShufflePass::collapseExtract(
+          SpirvOptModule&   module,
+          uint32_t          index) {
+    if (module.length(index) != 5)
+      return;
+    
+    uint32_t composite = module.resolve(module.arg(index, 3));
+    uint32_t member    = module.arg(index, 4);
+    uint32_t value     = 0;
+    
+    for (uint32_t depth = 0; depth < 16 && value == 0; depth++) {
+      const uint32_t def = module.getDef(composite);
+      
+      if (def == SpirvOptModule::NoIns)
+        break;
+      
+      const spv::Op op = module.op(def);
+      
+      if (op == spv::OpVectorShuffle) {
+        const uint32_t vec1  = module.resolve(module.arg(def, 3));
+        const uint32_t vec2  = module.resolve(module.arg(def, 4));
+        const uint32_t comp  = module.arg(def, 5 + member);
+        const uint32_t size1 = module.getVectorSize(module.getTypeOf(vec1));
+        
+        if (comp == 0xFFFFFFFFu || size1 == 0)
+          break;
+        
+        composite = comp < size1 ? vec1 : vec2;
+        member    = comp < size1 ? comp : comp - size1;
+      } else if (op == spv::OpCompositeInsert && module.length(def) == 6) {
+        if (module.arg(def, 5) == member)
+          value = module.resolve(module.arg(def, 3));
+        else
+          composite = module.resolve(module.arg(def, 4));
+      } else if (op == spv::OpCompositeConstruct) {
+        // Only handle vectors built from scalars, since
+        // constituents may be vectors themselves
+        const uint32_t size = module.getVectorSize(module.typeId(def));
+        
+        if (size == 0 || module.length(def) != 3 + size)
+          break;
+        
+        value = module.resolve(module.arg(def, 3 + member));
+      } else {
+        break;
+      }
+    }
+    
+    if (value != 0) {
+      module.replace(module.resultId(index), value);
+      module.remove(index);
+    } else {
+      SpirvInstruction ins = module.ins(index);
+      ins.setArg(3, composite);
+      ins.setArg(4, member);
+    }
+  }
+  
+}
\ No newline at end of file
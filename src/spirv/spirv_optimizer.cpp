@@ -0,0 +1,116 @@
+#include <sstream>
+
+#include "spirv_optimizer.h"
+
+namespace dxvk {
+  
+  std::mutex    SpirvOptimizer::s_totalMutex;
+  SpirvOptStats SpirvOptimizer::s_totalStats;
+  
+  
+  SpirvOptimizer::SpirvOptimizer(SpirvOptPasses passes)
+  : m_passes(passes) {
+    
+  }
+  
+  
+  SpirvOptimizer::~SpirvOptimizer() {
+    
+  }
+  
+  
+  SpirvCodeBuffer SpirvOptimizer::optimize(
+    const SpirvCodeBuffer& code) {
+    m_stats = SpirvOptStats();
+    
+    if (m_passes.isClear())
+      return code;
+    
+    SpirvOptModule module(code);
+    
+    if (!module.isSupported())
+      return code;
+    
+    SpirvPromoteVariablesPass promotePass;
+    SpirvLoadStorePass        loadStorePass;
+    SpirvShufflePass          shufflePass;
+    SpirvDeadCodePass         deadCodePass;
+    
+    const std::array<SpirvPass*, SpirvOptPassCount> passes = {
+      &promotePass, &loadStorePass, &shufflePass, &deadCodePass,
+    };
+    
+    for (uint32_t i = 0; i < SpirvOptPassCount; i++) {
+      if (!m_passes.test(SpirvOptPass(i)))
+        continue;
+      
+      m_stats[i].insBefore = module.liveCount();
+      passes[i]->run(module);
+      module.applyReplacements();
+      m_stats[i].insAfter  = module.liveCount();
+    }
+    
+    { std::lock_guard<std::mutex> lock(s_totalMutex);
+      
+      for (uint32_t i = 0; i < SpirvOptPassCount; i++) {
+        s_totalStats[i].insBefore += m_stats[i].insBefore;
+        s_totalStats[i].insAfter  += m_stats[i].insAfter;
+      }
+    }
+    
+    return module.compile();
+  }
+  
+  
+  SpirvOptStats SpirvOptimizer::totalStats() {
+    std::lock_guard<std::mutex> lock(s_totalMutex);
+    return s_totalStats;
+  }
+  
+  
+  const char* SpirvOptimizer::passName(SpirvOptPass pass) {
+    switch (pass) {
+      case SpirvOptPass::PromoteVariables:   return "promote";
+      case SpirvOptPass::EliminateLoadStore: return "loadstore";
+      case SpirvOptPass::CollapseShuffles:   return "shuffle";
+      case SpirvOptPass::EliminateDeadCode:  return "dce";
+    }
+    
+    return "unknown";
+  }
+  
+  
+  SpirvOptPasses SpirvOptimizer::parsePassList(
+    const std::string& list) {
+    SpirvOptPasses result;
+    
+    if (list.empty()) {
+      for (uint32_t i = 0; i < SpirvOptPassCount; i++)
+        result.set(SpirvOptPass(i));
+      return result;
+    }
+    
+    std::stringstream stream(list);
+    std::string name;
+    
+    while (std::getline(stream, name, ',')) {
+      if (name.empty() || name == "none")
+        continue;
+      
+      bool found = false;
+      
+      for (uint32_t i = 0; i < SpirvOptPassCount && !found; i++) {
+        if (name == passName(SpirvOptPass(i))) {
+          result.set(SpirvOptPass(i));
+          found = true;
+        }
+      }
+      
+      if (!found)
+        Logger::warn(str::format("SpirvOptimizer: Unknown pass: ", name));
+    }
+    
+    return result;
+  }
+  
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+
+#include "spirv_opt_passes.h"
+
+namespace dxvk {
+  
+  /**
+   * \brief Optimization passes
+   */
+  enum class SpirvOptPass : uint32_t {
+    PromoteVariables    = 0,
+    EliminateLoadStore  = 1,
+    CollapseShuffles    = 2,
+    EliminateDeadCode   = 3,
+  };
+  
+  using SpirvOptPasses = Flags<SpirvOptPass>;
+  
+  constexpr uint32_t SpirvOptPassCount = 4;
+  
+  
+  /**
+   * \brief Pass statistics
+   * 
+   * Number of live instructions in the module
+   * before and after running a given pass.
+   */
+  struct SpirvOptPassStats {
+    uint64_t insBefore = 0;
+    uint64_t insAfter  = 0;
+  };
+  
+  using SpirvOptStats = std::array<SpirvOptPassStats, SpirvOptPassCount>;
+  
+  
+  /**
+   * \brief SPIR-V optimizer
+   * 
+   * Runs a fixed sequence of passes on generated
+   * code. Passes are run in the order in which
+   * they are declared in \ref SpirvOptPass.
+   */
+  class SpirvOptimizer {
+    
+  public:
+    
+    SpirvOptimizer(SpirvOptPasses passes);
+    ~SpirvOptimizer();
+    
+    /**
+     * \brief Optimizes a module
+     * 
+     * Returns the code unmodified if the
+     * module uses unsupported instructions.
+     * \param [in] code The code to optimize
+     * \returns Optimized code
+     */
+    SpirvCodeBuffer optimize(
+      const SpirvCodeBuffer& code);
+    
+    /**
+     * \brief Statistics of the last module
+     * \returns Instruction counts per pass
+     */
+    const SpirvOptStats& stats() const {
+      return m_stats;
+    }
+    
+    /**
+     * \brief Accumulated statistics
+     * 
+     * Sum of the statistics of all modules
+     * optimized by any optimizer instance.
+     * \returns Instruction counts per pass
+     */
+    static SpirvOptStats totalStats();
+    
+    /**
+     * \brief Pass name
+     * 
+     * \param [in] pass The pass
+     * \returns Name as used in pass lists
+     */
+    static const char* passName(SpirvOptPass pass);
+    
+    /**
+     * \brief Parses a comma-separated pass list
+     * 
+     * An empty string enables all passes, and
+     * \c none disables all passes. Unknown pass
+     * names are ignored with a warning.
+     * \param [in] list Pass list
+     * \returns Enabled passes
+     */
+    static SpirvOptPasses parsePassList(
+      const std::string& list);
+    
+  private:
+    
+    SpirvOptPasses m_passes;
+    SpirvOptStats  m_stats;
+    
+    static std::mutex    s_totalMutex;
+    static SpirvOptStats s_totalStats;
+    
+  };
+  
+}
\ No newline at end of file
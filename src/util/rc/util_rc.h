@@ -27,6 +27,18 @@ namespace dxvk {
       return --m_refCount;
     }
     
+    /**
+     * \brief Queries reference count
+     * 
+     * The result is only reliable if no other
+     * thread can acquire a new reference to
+     * the object while this is being called.
+     * \returns Current reference count
+     */
+    uint32_t refCount() const {
+      return m_refCount.load();
+    }
+    
   private:
     
     std::atomic<uint32_t> m_refCount = { 0u };
@@ -18,13 +18,31 @@ namespace dxvk {
     
     std::string toString() const;
     
+    const Sha1Digest& digest() const {
+      return m_digest;
+    }
+    
+    size_t hash() const {
+      size_t result;
+      std::memcpy(&result, m_digest.data(), sizeof(result));
+      return result;
+    }
+    
+    bool operator == (const Sha1Hash& other) const {
+      return m_digest == other.m_digest;
+    }
+    
+    bool operator != (const Sha1Hash& other) const {
+      return m_digest != other.m_digest;
+    }
+    
     static Sha1Hash compute(
       const uint8_t*  data,
             size_t    size);
     
   private:
     
-    Sha1Digest m_digest;
+    Sha1Digest m_digest = { };
     
   };
   
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace dxvk {
+  
+  /**
+   * \brief Read-mostly hash map
+   * 
+   * Open-addressing hash table which supports lookups
+   * without taking any locks. Entries are published
+   * atomically and never modified or removed once they
+   * have been added, so readers always observe either
+   * a fully initialized entry or an empty slot.
+   * 
+   * When the table needs to grow, a larger copy is
+   * created and published, and the old table is kept
+   * alive until the map gets destroyed so that readers
+   * which still access it remain valid.
+   * 
+   * Insertions must be serialized by the caller, which
+   * typically needs to hold a lock anyway in order to
+   * create the value for a key that was not found.
+   * \tparam K Key type
+   * \tparam V Value type
+   * \tparam Hash Hash function for keys
+   * \tparam Eq Equality function for keys
+   */
+  template<typename K, typename V,
+    typename Hash = std::hash<K>,
+    typename Eq   = std::equal_to<K>>
+  class ReadMostlyMap {
+    constexpr static size_t InitialCapacity = 64;
+  public:
+    
+    ReadMostlyMap() {
+      m_tables.emplace_back(new Table(InitialCapacity));
+      m_table.store(m_tables.back().get());
+    }
+    
+    ReadMostlyMap             (const ReadMostlyMap&) = delete;
+    ReadMostlyMap& operator = (const ReadMostlyMap&) = delete;
+    
+    /**
+     * \brief Looks up an entry
+     * 
+     * Wait-free. May be called from any thread,
+     * even while another thread inserts entries.
+     * \param [in] key The key to look up
+     * \param [out] value Value, if found
+     * \returns \c true if the key was found
+     */
+    bool find(const K& key, V& value) const {
+      const Table* table = m_table.load(std::memory_order_acquire);
+      
+      const size_t hash = m_hash(key);
+      
+      for (size_t i = 0; i <= table->mask; i++) {
+        const Entry& entry = table->entries[(hash + i) & table->mask];
+        
+        if (!entry.valid.load(std::memory_order_acquire))
+          return false;
+        
+        if (m_eq(entry.key, key)) {
+          value = entry.value;
+          return true;
+        }
+      }
+      
+      return false;
+    }
+    
+    /**
+     * \brief Adds an entry
+     * 
+     * The key must not already be present in the
+     * map. Calls to this method must be serialized.
+     * \param [in] key The key
+     * \param [in] value The value
+     */
+    void insert(const K& key, const V& value) {
+      Table* table = m_table.load(std::memory_order_relaxed);
+      
+      // Keep the load factor below one half so
+      // that probe sequences remain short
+      if (2 * (table->count + 1) > table->mask + 1) {
+        Table* newTable = new Table(2 * (table->mask + 1));
+        
+        for (size_t i = 0; i <= table->mask; i++) {
+          const Entry& entry = table->entries[i];
+          
+          if (entry.valid.load(std::memory_order_relaxed))
+            insertEntry(newTable, entry.key, entry.value);
+        }
+        
+        m_tables.emplace_back(newTable);
+        m_table.store(newTable, std::memory_order_release);
+        table = newTable;
+      }
+      
+      insertEntry(table, key, value);
+    }
+    
+    /**
+     * \brief Iterates over all entries
+     * 
+     * Must not be called concurrently with \ref insert.
+     * \param [in] fn Function taking a key and a value
+     */
+    template<typename Fn>
+    void forEach(const Fn& fn) const {
+      const Table* table = m_table.load(std::memory_order_acquire);
+      
+      for (size_t i = 0; i <= table->mask; i++) {
+        const Entry& entry = table->entries[i];
+        
+        if (entry.valid.load(std::memory_order_acquire))
+          fn(entry.key, entry.value);
+      }
+    }
+    
+  private:
+    
+    struct Entry {
+      std::atomic<bool> valid = { false };
+      K                 key;
+      V                 value;
+    };
+    
+    struct Table {
+      Table(size_t capacity)
+      : mask(capacity - 1), entries(new Entry[capacity]) { }
+      
+      size_t                   mask;
+      size_t                   count = 0;
+      std::unique_ptr<Entry[]> entries;
+    };
+    
+    Hash m_hash;
+    Eq   m_eq;
+    
+    std::atomic<Table*>                 m_table = { nullptr };
+    std::vector<std::unique_ptr<Table>> m_tables;
+    
+    void insertEntry(Table* table, const K& key, const V& value) {
+      size_t index = m_hash(key) & table->mask;
+      
+      while (table->entries[index].valid.load(std::memory_order_relaxed))
+        index = (index + 1) & table->mask;
+      
+      Entry& entry = table->entries[index];
+      entry.key   = key;
+      entry.value = value;
+      entry.valid.store(true, std::memory_order_release);
+      
+      table->count += 1;
+    }
+    
+  };
+  
+}
\ No newline at end of file
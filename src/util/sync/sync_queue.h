@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace dxvk {
+  
+  /**
+   * \brief Lock-free bounded queue
+   * 
+   * Multi-producer, single-consumer ring buffer. Each
+   * cell stores a sequence number which producers and
+   * the consumer use to determine whether the cell can
+   * be written to or read from, so that no locks need
+   * to be taken on either side.
+   * \tparam T Type of the queue entries
+   * \tparam N Capacity, must be a power of two
+   */
+  template<typename T, size_t N>
+  class LockFreeQueue {
+    static_assert((N & (N - 1)) == 0, "LockFreeQueue: Capacity must be a power of two");
+  public:
+    
+    LockFreeQueue() {
+      for (size_t i = 0; i < N; i++)
+        m_cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+    
+    LockFreeQueue             (const LockFreeQueue&) = delete;
+    LockFreeQueue& operator = (const LockFreeQueue&) = delete;
+    
+    /**
+     * \brief Adds an entry to the queue
+     * 
+     * May be called from any thread.
+     * \param [in] entry The entry to add
+     * \returns \c false if the queue is full
+     */
+    bool push(T&& entry) {
+      size_t pos = m_enqPos.load(std::memory_order_relaxed);
+      Cell*  cell;
+      
+      while (true) {
+        cell = &m_cells[pos & (N - 1)];
+        
+        size_t seq  = cell->seq.load(std::memory_order_acquire);
+        auto   diff = static_cast<std::ptrdiff_t>(seq - pos);
+        
+        if (diff == 0) {
+          if (m_enqPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            break;
+        } else if (diff < 0) {
+          return false;
+        } else {
+          pos = m_enqPos.load(std::memory_order_relaxed);
+        }
+      }
+      
+      cell->data = std::move(entry);
+      cell->seq.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+    
+    /**
+     * \brief Removes the oldest entry from the queue
+     * 
+     * Must only be called from the consumer thread.
+     * \param [out] entry The entry that was removed
+     * \returns \c false if the queue is empty
+     */
+    bool pop(T& entry) {
+      Cell* cell = &m_cells[m_deqPos & (N - 1)];
+      
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      
+      if (seq != m_deqPos + 1)
+        return false;
+      
+      entry = std::move(cell->data);
+      cell->data = T();
+      cell->seq.store(m_deqPos + N, std::memory_order_release);
+      
+      m_deqPos += 1;
+      return true;
+    }
+    
+  private:
+    
+    struct Cell {
+      std::atomic<size_t> seq;
+      T                   data;
+    };
+    
+    std::array<Cell, N> m_cells;
+    
+    std::atomic<size_t> m_enqPos = { 0 };
+    size_t              m_deqPos = 0;
+    
+  };
+  
+}
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 namespace dxvk::bit {
   
   template<typename T>
@@ -23,4 +26,68 @@ namespace dxvk::bit {
     return result;
   }
   
+  
+  /**
+   * \brief Bit vector
+   * 
+   * Stores an arbitrary number of bits in 32-bit
+   * words. Useful to track dirty state for a large
+   * number of slots without having to scan them all.
+   */
+  class BitVector {
+    
+  public:
+    
+    BitVector() { }
+    BitVector(size_t n)
+    : m_words((n + 31) / 32, 0u) { }
+    
+    bool get(uint32_t idx) const {
+      return (m_words[idx / 32] >> (idx % 32)) & 1u;
+    }
+    
+    void set(uint32_t idx) {
+      m_words[idx / 32] |= 1u << (idx % 32);
+    }
+    
+    void clr(uint32_t idx) {
+      m_words[idx / 32] &= ~(1u << (idx % 32));
+    }
+    
+    void clrAll() {
+      for (auto& word : m_words)
+        word = 0u;
+    }
+    
+    bool any() const {
+      for (auto word : m_words) {
+        if (word != 0u)
+          return true;
+      }
+      
+      return false;
+    }
+    
+    /**
+     * \brief Calls a function for each set bit
+     * \param [in] fn Function taking the bit index
+     */
+    template<typename Fn>
+    void forEach(const Fn& fn) const {
+      for (uint32_t i = 0; i < m_words.size(); i++) {
+        uint32_t word = m_words[i];
+        
+        while (word != 0u) {
+          fn(32 * i + tzcnt(word));
+          word &= word - 1;
+        }
+      }
+    }
+    
+  private:
+    
+    std::vector<uint32_t> m_words;
+    
+  };
+  
 }
\ No newline at end of file
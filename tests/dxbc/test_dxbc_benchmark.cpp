@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <fstream>
+
+#include <dxbc_compiler.h>
+#include <dxbc_module.h>
+#include <dxvk_shader.h>
+
+#include <shellapi.h>
+#include <windows.h>
+#include <windowsx.h>
+
+namespace dxvk {
+  Logger Logger::s_instance("dxbc-benchmark.log");
+}
+
+using namespace dxvk;
+
+// Compiles a set of DXBC shaders repeatedly and reports the
+// average compile time and the size of the generated SPIR-V.
+// Run builds of different revisions against the same set of
+// shaders in order to compare compiler performance.
+int WINAPI WinMain(HINSTANCE hInstance,
+                   HINSTANCE hPrevInstance,
+                   LPSTR lpCmdLine,
+                   int nCmdShow) {
+  int     argc = 0;
+  LPWSTR* argv = CommandLineToArgvW(
+    GetCommandLineW(), &argc);  
+  
+  if (argc < 3) {
+    Logger::err("Usage: dxbc-benchmark iterations input1.dxbc [input2.dxbc ...]");
+    return 1;
+  }
+  
+  const uint32_t iterations = std::max(1ul,
+    std::strtoul(str::fromws(argv[1]).c_str(), nullptr, 10));
+  
+  using Clock = std::chrono::high_resolution_clock;
+  
+  uint64_t totalTimeUs  = 0;
+  uint64_t totalDwords  = 0;
+  uint64_t totalSpvSize = 0;
+  
+  try {
+    for (int i = 2; i < argc; i++) {
+      const std::string fileName = str::fromws(argv[i]);
+      
+      std::ifstream ifile(fileName, std::ios::binary);
+      ifile.ignore(std::numeric_limits<std::streamsize>::max());
+      std::streamsize length = ifile.gcount();
+      ifile.clear();
+      
+      ifile.seekg(0, std::ios_base::beg);
+      std::vector<char> dxbcCode(length);
+      ifile.read(dxbcCode.data(), length);
+      
+      DxbcReader reader(dxbcCode.data(), dxbcCode.size());
+      DxbcModule module(reader);
+      
+      Rc<DxvkShader> shader;
+      
+      const auto t0 = Clock::now();
+      
+      for (uint32_t n = 0; n < iterations; n++)
+        shader = module.compile();
+      
+      const auto t1 = Clock::now();
+      
+      const uint64_t timeUs = std::chrono::duration_cast<
+        std::chrono::microseconds>(t1 - t0).count() / iterations;
+      
+      Logger::info(str::format(fileName, ": ",
+        timeUs, " us, ", dxbcCode.size() / sizeof(uint32_t), " DWORDs -> ",
+        shader->code().size() / sizeof(uint32_t), " SPIR-V words"));
+      
+      totalTimeUs  += timeUs;
+      totalDwords  += dxbcCode.size() / sizeof(uint32_t);
+      totalSpvSize += shader->code().size() / sizeof(uint32_t);
+    }
+  } catch (const DxvkError& e) {
+    Logger::err(e.message());
+    return 1;
+  }
+  
+  Logger::info(str::format("Total: ", totalTimeUs, " us for ",
+    argc - 2, " shaders, ", totalDwords, " DWORDs -> ",
+    totalSpvSize, " SPIR-V words"));
+  
+  // Instruction counts are summed up over all iterations
+  const SpirvOptStats optStats = SpirvOptimizer::totalStats();
+  
+  for (uint32_t i = 0; i < SpirvOptPassCount; i++) {
+    Logger::info(str::format("Pass ",
+      SpirvOptimizer::passName(SpirvOptPass(i)), ": ",
+      optStats[i].insBefore / iterations, " -> ",
+      optStats[i].insAfter  / iterations, " instructions"));
+  }
+  
+  return 0;
+}
\ No newline at end of file
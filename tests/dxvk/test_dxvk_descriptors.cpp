@@ -0,0 +1,144 @@
+#include <dxvk_device.h>
+#include <dxvk_instance.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <windows.h>
+#include <windowsx.h>
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-descriptors.log");
+}
+
+using namespace dxvk;
+
+// Number of draws between command list resets. Each draw
+// uses different descriptors, so no set is ever reused.
+// Storage buffers are used since uniform buffers may use
+// dynamic offsets, which would make all sets identical.
+const uint32_t drawsPerList = 1024;
+const uint32_t listCount    = 64;
+
+Rc<DxvkBindingLayout> createLayout(
+  const Rc<DxvkDevice>&       device,
+  const DxvkDeviceExtensions& extensions,
+        uint32_t              bindingCount) {
+  DxvkDescriptorSlotMapping slotMapping;
+  
+  for (uint32_t i = 0; i < bindingCount; i++) {
+    slotMapping.defineSlot(i,
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+      VK_SHADER_STAGE_VERTEX_BIT);
+  }
+  
+  slotMapping.assignDescriptorSets();
+  
+  return new DxvkBindingLayout(device->vkd(), extensions,
+    slotMapping.bindingCount(), slotMapping.bindingInfos());
+}
+
+double measure(
+  const Rc<DxvkDevice>&         device,
+  const Rc<DxvkBindingLayout>&  layout,
+  const Rc<DxvkBuffer>&         buffer) {
+  Rc<DxvkCommandList> cmdList = device->createCommandList();
+  
+  std::vector<DxvkDescriptorInfo> infos(layout->bindingCount());
+  
+  for (auto& info : infos) {
+    info.buffer.buffer = buffer->handle();
+    info.buffer.range  = 256;
+  }
+  
+  std::chrono::high_resolution_clock::duration time(0);
+  
+  const bool usePush = layout->pushDescriptorSet() == 0;
+  
+  for (uint32_t l = 0; l < listCount; l++) {
+    cmdList->beginRecording();
+    
+    auto t0 = std::chrono::high_resolution_clock::now();
+    
+    for (uint32_t i = 0; i < drawsPerList; i++) {
+      for (uint32_t j = 0; j < infos.size(); j++)
+        infos[j].buffer.offset = 256 * ((i * infos.size() + j) % 4096);
+      
+      if (usePush) {
+        cmdList->pushDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS,
+          *layout, 0, infos.data());
+      } else {
+        cmdList->updateDescriptorSet(*layout, 0, infos.data());
+      }
+    }
+    
+    auto t1 = std::chrono::high_resolution_clock::now();
+    time += t1 - t0;
+    
+    cmdList->endRecording();
+    cmdList->reset();
+  }
+  
+  return std::chrono::duration<double, std::nano>(time).count()
+    / double(listCount * drawsPerList);
+}
+
+int WINAPI WinMain(HINSTANCE hInstance,
+                   HINSTANCE hPrevInstance,
+                   LPSTR lpCmdLine,
+                   int nCmdShow) {
+  try {
+    VkPhysicalDeviceFeatures features;
+    std::memset(&features, 0, sizeof(features));
+    
+    Rc<DxvkInstance> instance = new DxvkInstance();
+    Rc<DxvkAdapter>  adapter  = instance->enumAdapters().at(0);
+    Rc<DxvkDevice>   device   = adapter->createDevice(features);
+    
+    DxvkBufferCreateInfo bufferInfo;
+    bufferInfo.size   = 256 * 4096;
+    bufferInfo.usage  = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferInfo.stages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+    bufferInfo.access = VK_ACCESS_SHADER_READ_BIT;
+    
+    Rc<DxvkBuffer> buffer = device->createBuffer(
+      bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    
+    // The fallback paths are used when the
+    // extensions are not available
+    DxvkDeviceExtensions templateExtensions = device->extensions();
+    templateExtensions.khrPushDescriptor = false;
+    
+    DxvkDeviceExtensions fallbackExtensions = templateExtensions;
+    fallbackExtensions.khrDescriptorUpdateTemplate = false;
+    
+    if (!device->extensions().khrDescriptorUpdateTemplate)
+      std::cout << "Update templates not supported" << std::endl;
+    
+    if (!device->extensions().khrPushDescriptor)
+      std::cout << "Push descriptors not supported" << std::endl;
+    
+    std::cout << "Bindings | Push (ns/draw) | Template (ns/draw) | Writes (ns/draw)" << std::endl;
+    
+    for (uint32_t bindingCount = 1; bindingCount <= 32; bindingCount *= 2) {
+      auto pushLayout     = createLayout(device, device->extensions(), bindingCount);
+      auto templateLayout = createLayout(device, templateExtensions,   bindingCount);
+      auto fallbackLayout = createLayout(device, fallbackExtensions,   bindingCount);
+      
+      // Large sets do not use push descriptors
+      double pushTime     = measure(device, pushLayout,     buffer);
+      double templateTime = measure(device, templateLayout, buffer);
+      double fallbackTime = measure(device, fallbackLayout, buffer);
+      
+      std::cout << bindingCount << " | " << pushTime << " | "
+                << templateTime << " | " << fallbackTime << std::endl;
+    }
+    
+    return 0;
+  } catch (const DxvkError& e) {
+    Logger::err(e.message());
+    return 1;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include <dxvk_graphics.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include <windows.h>
+#include <windowsx.h>
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-pipeline-state.log");
+}
+
+using namespace dxvk;
+
+// Emulates the previous lookup scheme, which used a
+// constant hash and compared the entire state info
+struct LegacyStateHash {
+  size_t operator () (const DxvkGraphicsPipelineStateInfo& state) const {
+    return 0;
+  }
+};
+
+struct LegacyStateEq {
+  bool operator () (
+    const DxvkGraphicsPipelineStateInfo& a,
+    const DxvkGraphicsPipelineStateInfo& b) const {
+    return std::memcmp(&a, &b, sizeof(DxvkGraphicsPipelineStateInfo)) == 0;
+  }
+};
+
+DxvkGraphicsPipelineStateInfo createState(uint32_t variant) {
+  DxvkGraphicsPipelineStateInfo state;
+  state.iaPrimitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  state.ilAttributeCount    = 3;
+  state.ilBindingCount      = 1;
+  
+  for (uint32_t i = 0; i < state.ilAttributeCount; i++) {
+    state.ilAttributes[i].location = i;
+    state.ilAttributes[i].binding  = 0;
+    state.ilAttributes[i].format   = VK_FORMAT_R32G32B32A32_SFLOAT;
+    state.ilAttributes[i].offset   = 16 * i;
+  }
+  
+  state.ilBindings[0].binding   = 0;
+  state.ilBindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+  state.ilBindings[0].stride    = 48 + 4 * (variant % 64);
+  
+  state.rsPolygonMode     = VK_POLYGON_MODE_FILL;
+  state.rsCullMode        = VK_CULL_MODE_BACK_BIT;
+  state.rsFrontFace       = VK_FRONT_FACE_CLOCKWISE;
+  state.rsViewportCount   = 1;
+  state.msSampleCount     = VK_SAMPLE_COUNT_1_BIT;
+  state.msSampleMask      = 0xFFFFFFFF;
+  state.dsEnableDepthTest = VK_TRUE;
+  state.dsDepthCompareOp  = VkCompareOp(variant / 64 % 8);
+  
+  state.omBlendAttachments[0].blendEnable         = VK_TRUE;
+  state.omBlendAttachments[0].srcColorBlendFactor = VkBlendFactor(variant / 512 % 8);
+  state.omBlendAttachments[0].dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+  state.omBlendAttachments[0].colorWriteMask      = 0xF;
+  return state;
+}
+
+template<typename Fn>
+double measure(uint32_t iterations, const Fn& fn) {
+  auto t0 = std::chrono::high_resolution_clock::now();
+  
+  for (uint32_t i = 0; i < iterations; i++)
+    fn(i);
+  
+  auto t1 = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+}
+
+int WINAPI WinMain(HINSTANCE hInstance,
+                   HINSTANCE hPrevInstance,
+                   LPSTR lpCmdLine,
+                   int nCmdShow) {
+  const uint32_t iterations = 100000;
+  
+  std::cout << "Variants | Key lookup (ns) | Legacy lookup (ns)" << std::endl;
+  
+  for (uint32_t variantCount = 1; variantCount <= 4096; variantCount *= 4) {
+    std::vector<DxvkGraphicsPipelineStateInfo> states;
+    
+    std::unordered_map<DxvkGraphicsPipelineStateKey, uint32_t, DxvkHash> keyMap;
+    std::unordered_map<DxvkGraphicsPipelineStateInfo, uint32_t, LegacyStateHash, LegacyStateEq> legacyMap;
+    
+    for (uint32_t i = 0; i < variantCount; i++) {
+      states.push_back(createState(i));
+      keyMap.insert({ DxvkGraphicsPipelineStateKey(states.back()), i });
+      legacyMap.insert({ states.back(), i });
+    }
+    
+    uint32_t checksum = 0;
+    
+    // Key construction is part of the lookup cost,
+    // since it happens on every pipeline state change
+    double keyTime = measure(iterations, [&] (uint32_t i) {
+      checksum += keyMap.find(DxvkGraphicsPipelineStateKey(
+        states[i % variantCount]))->second;
+    });
+    
+    double legacyTime = measure(iterations, [&] (uint32_t i) {
+      checksum += legacyMap.find(states[i % variantCount])->second;
+    });
+    
+    std::cout << variantCount << " | " << keyTime << " | " << legacyTime
+              << " (" << checksum << ")" << std::endl;
+  }
+  
+  return 0;
+}
\ No newline at end of file
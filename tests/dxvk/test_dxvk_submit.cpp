@@ -0,0 +1,111 @@
+#include <dxvk_device.h>
+#include <dxvk_instance.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <windows.h>
+#include <windowsx.h>
+
+namespace dxvk {
+  Logger Logger::s_instance("dxvk-submit.log");
+}
+
+using namespace dxvk;
+
+// Several threads submit empty command lists at the same
+// time while others wait for the submission thread to
+// drain. Lost wakeups show up as a hang, and an unbalanced
+// pending counter shows up as a non-zero snapshot at the end.
+const uint32_t producerCount    = 8;
+const uint32_t submitsPerThread = 4096;
+const uint32_t syncsPerThread   = 64;
+
+int WINAPI WinMain(HINSTANCE hInstance,
+                   HINSTANCE hPrevInstance,
+                   LPSTR lpCmdLine,
+                   int nCmdShow) {
+  try {
+    VkPhysicalDeviceFeatures features;
+    std::memset(&features, 0, sizeof(features));
+    
+    Rc<DxvkInstance> instance = new DxvkInstance();
+    Rc<DxvkAdapter>  adapter  = instance->enumAdapters().at(0);
+    Rc<DxvkDevice>   device   = adapter->createDevice(features);
+    
+    std::atomic<bool>     done   = { false };
+    std::atomic<uint32_t> failed = { 0u };
+    
+    // Abort instead of hanging forever if a thread
+    // waiting in synchronize() is never woken up
+    std::thread watchdog([&done] {
+      auto t0 = std::chrono::steady_clock::now();
+      
+      while (!done.load()) {
+        if (std::chrono::steady_clock::now() - t0 > std::chrono::seconds(60)) {
+          std::cerr << "Timed out waiting for submissions" << std::endl;
+          std::exit(1);
+        }
+        
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+    });
+    
+    auto t0 = std::chrono::high_resolution_clock::now();
+    
+    std::vector<std::thread> producers;
+    
+    for (uint32_t t = 0; t < producerCount; t++) {
+      producers.emplace_back([&device, &failed] {
+        std::vector<Rc<DxvkFence>> fences;
+        
+        for (uint32_t i = 0; i < submitsPerThread; i++) {
+          Rc<DxvkCommandList> cmdList = device->createCommandList();
+          cmdList->beginRecording();
+          cmdList->endRecording();
+          
+          fences.push_back(device->submitCommandList(
+            cmdList, nullptr, nullptr));
+          
+          if (i % (submitsPerThread / syncsPerThread) == 0)
+            device->waitForIdle();
+        }
+        
+        device->waitForIdle();
+        
+        // Every submission made by this thread must
+        // have been executed once synchronize() returns
+        for (const auto& fence : fences) {
+          if (!fence->wait(0))
+            failed += 1;
+        }
+      });
+    }
+    
+    for (auto& thread : producers)
+      thread.join();
+    
+    auto t1 = std::chrono::high_resolution_clock::now();
+    
+    done.store(true);
+    watchdog.join();
+    
+    const uint32_t pending = device->queryCounters()
+      .get(DxvkStat::DevQueuePendingOps);
+    
+    std::cout << "Submissions:     " << producerCount * submitsPerThread << std::endl;
+    std::cout << "Unsignaled:      " << failed.load() << std::endl;
+    std::cout << "Pending at exit: " << pending << std::endl;
+    std::cout << "Time (ms):       " << std::chrono::duration<double, std::milli>(t1 - t0).count() << std::endl;
+    
+    return (failed.load() == 0 && pending == 0) ? 0 : 1;
+  } catch (const DxvkError& e) {
+    Logger::err(e.message());
+    return 1;
+  }
+}
\ No newline at end of file
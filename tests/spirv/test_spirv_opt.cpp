@@ -0,0 +1,253 @@
+#include <array>
+#include <functional>
+#include <iostream>
+
+#include "../../src/spirv/spirv_module.h"
+#include "../../src/spirv/spirv_optimizer.h"
+
+#include <windows.h>
+#include <windowsx.h>
+
+namespace dxvk {
+  Logger Logger::s_instance("spirv-opt.log");
+}
+
+using namespace dxvk;
+
+// Each test builds a small fragment shader, runs exactly
+// one optimizer pass on it and checks the instructions
+// that remain. The entry point writes a vec4 output.
+struct TestModule {
+  SpirvModule module;
+  
+  uint32_t floatType;
+  uint32_t vec4Type;
+  uint32_t privatePtr;
+  uint32_t inputVar;
+  uint32_t outputVar;
+  
+  uint32_t const1;
+  uint32_t const2;
+};
+
+
+using TestBody = std::function<void (TestModule&)>;
+
+
+SpirvCodeBuffer buildModule(TestModule& m, const TestBody& body) {
+  m.module.enableCapability(spv::CapabilityShader);
+  m.module.setMemoryModel(
+    spv::AddressingModelLogical,
+    spv::MemoryModelGLSL450);
+  
+  uint32_t voidType = m.module.defVoidType();
+  m.floatType  = m.module.defFloatType(32);
+  m.vec4Type   = m.module.defVectorType(m.floatType, 4);
+  m.privatePtr = m.module.defPointerType(m.vec4Type, spv::StorageClassPrivate);
+  
+  m.inputVar  = m.module.newVar(m.module.defPointerType(m.vec4Type, spv::StorageClassInput),  spv::StorageClassInput);
+  m.outputVar = m.module.newVar(m.module.defPointerType(m.vec4Type, spv::StorageClassOutput), spv::StorageClassOutput);
+  
+  m.module.decorateLocation(m.inputVar,  0);
+  m.module.decorateLocation(m.outputVar, 0);
+  
+  std::array<uint32_t, 4> values1;
+  std::array<uint32_t, 4> values2;
+  
+  for (uint32_t i = 0; i < 4; i++) {
+    values1[i] = m.module.constf32(float(i));
+    values2[i] = m.module.constf32(float(i + 4));
+  }
+  
+  m.const1 = m.module.constComposite(m.vec4Type, values1.size(), values1.data());
+  m.const2 = m.module.constComposite(m.vec4Type, values2.size(), values2.data());
+  
+  const uint32_t entryPointId = m.module.allocateId();
+  const std::array<uint32_t, 2> interfaces = { m.inputVar, m.outputVar };
+  
+  m.module.addEntryPoint(entryPointId,
+    spv::ExecutionModelFragment, "main",
+    interfaces.size(), interfaces.data());
+  m.module.setOriginUpperLeft(entryPointId);
+  
+  m.module.functionBegin(voidType, entryPointId,
+    m.module.defFunctionType(voidType, 0, nullptr),
+    spv::FunctionControlMaskNone);
+  m.module.opLabel(m.module.allocateId());
+  
+  body(m);
+  
+  m.module.opReturn();
+  m.module.functionEnd();
+  return m.module.compile();
+}
+
+
+uint32_t countOps(SpirvCodeBuffer& code, spv::Op op) {
+  uint32_t count = 0;
+  
+  for (auto ins : code) {
+    if (ins.opCode() == op)
+      count += 1;
+  }
+  
+  return count;
+}
+
+
+SpirvInstruction findOp(SpirvCodeBuffer& code, spv::Op op) {
+  for (auto ins : code) {
+    if (ins.opCode() == op)
+      return ins;
+  }
+  
+  throw DxvkError(str::format("findOp: Instruction ", uint32_t(op), " not found"));
+}
+
+
+uint32_t g_failed = 0;
+
+
+void check(const char* test, const char* what, bool condition) {
+  if (!condition) {
+    Logger::err(str::format(test, ": ", what));
+    g_failed += 1;
+  }
+}
+
+
+SpirvCodeBuffer runPass(SpirvOptPass pass, SpirvCodeBuffer code) {
+  const SpirvOptPasses passes(pass);
+  
+  SpirvOptimizer optimizer(passes);
+  return optimizer.optimize(code);
+}
+
+
+// Stored values are forwarded to the load, and the
+// private variable is removed entirely.
+void testPromoteVariables() {
+  TestModule m;
+  
+  SpirvCodeBuffer code = runPass(SpirvOptPass::PromoteVariables,
+    buildModule(m, [] (TestModule& m) {
+      uint32_t tmpVar = m.module.newVar(m.privatePtr, spv::StorageClassPrivate);
+      m.module.opStore(tmpVar, m.const1);
+      m.module.opStore(m.outputVar, m.module.opLoad(m.vec4Type, tmpVar));
+    }));
+  
+  check("promote", "variable not removed", countOps(code, spv::OpVariable) == 2);
+  check("promote", "load not removed",     countOps(code, spv::OpLoad)     == 0);
+  check("promote", "store not removed",    countOps(code, spv::OpStore)    == 1);
+  check("promote", "wrong value stored",   findOp(code, spv::OpStore).arg(2) == m.const1);
+}
+
+
+// The first store is overwritten before it is read,
+// and the load reads the value of the second store.
+void testEliminateLoadStore() {
+  TestModule m;
+  
+  SpirvCodeBuffer code = runPass(SpirvOptPass::EliminateLoadStore,
+    buildModule(m, [] (TestModule& m) {
+      uint32_t tmpVar = m.module.newVar(m.privatePtr, spv::StorageClassPrivate);
+      m.module.opStore(tmpVar, m.const1);
+      m.module.opStore(tmpVar, m.const2);
+      m.module.opStore(m.outputVar, m.module.opLoad(m.vec4Type, tmpVar));
+    }));
+  
+  check("loadstore", "dead store not removed", countOps(code, spv::OpStore) == 2);
+  check("loadstore", "load not forwarded",     countOps(code, spv::OpLoad)  == 0);
+  
+  uint32_t storedValue = 0;
+  
+  for (auto ins : code) {
+    if (ins.opCode() == spv::OpStore && ins.arg(1) == m.outputVar)
+      storedValue = ins.arg(2);
+  }
+  
+  check("loadstore", "wrong value forwarded", storedValue == m.const2);
+}
+
+
+// Reversing a vector twice yields the original vector, and
+// extracts from the reversed vector read the input directly.
+void testCollapseShuffles() {
+  TestModule m;
+  uint32_t inputValue = 0;
+  
+  SpirvCodeBuffer code = runPass(SpirvOptPass::CollapseShuffles,
+    buildModule(m, [&inputValue] (TestModule& m) {
+      const std::array<uint32_t, 4> reverse = { 3, 2, 1, 0 };
+      const uint32_t extractIndex = 0;
+      
+      inputValue = m.module.opLoad(m.vec4Type, m.inputVar);
+      
+      uint32_t shuffle1 = m.module.opVectorShuffle(m.vec4Type,
+        inputValue, inputValue, reverse.size(), reverse.data());
+      uint32_t shuffle2 = m.module.opVectorShuffle(m.vec4Type,
+        shuffle1, shuffle1, reverse.size(), reverse.data());
+      
+      m.module.opCompositeExtract(m.floatType, shuffle1, 1, &extractIndex);
+      m.module.opStore(m.outputVar, shuffle2);
+    }));
+  
+  check("shuffle", "identity shuffle not removed", countOps(code, spv::OpVectorShuffle) == 1);
+  check("shuffle", "wrong value stored",           findOp(code, spv::OpStore).arg(2) == inputValue);
+  
+  SpirvInstruction extract = findOp(code, spv::OpCompositeExtract);
+  check("shuffle", "extract not collapsed", extract.arg(3) == inputValue && extract.arg(4) == 3);
+}
+
+
+// Unused arithmetic and variables that are only
+// ever written to are removed.
+void testEliminateDeadCode() {
+  TestModule m;
+  
+  SpirvCodeBuffer code = runPass(SpirvOptPass::EliminateDeadCode,
+    buildModule(m, [] (TestModule& m) {
+      uint32_t tmpVar = m.module.newVar(m.privatePtr, spv::StorageClassPrivate);
+      uint32_t sum    = m.module.opFAdd(m.vec4Type, m.const1, m.const2);
+      m.module.opFAdd(m.vec4Type, sum, m.const1);
+      m.module.opStore(tmpVar, m.const1);
+      m.module.opStore(m.outputVar, m.const2);
+    }));
+  
+  check("dce", "dead arithmetic not removed", countOps(code, spv::OpFAdd)     == 0);
+  check("dce", "dead variable not removed",   countOps(code, spv::OpVariable) == 2);
+  check("dce", "dead store not removed",      countOps(code, spv::OpStore)    == 1);
+}
+
+
+void testParsePassList() {
+  check("passlist", "empty list", SpirvOptimizer::parsePassList("").raw()
+    == (1u << SpirvOptPassCount) - 1);
+  check("passlist", "none", SpirvOptimizer::parsePassList("none").isClear());
+  
+  SpirvOptPasses passes = SpirvOptimizer::parsePassList("dce,shuffle");
+  check("passlist", "pass list", passes.test(SpirvOptPass::EliminateDeadCode)
+                              && passes.test(SpirvOptPass::CollapseShuffles)
+                              && !passes.test(SpirvOptPass::PromoteVariables)
+                              && !passes.test(SpirvOptPass::EliminateLoadStore));
+}
+
+
+int WINAPI WinMain(HINSTANCE hInstance,
+                   HINSTANCE hPrevInstance,
+                   LPSTR lpCmdLine,
+                   int nCmdShow) {
+  try {
+    testPromoteVariables();
+    testEliminateLoadStore();
+    testCollapseShuffles();
+    testEliminateDeadCode();
+    testParsePassList();
+  } catch (const DxvkError& e) {
+    Logger::err(e.message());
+    return 1;
+  }
+  
+  std::cout << (g_failed == 0 ? "All tests passed" : "Some tests failed") << std::endl;
+  return g_failed == 0 ? 0 : 1;
+}